@@ -108,98 +108,117 @@ GetRating(const float rError)
     return RAT_UNDEFINED;
 }
 
-static float
-LuckFirst(const TanBoard anBoard, const int n0, const int n1, cubeinfo * pci, const evalcontext * pec)
-{
+/* The equity for pci->fMove of playing the best move for one roll,
+ * computed as a subtask */
+
+typedef struct {
+    ConstTanBoard anBoard;
+    int n0, n1;
+    const cubeinfo *pci;        /* the player on roll */
+    const cubeinfo *pciOpp;
+    const evalcontext *pec;
+    float r;
+    int fError;
+} luckroll;
 
+static void
+LuckRoll(luckroll * plr)
+{
     TanBoard anBoardTemp;
-    int i, j;
-    float aar[6][6], ar[NUM_ROLLOUT_OUTPUTS], rMean = 0.0f;
-    cubeinfo ciOpp;
+    float ar[NUM_ROLLOUT_OUTPUTS];
     movelist ml;
 
-    /* first with player pci->fMove on roll */
-
-    memcpy(&ciOpp, pci, sizeof(cubeinfo));
-    ciOpp.fMove = !pci->fMove;
-
-    for (i = 0; i < 6; i++)
-        for (j = 0; j < i; j++) {
-            memcpy(&anBoardTemp[0][0], &anBoard[0][0], 2 * 25 * sizeof(int));
+    memcpy(&anBoardTemp[0][0], &plr->anBoard[0][0], 2 * 25 * sizeof(int));
 
-            /* Find the best move for each roll at ply 0 only. */
-            if (FindnSaveBestMoves(&ml, i + 1, j + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
-                                   pci, pec, defaultFilters) < 0) {
-                g_free(ml.amMoves);
-                return ERR_VAL;
-            }
-
-            if (!ml.cMoves) {
+    /* Find the best move for each roll at ply 0 only. */
+    if (FindnSaveBestMoves(&ml, plr->n0 + 1, plr->n1 + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
+                           plr->pci, plr->pec, defaultFilters) < 0) {
+        g_free(ml.amMoves);
+        plr->fError = TRUE;
+        return;
+    }
 
-                SwapSides(anBoardTemp);
+    if (!ml.cMoves) {
 
-                if (GeneralEvaluationE(ar, (ConstTanBoard) anBoardTemp, &ciOpp, pec) < 0)
-                    return ERR_VAL;
+        SwapSides(anBoardTemp);
 
-                if (pec->fCubeful) {
-                    if (pci->nMatchTo)
-                        aar[i][j] = -mwc2eq(ar[OUTPUT_CUBEFUL_EQUITY], &ciOpp);
-                    else
-                        aar[i][j] = -ar[OUTPUT_CUBEFUL_EQUITY];
-                } else
-                    aar[i][j] = -ar[OUTPUT_EQUITY];
+        if (GeneralEvaluationE(ar, (ConstTanBoard) anBoardTemp, plr->pciOpp, plr->pec) < 0) {
+            plr->fError = TRUE;
+            return;
+        }
 
-            } else {
-                aar[i][j] = ml.amMoves[0].rScore;
-                g_free(ml.amMoves);
-            }
+        if (plr->pec->fCubeful) {
+            if (plr->pci->nMatchTo)
+                plr->r = -mwc2eq(ar[OUTPUT_CUBEFUL_EQUITY], plr->pciOpp);
+            else
+                plr->r = -ar[OUTPUT_CUBEFUL_EQUITY];
+        } else
+            plr->r = -ar[OUTPUT_EQUITY];
 
-            rMean += aar[i][j];
+    } else {
+        plr->r = ml.amMoves[0].rScore;
+        g_free(ml.amMoves);
+    }
+}
 
-        }
+static void
+SpawnLuckRoll(mtsync * ps, luckroll * plr, ConstTanBoard anBoard, int n0, int n1,
+              const cubeinfo * pci, const cubeinfo * pciOpp, const evalcontext * pec)
+{
+    plr->anBoard = anBoard;
+    plr->n0 = n0;
+    plr->n1 = n1;
+    plr->pci = pci;
+    plr->pciOpp = pciOpp;
+    plr->pec = pec;
+    plr->fError = FALSE;
 
-    /* with other player on roll */
+    MT_Spawn(ps, (AsyncFun) LuckRoll, plr);
+}
 
-    for (i = 0; i < 6; i++)
-        for (j = i + 1; j < 6; j++) {
-            memcpy(&anBoardTemp[0][0], &anBoard[0][0], 2 * 25 * sizeof(int));
-            SwapSides(anBoardTemp);
-
-            /* Find the best move for each roll at ply 0 only. */
-            if (FindnSaveBestMoves(&ml, i + 1, j + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
-                                   &ciOpp, pec, defaultFilters) < 0) {
-                g_free(ml.amMoves);
-                return ERR_VAL;
-            }
+/* The rolls are evaluated in parallel when called from a task */
 
-            if (!ml.cMoves) {
+static float
+LuckFirst(const TanBoard anBoard, const int n0, const int n1, cubeinfo * pci, const evalcontext * pec)
+{
 
-                SwapSides(anBoardTemp);
+    TanBoard anBoardOpp;
+    int i, j;
+    luckroll alr[6][6];
+    float rMean = 0.0f;
+    cubeinfo ciOpp;
+    mtsync ms = { 0 };
 
-                if (GeneralEvaluationE(ar, (ConstTanBoard) anBoardTemp, pci, pec) < 0)
-                    return ERR_VAL;
+    memcpy(&ciOpp, pci, sizeof(cubeinfo));
+    ciOpp.fMove = !pci->fMove;
 
-                if (pec->fCubeful) {
-                    if (pci->nMatchTo)
-                        aar[i][j] = mwc2eq(ar[OUTPUT_CUBEFUL_EQUITY], pci);
-                    else
-                        aar[i][j] = ar[OUTPUT_CUBEFUL_EQUITY];
-                } else
-                    aar[i][j] = ar[OUTPUT_EQUITY];
+    memcpy(&anBoardOpp[0][0], &anBoard[0][0], 2 * 25 * sizeof(int));
+    SwapSides(anBoardOpp);
 
-            } else {
-                aar[i][j] = -ml.amMoves[0].rScore;
-                g_free(ml.amMoves);
-            }
+    for (i = 0; i < 6; i++)
+        for (j = 0; j < 6; j++)
+            if (j < i)
+                /* player pci->fMove on roll */
+                SpawnLuckRoll(&ms, &alr[i][j], anBoard, i, j, pci, &ciOpp, pec);
+            else if (j > i)
+                /* other player on roll */
+                SpawnLuckRoll(&ms, &alr[i][j], (ConstTanBoard) anBoardOpp, i, j, &ciOpp, pci, pec);
 
-            rMean += aar[i][j];
+    MT_Sync(&ms);
 
+    for (i = 0; i < 6; i++)
+        for (j = 0; j < 6; j++) {
+            if (i == j)
+                continue;
+            if (alr[i][j].fError)
+                return ERR_VAL;
+            rMean += j < i ? alr[i][j].r : -alr[i][j].r;
         }
 
     if (n0 > n1)
-        return aar[n0][n1] - rMean / 30.0f;
+        return alr[n0][n1].r - rMean / 30.0f;
     else
-        return aar[n1][n0] - rMean / 30.0f;
+        return alr[n1][n0].r - rMean / 30.0f;
 
 }
 
@@ -207,51 +226,29 @@ static float
 LuckNormal(const TanBoard anBoard, const int n0, const int n1, const cubeinfo * pci, const evalcontext * pec)
 {
 
-    TanBoard anBoardTemp;
     int i, j;
-    float aar[6][6], ar[NUM_ROLLOUT_OUTPUTS], rMean = 0.0f;
+    luckroll alr[6][6];
+    float rMean = 0.0f;
     cubeinfo ciOpp;
-    movelist ml;
+    mtsync ms = { 0 };
 
     memcpy(&ciOpp, pci, sizeof(cubeinfo));
     ciOpp.fMove = !pci->fMove;
 
     for (i = 0; i < 6; i++)
-        for (j = 0; j <= i; j++) {
-            memcpy(&anBoardTemp[0][0], &anBoard[0][0], 2 * 25 * sizeof(int));
-
-            /* Find the best move for each roll at ply 0 only. */
-            if (FindnSaveBestMoves(&ml, i + 1, j + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
-                                   pci, pec, defaultFilters) < 0) {
-                g_free(ml.amMoves);
-                return ERR_VAL;
-            }
-
-            if (!ml.cMoves) {
-
-                SwapSides(anBoardTemp);
-
-                if (GeneralEvaluationE(ar, (ConstTanBoard) anBoardTemp, &ciOpp, pec) < 0)
-                    return ERR_VAL;
+        for (j = 0; j <= i; j++)
+            SpawnLuckRoll(&ms, &alr[i][j], anBoard, i, j, pci, &ciOpp, pec);
 
-                if (pec->fCubeful) {
-                    if (pci->nMatchTo)
-                        aar[i][j] = -mwc2eq(ar[OUTPUT_CUBEFUL_EQUITY], &ciOpp);
-                    else
-                        aar[i][j] = -ar[OUTPUT_CUBEFUL_EQUITY];
-                } else
-                    aar[i][j] = -ar[OUTPUT_EQUITY];
-
-            } else {
-                aar[i][j] = ml.amMoves[0].rScore;
-                g_free(ml.amMoves);
-            }
-
-            rMean += (i == j) ? aar[i][j] : aar[i][j] * 2.0f;
+    MT_Sync(&ms);
 
+    for (i = 0; i < 6; i++)
+        for (j = 0; j <= i; j++) {
+            if (alr[i][j].fError)
+                return ERR_VAL;
+            rMean += (i == j) ? alr[i][j].r : alr[i][j].r * 2.0f;
         }
 
-    return aar[n0][n1] - rMean / 36.0f;
+    return alr[n0][n1].r - rMean / 36.0f;
 
 }
 
@@ -685,8 +682,16 @@ AnalyzeMove(moverecord * pmr, matchstate * pms, const listOLD * plParentGame,
         /* luck analysis */
 
         if (fAnalyseDice) {
-            pmr->rLuck = LuckAnalysis((ConstTanBoard) pms->anBoard, pmr->anDice[0], pmr->anDice[1], pms);
-            pmr->lt = Luck(pmr->rLuck);
+            float rLuck;
+
+            /* the luck rolls are evaluated in parallel; let the other
+             * analysis tasks run meanwhile */
+            MT_Release();
+            rLuck = LuckAnalysis((ConstTanBoard) pms->anBoard, pmr->anDice[0], pmr->anDice[1], pms);
+            MT_Exclusive();
+
+            pmr->rLuck = rLuck;
+            pmr->lt = Luck(rLuck);
         }
 
         /* evaluate move */
@@ -896,8 +901,14 @@ AnalyzeMove(moverecord * pmr, matchstate * pms, const listOLD * plParentGame,
         GetMatchStateCubeInfo(&ci, pms);
 
         if (fAnalyseDice) {
-            pmr->rLuck = LuckAnalysis((ConstTanBoard) pms->anBoard, pmr->anDice[0], pmr->anDice[1], pms);
-            pmr->lt = Luck(pmr->rLuck);
+            float rLuck;
+
+            MT_Release();
+            rLuck = LuckAnalysis((ConstTanBoard) pms->anBoard, pmr->anDice[0], pmr->anDice[1], pms);
+            MT_Exclusive();
+
+            pmr->rLuck = rLuck;
+            pmr->lt = Luck(rLuck);
         }
 
         if (psc)
@@ -938,10 +949,24 @@ NumberMovesGame(listOLD * plGame)
 }
 
 
+/* Analysis is bulk work: it runs in its own group, behind anything the
+ * user asks for meanwhile */
+
+static mtgroup *pgAnalysis;
+
+static mtgroup *
+AnalysisGroup(void)
+{
+    if (!pgAnalysis)
+        pgAnalysis = MT_GroupNew(MT_PRIORITY_BATCH);
+
+    return pgAnalysis;
+}
+
 static gboolean
 UpdateProgressBar(gpointer UNUSED(unused))
 {
-    ProgressValue(MT_GetDoneTasks());
+    ProgressValue(MT_GroupDoneTasks(AnalysisGroup()));
     return TRUE;
 }
 
@@ -1018,7 +1043,7 @@ AnalyzeGame(listOLD * plGame, int wait)
                 pParentTask = NULL;
             }
             multi_debug("add task: analysis");
-            MT_AddTask((Task *) pt, TRUE);
+            MT_GroupAddTask(AnalysisGroup(), (Task *) pt);
         }
 
         FixMatchState(&msAnalyse, pmr);
@@ -1035,7 +1060,7 @@ AnalyzeGame(listOLD * plGame, int wait)
         int result;
 
         multi_debug("wait for all task: analysis");
-        result = MT_WaitForTasks(UpdateProgressBar, 250, fAutoSaveAnalysis);
+        result = MT_GroupWait(AnalysisGroup(), UpdateProgressBar, 250, fAutoSaveAnalysis);
 
         if (result == -1)
             IniStatcontext(psc);
@@ -1276,7 +1301,7 @@ CommandAnalyseMatch(char *UNUSED(sz))
     }
 
     multi_debug("wait for all task: analysis");
-    MT_WaitForTasks(UpdateProgressBar, 250, fAutoSaveAnalysis);
+    MT_GroupWait(AnalysisGroup(), UpdateProgressBar, 250, fAutoSaveAnalysis);
 
     ProgressEnd();
 
@@ -384,6 +384,12 @@ extern int fTutor;
 extern int fTutorChequer;
 extern int fTutorCube;
 extern int log_rollouts;
+extern unsigned int nRolloutMergeInterval;
+extern int fRolloutLUCB;
+extern char *szRolloutWorkers;
+extern char *szRolloutCheckpoint;
+extern char *szRolloutResultDir;
+extern unsigned int nRolloutCheckpointInterval;
 extern int nThreadPriority;
 extern int nToolbarStyle;
 extern int nTutorSkillCurrent;
@@ -428,6 +434,7 @@ extern command acSetRolloutLate[];
 extern command acSetRolloutLatePlayer[];
 extern command acSetRolloutLimit[];
 extern command acSetRolloutPlayer[];
+extern command acSetThreads[];
 extern command acSetTruncation[];
 extern command acShow[];
 extern command acTop[];
@@ -560,6 +567,11 @@ extern void CommandAnnotateUnlucky(char *);
 extern void CommandAnnotateVeryBad(char *);
 extern void CommandAnnotateVeryLucky(char *);
 extern void CommandAnnotateVeryUnlucky(char *);
+extern void CommandBenchmarkAllocation(char *);
+extern void CommandBenchmarkBearoff(char *);
+extern void CommandBenchmarkPlacement(char *);
+extern void CommandBenchmarkRollout(char *);
+extern void CommandBenchmarkTasks(char *);
 extern void CommandCalibrate(char *);
 extern void CommandClearCache(char *);
 extern void CommandClearHint(char *);
@@ -654,6 +666,9 @@ extern void CommandRelationalTest(char *);
 extern void CommandResign(char *);
 extern void CommandRoll(char *);
 extern void CommandRollout(char *);
+extern void CommandRolloutJob(char *);
+extern void CommandRolloutResume(char *);
+extern void CommandRolloutWorker(char *);
 extern void CommandSaveGame(char *);
 extern void CommandSaveMatch(char *);
 extern void CommandSavePosition(char *);
@@ -692,6 +707,8 @@ extern void CommandSetAutoSaveConfirmDelete(char *sz);
 extern void CommandSetAutoSaveRollout(char *sz);
 extern void CommandSetAutoSaveTime(char *sz);
 extern void CommandSetBeavers(char *);
+extern void CommandSetBearoffAdvice(char *);
+extern void CommandSetBearoffWarmup(char *);
 extern void CommandSetBoard(char *);
 extern void CommandSetBrowser(char *);
 extern void CommandSetCache(char *);
@@ -765,6 +782,9 @@ extern void CommandSetExportMovesProb(char *);
 extern void CommandSetExportParametersEvaluation(char *);
 extern void CommandSetExportParametersRollout(char *);
 extern void CommandSetExportPNGSize(char *);
+extern void CommandSetExternalCache(char *);
+extern void CommandSetExternalConnections(char *);
+extern void CommandSetExternalQueue(char *);
 extern void CommandSetExportShowBoard(char *);
 extern void CommandSetExportShowPlayer(char *);
 extern void CommandSetFullScreen(char *);
@@ -853,6 +873,7 @@ extern void CommandSetRNGManual(char *);
 extern void CommandSetRNGMD5(char *);
 extern void CommandSetRNGMersenne(char *);
 extern void CommandSetRNGRandomDotOrg(char *);
+extern void CommandSetRolloutAllocation(char *);
 extern void CommandSetRolloutBearoffTruncationExact(char *);
 extern void CommandSetRolloutBearoffTruncationOS(char *);
 extern void CommandSetRollout(char *);
@@ -860,6 +881,7 @@ extern void CommandSetRolloutChequerplay(char *);
 extern void CommandSetRolloutCubedecision(char *);
 extern void CommandSetRolloutCubeEqualChequer(char *);
 extern void CommandSetRolloutCubeful(char *);
+extern void CommandSetRolloutCheckpoint(char *);
 extern void CommandSetRolloutInitial(char *);
 extern void CommandSetRolloutJsd(char *);
 extern void CommandSetRolloutJsdEnable(char *);
@@ -878,6 +900,7 @@ extern void CommandSetRolloutLimitMinGames(char *);
 extern void CommandSetRolloutLogEnable(char *);
 extern void CommandSetRolloutLogFile(char *);
 extern void CommandSetRolloutMaxError(char *);
+extern void CommandSetRolloutMergeInterval(char *);
 extern void CommandSetRolloutMoveFilter(char *);
 extern void CommandSetRolloutPlayer(char *);
 extern void CommandSetRolloutPlayerChequerplay(char *);
@@ -888,6 +911,7 @@ extern void CommandSetRolloutPlayerLateMoveFilter(char *);
 extern void CommandSetRolloutPlayerMoveFilter(char *);
 extern void CommandSetRolloutPlayersAreSame(char *);
 extern void CommandSetRolloutRNG(char *);
+extern void CommandSetRolloutResultDir(char *);
 extern void CommandSetRolloutRotate(char *);
 extern void CommandSetRolloutSeed(char *);
 extern void CommandSetRolloutTrials(char *);
@@ -898,6 +922,7 @@ extern void CommandSetRolloutTruncationEnable(char *);
 extern void CommandSetRolloutTruncationEqualPlayer0(char *);
 extern void CommandSetRolloutTruncationPlies(char *);
 extern void CommandSetRolloutVarRedn(char *);
+extern void CommandSetRolloutWorkers(char *);
 extern void CommandSetScore(char *);
 extern void CommandSetScoreMapPly(char*);
 extern void CommandSetScoreMapMatchLength(char*);
@@ -932,6 +957,8 @@ extern void CommandSetSoundSystemCommand(char *);
 extern void CommandSetStyledGameList(char *);
 extern void CommandSetTheoryWindow(char *);
 extern void CommandSetThreads(char *);
+extern void CommandSetThreadsAffinity(char *);
+extern void CommandSetThreadsSMT(char *);
 extern void CommandSetToolbar(char *);
 extern void CommandSetTurn(char *);
 extern void CommandSetTutorChequer(char *);
@@ -973,6 +1000,7 @@ extern void CommandShowDisplay(char *);
 extern void CommandShowEngine(char *);
 extern void CommandShowEvaluation(char *);
 extern void CommandShowExport(char *);
+extern void CommandShowExternal(char *);
 extern void CommandShowFullBoard(char *);
 extern void CommandShowGammonValues(char *);
 extern void CommandShowGeometry(char *);
@@ -27,6 +27,11 @@
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifndef WIN32
+#include <sys/mman.h>
+#else
+#include <io.h>
+#endif
 
 #include "bearoffgammon.h"
 #include "positionid.h"
@@ -39,6 +44,48 @@
 #define HEURISTIC_C 15
 #define HEURISTIC_P 6
 
+/* Small direct-mapped cache of two-sided records read from disk or from
+ * compressed blocks. Each thread has its own set of caches, so lookups
+ * need no locking. */
+
+#define BEAROFF_CACHE_SIZE 64
+
+/* Decoded blocks of a block-compressed two-sided database, with the
+ * least recently used one replaced first. */
+
+#define BEAROFF_BLOCK_CACHE_SIZE 8
+
+/* Fully decoded one-sided distributions, as returned by BearoffDist */
+
+#define BEAROFF_DIST_CACHE_SIZE 1024
+
+typedef struct {
+    unsigned int nKey;          /* position + 1, 0 if empty */
+    unsigned short int aus[64];
+    float arProb[32];
+    float arGammonProb[32];
+    float ar[4];
+} bearoffdist;
+
+struct bearoffcache {
+    unsigned int anKey[BEAROFF_CACHE_SIZE];     /* position + 1, 0 if empty */
+    unsigned short int aaus[BEAROFF_CACHE_SIZE][4];      /* two-sided records */
+    unsigned int anBlock[BEAROFF_BLOCK_CACHE_SIZE];     /* block + 1, 0 if empty */
+    unsigned int anBlockUsed[BEAROFF_BLOCK_CACHE_SIZE];
+    unsigned int nBlockClock;
+    unsigned short int *apusBlock[BEAROFF_BLOCK_CACHE_SIZE];
+    unsigned char *puchBlock;   /* encoded block read from disk */
+    bearoffdist *abd;
+    unsigned long nHits;        /* lookups served from this cache */
+    unsigned long nMisses;
+};
+
+/* how the kernel should page in memory mapped databases */
+bearoffadvice baBearoff = BEAROFF_ADVICE_NORMAL;
+const char *aszBearoffAdvice[] = { "normal", "random", "willneed" };
+/* fault in the hot part of each mapped database in the background */
+int fBearoffWarmup = FALSE;
+
 static int
 setGammonProb(const TanBoard anBoard, unsigned int bp0, unsigned int bp1, float *g0, float *g1)
 {
@@ -257,21 +304,276 @@ HeuristicDatabase(void (*pfProgress) (unsigned int))
 
 
 static void
-ReadBearoffFile(const bearoffcontext * pbc, unsigned int offset, unsigned char *buf, unsigned int nBytes)
+ReadBearoffFile(const bearoffcontext * pbc, size_t offset, unsigned char *buf, unsigned int nBytes)
 {
-    MT_Exclusive();
+#ifndef WIN32
+    /* positional reads leave the file offset alone, so no lock is needed */
+    int fd = fileno(pbc->pf);
+    unsigned int n = 0;
+
+    errno = 0;
+
+    while (n < nBytes) {
+        ssize_t r = pread(fd, buf + n, nBytes - n, (off_t) offset + n);
+
+        if (r > 0)
+            n += (unsigned int) r;
+        else if (r < 0 && errno == EINTR)
+            continue;
+        else
+            break;
+    }
 
-    if ((fseek(pbc->pf, (long) offset, SEEK_SET) < 0) || (fread(buf, 1, nBytes, pbc->pf) < nBytes)) {
+    if (n < nBytes) {
+#else
+    /* nor does ReadFile() at an explicit offset */
+    HANDLE h = (HANDLE) _get_osfhandle(_fileno(pbc->pf));
+    OVERLAPPED ov;
+    DWORD n = 0;
+    int fOK;
+
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD) ((guint64) offset & 0xFFFFFFFF);
+    ov.OffsetHigh = (DWORD) ((guint64) offset >> 32);
+
+    errno = 0;
+    fOK = h != INVALID_HANDLE_VALUE && ReadFile(h, buf, nBytes, &n, &ov) && n == nBytes;
+
+    if (!fOK) {
+#endif
         if (errno)
             perror(_("bearoff database"));
         else
             fprintf(stderr, _("Error reading bearoff database"));
 
         memset(buf, 0, nBytes);
+    }
+}
+
+/* Return the calling thread's record cache, or NULL if the database
+ * is held in memory and does not need one. */
+
+static struct bearoffcache *
+BearoffThreadCache(const bearoffcontext * pbc)
+{
+    int i;
+
+    if (!pbc->apCache)
+        return NULL;
+
+#if defined(USE_MULTITHREAD)
+    /* e.g. lookups before MT_InitThreads */
+    if (!td.tlsItem || !g_private_get(td.tlsItem))
+        return NULL;
+#endif
+
+    i = MT_GetThreadID() + 1;   /* the main thread has id -1 */
+    if (i < 0 || (unsigned int) i > MT_GetMaxThreads())
+        return NULL;
+
+    if (!pbc->apCache[i])
+        pbc->apCache[i] = g_new0(struct bearoffcache, 1);
+
+    return pbc->apCache[i];
+}
+
+/*
+ * Block-compressed two-sided databases.
+ *
+ * The positions are stored in blocks of nBlockSize positions, preceded
+ * by the 40 byte header and an index of nBlocks + 1 little endian 64 bit
+ * offsets of the blocks relative to the end of the index. Within a block
+ * each of the k equities is stored in turn for all positions, as the
+ * difference to the same equity of the previous position, zigzag coded
+ * and written 7 bits at a time, lowest first.
+ */
+
+extern size_t
+BearoffEncodeBlock(const unsigned short int aus[], unsigned int nPositions, unsigned int k, unsigned char *puch)
+{
+    unsigned char *pch = puch;
+    unsigned int i, j;
+
+    for (j = 0; j < k; ++j) {
+        int iPrev = 0;
+
+        for (i = 0; i < nPositions; ++i) {
+            int d = (int) aus[i * k + j] - iPrev;
+            unsigned int u = (d >= 0) ? (unsigned int) d << 1 : ((unsigned int) -d << 1) - 1;
+
+            while (u >= 0x80) {
+                *pch++ = (unsigned char) (u | 0x80);
+                u >>= 7;
+            }
+            *pch++ = (unsigned char) u;
+
+            iPrev = aus[i * k + j];
+        }
+    }
+
+    return (size_t) (pch - puch);
+}
+
+static int
+BearoffDecodeBlock(const unsigned char *puch, size_t nBytes, unsigned int nPositions, unsigned int k,
+                   unsigned short int aus[])
+{
+    const unsigned char *pch = puch, *pchEnd = puch + nBytes;
+    unsigned int i, j;
+
+    for (j = 0; j < k; ++j) {
+        int iPrev = 0;
+
+        for (i = 0; i < nPositions; ++i) {
+            unsigned int u = 0, nShift = 0;
+            int d;
+
+            do {
+                if (pch == pchEnd || nShift > 14)
+                    return -1;
+                u |= (unsigned int) (*pch & 0x7F) << nShift;
+                nShift += 7;
+            } while (*pch++ & 0x80);
+
+            d = (u & 1) ? -(int) ((u + 1) >> 1) : (int) (u >> 1);
+            iPrev += d;
+            aus[i * k + j] = (unsigned short int) iPrev;
+        }
+    }
+
+    return pch == pchEnd ? 0 : -1;
+}
+
+static unsigned int
+BearoffBlockCount(const bearoffcontext * pbc)
+{
+    unsigned int n = pbc->nPositions;
+
+    return (unsigned int) (((guint64) n * n + pbc->nBlockSize - 1) / pbc->nBlockSize);
+}
+
+static guint64
+ReadLittleEndian64(const unsigned char *pch)
+{
+    guint64 u = 0;
+    int i;
+
+    for (i = 7; i >= 0; --i)
+        u = (u << 8) | pch[i];
+
+    return u;
+}
+
+/* Decode block iBlock into aus; returns -1 if the block is damaged */
+
+static int
+ReadTwoSidedBlock(const bearoffcontext * pbc, struct bearoffcache *pcache, unsigned int iBlock,
+                  unsigned short int aus[])
+{
+    unsigned int k = pbc->fCubeful ? 4 : 1;
+    unsigned int nBlocks = BearoffBlockCount(pbc);
+    unsigned int n = pbc->nPositions;
+    guint64 nTotal = (guint64) n * n;
+    unsigned int nPositions = pbc->nBlockSize;
+    size_t iData = 40 + 8 * ((size_t) nBlocks + 1);
+    unsigned char ac[16];
+    const unsigned char *pch;
+    guint64 iStart, iEnd;
+    int r;
+
+    if ((guint64) (iBlock + 1) * pbc->nBlockSize > nTotal)
+        nPositions = (unsigned int) (nTotal - (guint64) iBlock * pbc->nBlockSize);
+
+    /* find the block */
+
+    if (pbc->p)
+        pch = pbc->p + 40 + 8 * (size_t) iBlock;
+    else {
+        ReadBearoffFile(pbc, 40 + 8 * (size_t) iBlock, ac, 16);
+        pch = ac;
+    }
+
+    iStart = ReadLittleEndian64(pch);
+    iEnd = ReadLittleEndian64(pch + 8);
+
+    if (iEnd < iStart || iEnd - iStart > BEAROFF_BLOCK_BYTES(nPositions * k))
+        return -1;
+
+    if (pbc->map && iData + iEnd > g_mapped_file_get_length(pbc->map))
+        return -1;
+
+    /* and decode it */
+
+    if (pbc->p)
+        return BearoffDecodeBlock(pbc->p + iData + iStart, (size_t) (iEnd - iStart), nPositions, k, aus);
+
+    if (pcache) {
+        if (!pcache->puchBlock)
+            pcache->puchBlock = g_malloc(BEAROFF_BLOCK_BYTES(pbc->nBlockSize * k));
+        ReadBearoffFile(pbc, iData + (size_t) iStart, pcache->puchBlock, (unsigned int) (iEnd - iStart));
+        return BearoffDecodeBlock(pcache->puchBlock, (size_t) (iEnd - iStart), nPositions, k, aus);
+    }
+
+    {
+        unsigned char *puch = g_malloc(BEAROFF_BLOCK_BYTES(pbc->nBlockSize * k));
+
+        ReadBearoffFile(pbc, iData + (size_t) iStart, puch, (unsigned int) (iEnd - iStart));
+        r = BearoffDecodeBlock(puch, (size_t) (iEnd - iStart), nPositions, k, aus);
+        g_free(puch);
+        return r;
+    }
+}
+
+static void
+ReadTwoSidedBlocked(const bearoffcontext * pbc, struct bearoffcache *pcache, const unsigned int iPos,
+                    unsigned short int ausRecord[4])
+{
+    unsigned int k = pbc->fCubeful ? 4 : 1;
+    unsigned int iBlock = iPos / pbc->nBlockSize;
+    unsigned int iOffset = (iPos % pbc->nBlockSize) * k;
+    unsigned short int *pus;
+    unsigned int i, iLRU = 0;
+
+    if (!pcache) {
+        /* no cache for this thread; decode the block for this lookup only */
+        pus = g_new(unsigned short int, pbc->nBlockSize * k);
+        if (ReadTwoSidedBlock(pbc, NULL, iBlock, pus) < 0) {
+            g_printerr(_("%s: damaged block %u\n"), pbc->szFilename, iBlock);
+            memset(pus, 0, pbc->nBlockSize * k * sizeof(unsigned short int));
+        }
+        memcpy(ausRecord, pus + iOffset, k * sizeof(unsigned short int));
+        g_free(pus);
+        return;
+    }
+
+    ++pcache->nBlockClock;
+
+    for (i = 0; i < BEAROFF_BLOCK_CACHE_SIZE; ++i) {
+        if (pcache->anBlock[i] == iBlock + 1) {
+            pcache->anBlockUsed[i] = pcache->nBlockClock;
+            memcpy(ausRecord, pcache->apusBlock[i] + iOffset, k * sizeof(unsigned short int));
+            return;
+        }
+        if (pcache->anBlockUsed[i] < pcache->anBlockUsed[iLRU])
+            iLRU = i;
+    }
+
+    /* decode into the least recently used slot */
+
+    if (!pcache->apusBlock[iLRU])
+        pcache->apusBlock[iLRU] = g_new(unsigned short int, pbc->nBlockSize * k);
+    pus = pcache->apusBlock[iLRU];
+
+    if (ReadTwoSidedBlock(pbc, pcache, iBlock, pus) < 0) {
+        g_printerr(_("%s: damaged block %u\n"), pbc->szFilename, iBlock);
+        memset(ausRecord, 0, k * sizeof(unsigned short int));
+        pcache->anBlock[iLRU] = 0;
         return;
     }
 
-    MT_Release();
+    pcache->anBlock[iLRU] = iBlock + 1;
+    pcache->anBlockUsed[iLRU] = pcache->nBlockClock;
+    memcpy(ausRecord, pus + iOffset, k * sizeof(unsigned short int));
 }
 
 /* BEAROFF_GNUBG: read two sided bearoff database */
@@ -281,17 +583,45 @@ ReadTwoSidedBearoff(const bearoffcontext * pbc, const unsigned int iPos, float a
     unsigned int i, k = (pbc->fCubeful) ? 4 : 1;
     unsigned char ac[8];
     unsigned char *pc = NULL;
+    unsigned short int ausRecord[4];
+    struct bearoffcache *pcache = BearoffThreadCache(pbc);
+    unsigned int iSlot = iPos % BEAROFF_CACHE_SIZE;
 
-    if (pbc->p)
-        pc = pbc->p + 40 + 2 * iPos * k;
-    else {
-        ReadBearoffFile(pbc, 40 + 2 * iPos * k, ac, k * 2);
-        pc = ac;
+    /* raw records in memory are as cheap to read as the cache */
+    if (pbc->p && !pbc->fBlocked)
+        pcache = NULL;
+
+    if (pcache && pcache->anKey[iSlot] == iPos + 1) {
+        memcpy(ausRecord, pcache->aaus[iSlot], k * sizeof(unsigned short int));
+        ++pcache->nHits;
+    } else {
+        if (pcache)
+            ++pcache->nMisses;
+
+        if (pbc->fBlocked)
+            ReadTwoSidedBlocked(pbc, pcache, iPos, ausRecord);
+        else {
+            if (pbc->p)
+                pc = pbc->p + 40 + 2 * iPos * k;
+            else {
+                ReadBearoffFile(pbc, 40 + 2 * iPos * k, ac, k * 2);
+                pc = ac;
+            }
+
+            for (i = 0; i < k; ++i)
+                ausRecord[i] = pc[2 * i] | (unsigned short) (pc[2 * i + 1] << 8);
+        }
+
+        /* add to cache */
+
+        if (pcache) {
+            memcpy(pcache->aaus[iSlot], ausRecord, k * sizeof(unsigned short int));
+            pcache->anKey[iSlot] = iPos + 1;
+        }
     }
-    /* add to cache */
 
     for (i = 0; i < k; ++i) {
-        unsigned short int us = pc[2 * i] | (unsigned short) (pc[2 * i + 1] << 8);
+        unsigned short int us = ausRecord[i];
 
         if (aus)
             aus[i] = us;
@@ -317,7 +647,7 @@ BearoffEvalTwoSided(const bearoffcontext * pbc, const TanBoard anBoard, float ar
 
     unsigned int nUs = PositionBearoff(anBoard[1], pbc->nPoints, pbc->nChequers);
     unsigned int nThem = PositionBearoff(anBoard[0], pbc->nPoints, pbc->nChequers);
-    unsigned int n = Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints);
+    unsigned int n = pbc->nPositions;
     unsigned int iPos = nUs * n + nThem;
     float ar[4];
 
@@ -460,7 +790,7 @@ BearoffEvalHypergammon(const bearoffcontext * pbc, const TanBoard anBoard, float
 
     unsigned int nUs = PositionBearoff(anBoard[1], pbc->nPoints, pbc->nChequers);
     unsigned int nThem = PositionBearoff(anBoard[0], pbc->nPoints, pbc->nChequers);
-    unsigned int n = Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints);
+    unsigned int n = pbc->nPositions;
     unsigned int iPos = nUs * n + nThem;
 
     return ReadHypergammon(pbc, iPos, arOutput, NULL);
@@ -512,21 +842,40 @@ BearoffStatus(const bearoffcontext * pbc, char *sz)
 
     sz += sprintf(sz, "   - %s\n", _("generated by GNU Backgammon"));
 
+    if (pbc->map) {
+        float r = BearoffResident(pbc);
+
+        if (r >= 0.0f)
+            sprintf(buf, _("memory mapped, %.1f%% resident"), r);
+        else
+            strcpy(buf, _("memory mapped"));
+        sz += sprintf(sz, "   - %s\n", buf);
+    }
+
     sprintf(buf, _("up to %u chequers on %u points (%u positions) per player"), pbc->nChequers, pbc->nPoints,
-            Combination(pbc->nChequers + pbc->nPoints, pbc->nPoints));
+            pbc->nPositions);
     sz += sprintf(sz, "   - %s\n", buf);
 
     switch (pbc->bt) {
     case BEAROFF_TWOSIDED:
         sz += sprintf(sz, "   - %s\n", pbc->fCubeful ? _("database includes both cubeful and cubeless equities")
                       : _("cubeless database"));
+        if (pbc->fBlocked) {
+            sprintf(buf, _("compressed in blocks of %u positions"), pbc->nBlockSize);
+            sz += sprintf(sz, "   - %s\n", buf);
+        }
         break;
 
     case BEAROFF_ONESIDED:
         if (pbc->fND)
             sz += sprintf(sz, "   - %s\n", _("distributions are approximated with a normal distribution"));
-        if (pbc->fHeuristic)
+        if (pbc->fHeuristic) {
             sz += sprintf(sz, "   - %s\n", _("with heuristic moves"));
+            if (pbc->szFilename) {
+                sprintf(buf, _("cached in %s"), pbc->szFilename);
+                sz += sprintf(sz, "   - %s\n", buf);
+            }
+        }
 
         sz += sprintf(sz, "   - %s\n", pbc->fGammon ? _("database includes gammon distributions")
                       : _("database does not include gammon distributions"));
@@ -536,6 +885,23 @@ BearoffStatus(const bearoffcontext * pbc, char *sz)
     default:
         break;
     }
+
+    if (pbc->apCache) {
+        unsigned long nHits = 0, nMisses = 0;
+        int i;
+
+        for (i = 0; i <= (int) MT_GetMaxThreads(); ++i)
+            if (pbc->apCache[i]) {
+                nHits += pbc->apCache[i]->nHits;
+                nMisses += pbc->apCache[i]->nMisses;
+            }
+
+        if (nHits + nMisses) {
+            sprintf(buf, _("lookup cache: %lu hits, %lu misses (%.1f%% hits)"), nHits, nMisses,
+                    100.0 * nHits / (nHits + nMisses));
+            sz += sprintf(sz, "   - %s\n", buf);
+        }
+    }
     sprintf(sz, "\n");
 }
 
@@ -544,7 +910,7 @@ BearoffDumpTwoSided(const bearoffcontext * pbc, const TanBoard anBoard, char *sz
 {
     unsigned int nUs = PositionBearoff(anBoard[1], pbc->nPoints, pbc->nChequers);
     unsigned int nThem = PositionBearoff(anBoard[0], pbc->nPoints, pbc->nChequers);
-    unsigned int n = Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints);
+    unsigned int n = pbc->nPositions;
     unsigned int iPos = nUs * n + nThem;
     float ar[4];
     const char *aszEquity[] = {
@@ -675,7 +1041,7 @@ BearoffDumpHyper(const bearoffcontext * pbc, const TanBoard anBoard, char *sz)
 {
     unsigned int nUs = PositionBearoff(anBoard[1], pbc->nPoints, pbc->nChequers);
     unsigned int nThem = PositionBearoff(anBoard[0], pbc->nPoints, pbc->nChequers);
-    unsigned int n = Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints);
+    unsigned int n = pbc->nPositions;
     unsigned int iPos = nUs * n + nThem;
     float ar[4];
     unsigned int i;
@@ -722,9 +1088,30 @@ BearoffClose(bearoffcontext * pbc)
     if (!pbc)
         return;
 
+    if (pbc->pWarmup) {
+        g_atomic_int_set(&pbc->fStopWarmup, TRUE);
+        g_thread_join(pbc->pWarmup);
+    }
+
     if (pbc->pf)
         fclose(pbc->pf);
 
+    if (pbc->apCache) {
+        int i;
+
+        for (i = 0; i <= (int) MT_GetMaxThreads(); ++i)
+            if (pbc->apCache[i]) {
+                int j;
+
+                for (j = 0; j < BEAROFF_BLOCK_CACHE_SIZE; ++j)
+                    g_free(pbc->apCache[i]->apusBlock[j]);
+                g_free(pbc->apCache[i]->puchBlock);
+                g_free(pbc->apCache[i]->abd);
+                g_free(pbc->apCache[i]);
+            }
+        g_free(pbc->apCache);
+    }
+
     if (pbc->map) {
         g_mapped_file_unref(pbc->map);
         pbc->p = NULL;
@@ -753,6 +1140,205 @@ ReadIntoMemory(bearoffcontext * pbc)
     return pbc->p;
 }
 
+/* The heuristic database takes a noticeable time to generate, so it is
+ * kept in the user's cache directory and mapped on later starts.  Bump
+ * HEURISTIC_VERSION whenever GenerateBearoff changes. */
+
+#define HEURISTIC_VERSION 1
+#define HEURISTIC_SIZE (40 + 54264 * 64)
+
+static void
+HeuristicHeader(char *sz)
+{
+    sprintf(sz, "gnubg-OH-%02d-%02d-0-0-%04dxxxxxxxxxxxxxxxx\n", HEURISTIC_P, HEURISTIC_C, HEURISTIC_VERSION);
+}
+
+static char *
+BearoffHeuristicCacheFile(void)
+{
+    return g_build_filename(g_get_user_cache_dir(), "gnubg", "gnubg_os0_heuristic.bd", NULL);
+}
+
+static unsigned char *
+LoadHeuristicDatabase(bearoffcontext * pbc, void (*pfProgress) (unsigned int))
+{
+    char *szFile = BearoffHeuristicCacheFile();
+    char sz[41];
+    unsigned char *p;
+    GError *error = NULL;
+
+    HeuristicHeader(sz);
+
+    if (g_file_test(szFile, G_FILE_TEST_IS_REGULAR)) {
+        pbc->szFilename = szFile;
+        if (ReadIntoMemory(pbc)) {
+            if (g_mapped_file_get_length(pbc->map) == HEURISTIC_SIZE && !memcmp(pbc->p, sz, 40))
+                return pbc->p;
+            g_mapped_file_unref(pbc->map);
+            pbc->map = NULL;
+            pbc->p = NULL;
+        }
+        pbc->szFilename = NULL;
+    }
+
+    if (!(p = HeuristicDatabase(pfProgress))) {
+        g_free(szFile);
+        return NULL;
+    }
+
+    memcpy(p, sz, 40);
+
+    /* a failure to save the database only costs the next start the time
+     * to generate it again */
+    {
+        char *szDir = g_path_get_dirname(szFile);
+
+        if (g_mkdir_with_parents(szDir, 0755) < 0 ||
+            !g_file_set_contents(szFile, (const char *) p, HEURISTIC_SIZE, &error)) {
+            if (error) {
+                g_debug("%s: %s", szFile, error->message);
+                g_error_free(error);
+            }
+            g_free(szFile);
+            szFile = NULL;
+        }
+        g_free(szDir);
+    }
+
+    pbc->szFilename = szFile;
+    return p;
+}
+
+static size_t
+PageSize(void)
+{
+#ifndef WIN32
+    long n = sysconf(_SC_PAGESIZE);
+
+    if (n > 0)
+        return (size_t) n;
+#endif
+    return 4096;
+}
+
+/* The part of a mapped database that nearly every lookup touches: the
+ * offset index of a compressed one-sided or block-compressed two-sided
+ * database, or all of it for the formats indexed directly by position. */
+
+static size_t
+BearoffHotSize(const bearoffcontext * pbc)
+{
+    size_t n = g_mapped_file_get_length(pbc->map);
+
+    if (pbc->fBlocked) {
+        size_t nIndex = 40 + 8 * ((size_t) BearoffBlockCount(pbc) + 1);
+
+        if (nIndex < n)
+            n = nIndex;
+    }
+
+    if (pbc->bt == BEAROFF_ONESIDED && pbc->fCompressed) {
+        size_t nIndex = 40 + (size_t) pbc->nPositions * pbc->nIndexEntrySize;
+
+        if (nIndex < n)
+            n = nIndex;
+    }
+
+    return n;
+}
+
+extern void
+BearoffAdvise(const bearoffcontext * pbc, bearoffadvice ba)
+{
+#if !defined(WIN32) && defined(MADV_RANDOM)
+    int advice;
+
+    if (!pbc || !pbc->map || !g_mapped_file_get_length(pbc->map))
+        return;
+
+    switch (ba) {
+    case BEAROFF_ADVICE_RANDOM:
+        advice = MADV_RANDOM;
+        break;
+    case BEAROFF_ADVICE_WILLNEED:
+        advice = MADV_WILLNEED;
+        break;
+    case BEAROFF_ADVICE_NORMAL:
+    default:
+        advice = MADV_NORMAL;
+        break;
+    }
+
+    if (madvise(pbc->p, g_mapped_file_get_length(pbc->map), advice) < 0)
+        g_printerr("%s: madvise: %s\n", pbc->szFilename, g_strerror(errno));
+#else
+    (void) pbc;
+    (void) ba;
+#endif
+}
+
+static gpointer
+BearoffWarmupThread(gpointer data)
+{
+    bearoffcontext *pbc = (bearoffcontext *) data;
+    size_t i, n = BearoffHotSize(pbc), nPage = PageSize();
+    volatile unsigned char uch = 0;
+
+    /* touch one byte per page */
+    for (i = 0; i < n && !g_atomic_int_get(&pbc->fStopWarmup); i += nPage)
+        uch ^= pbc->p[i];
+
+    return NULL;
+}
+
+extern void
+BearoffWarmup(bearoffcontext * pbc)
+{
+    if (!pbc || !pbc->map || pbc->pWarmup || !g_mapped_file_get_length(pbc->map))
+        return;
+
+#if GLIB_CHECK_VERSION (2,32,0)
+    pbc->pWarmup = g_thread_try_new("bearoff warmup", BearoffWarmupThread, pbc, NULL);
+#else
+    pbc->pWarmup = g_thread_create(BearoffWarmupThread, pbc, TRUE, NULL);
+#endif
+}
+
+/* Percentage of a mapped database currently in the page cache, or -1
+ * if it is not mapped or this cannot be determined. */
+
+extern float
+BearoffResident(const bearoffcontext * pbc)
+{
+#if !defined(WIN32)
+    size_t i, n, nPage, nPages, nResident = 0;
+    unsigned char *auch;
+
+    if (!pbc || !pbc->map || !(n = g_mapped_file_get_length(pbc->map)))
+        return -1.0f;
+
+    nPage = PageSize();
+    nPages = (n + nPage - 1) / nPage;
+    auch = g_malloc(nPages);
+
+    if (mincore(pbc->p, n, (void *) auch) < 0) {
+        g_free(auch);
+        return -1.0f;
+    }
+
+    for (i = 0; i < nPages; ++i)
+        if (auch[i] & 1)
+            ++nResident;
+
+    g_free(auch);
+
+    return 100.0f * (float) nResident / (float) nPages;
+#else
+    (void) pbc;
+    return -1.0f;
+#endif
+}
+
 /*
  * Check whether this is a exact bearoff file 
  *
@@ -803,7 +1389,9 @@ BearoffInit(const char *szFilename, const unsigned int bo, void (*p) (unsigned i
         pbc->nPoints = HEURISTIC_P;
         pbc->nChequers = HEURISTIC_C;
         pbc->fHeuristic = TRUE;
-        pbc->p = HeuristicDatabase(p);
+        pbc->nPositions = Combination(HEURISTIC_P + HEURISTIC_C, HEURISTIC_P);
+        pbc->apCache = g_new0(struct bearoffcache *, MT_GetMaxThreads() + 1);
+        pbc->p = LoadHeuristicDatabase(pbc, p);
         return pbc;
     }
 
@@ -853,6 +1441,10 @@ BearoffInit(const char *szFilename, const unsigned int bo, void (*p) (unsigned i
 
     if (!strncmp(sz + 6, "TS", 2))
         pbc->bt = BEAROFF_TWOSIDED;
+    else if (!strncmp(sz + 6, "TB", 2)) {
+        pbc->bt = BEAROFF_TWOSIDED;
+        pbc->fBlocked = TRUE;
+    }
     else if (!strncmp(sz + 6, "OS", 2))
         pbc->bt = BEAROFF_ONESIDED;
     else if (*(sz + 6) == 'H')
@@ -904,16 +1496,29 @@ BearoffInit(const char *szFilename, const unsigned int bo, void (*p) (unsigned i
         pbc->nChequers = (unsigned) atoi(sz + 7);
 
     }
+
+    pbc->nPositions = Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints);
+
     switch (pbc->bt) {
     case BEAROFF_TWOSIDED:
         /* options for two-sided dbs */
         pbc->fCubeful = atoi(sz + 15);
+        if (pbc->fBlocked) {
+            /* block size and format version */
+            pbc->nBlockSize = (unsigned) atoi(sz + 17);
+            if (pbc->nBlockSize < 1 || pbc->nBlockSize > BEAROFF_MAX_BLOCK_SIZE || atoi(sz + 22) != 1) {
+                g_printerr("%s: %s\n", szFilename, _("unsupported block-compressed bearoff database"));
+                InvalidDb(pbc);
+                return NULL;
+            }
+        }
         break;
     case BEAROFF_ONESIDED:
         /* options for one-sided dbs */
         pbc->fGammon = atoi(sz + 15);
         pbc->fCompressed = atoi(sz + 17);
         pbc->fND = atoi(sz + 19);
+        pbc->nIndexEntrySize = pbc->fGammon ? 8 : 6;
         break;
     case BEAROFF_HYPERGAMMON:
     case BEAROFF_INVALID:
@@ -936,6 +1541,18 @@ BearoffInit(const char *szFilename, const unsigned int bo, void (*p) (unsigned i
             }
     }
 
+    /* lookups on disk, in compressed blocks and of one-sided
+     * distributions go through a small per-thread cache */
+
+    if (!pbc->p || pbc->fBlocked || pbc->bt == BEAROFF_ONESIDED)
+        pbc->apCache = g_new0(struct bearoffcache *, MT_GetMaxThreads() + 1);
+
+    if (pbc->p) {
+        BearoffAdvise(pbc, baBearoff);
+        if (fBearoffWarmup)
+            BearoffWarmup(pbc);
+    }
+
     return pbc;
 }
 
@@ -1062,18 +1679,19 @@ GetDistCompressed(unsigned short int aus[64], const bearoffcontext * pbc, const
     unsigned char *puch;
     unsigned char ac[128];
     unsigned int iOffset;
+    size_t iData;
     unsigned int nBytes;
     unsigned int ioff, nz, ioffg = 0, nzg = 0;
-    unsigned int nPos = Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints);
-    unsigned int index_entry_size = pbc->fGammon ? 8 : 6;
+    unsigned int nPos = pbc->nPositions;
+    unsigned int index_entry_size = pbc->nIndexEntrySize;
 
     /* find offsets and no. of non-zero elements */
 
     if (pbc->p)
         /* database is in memory */
-        puch = pbc->p + 40 + nPosID * index_entry_size;
+        puch = pbc->p + 40 + (size_t) nPosID * index_entry_size;
     else {
-        ReadBearoffFile(pbc, 40 + nPosID * index_entry_size, ac, index_entry_size);
+        ReadBearoffFile(pbc, 40 + (size_t) nPosID * index_entry_size, ac, index_entry_size);
         puch = ac;
     }
 
@@ -1089,7 +1707,7 @@ GetDistCompressed(unsigned short int aus[64], const bearoffcontext * pbc, const
     }
     /* Sanity checks */
 
-    if ((iOffset > 64 * nPos && 64 * nPos > 0) || nz > 32 || ioff > 32 || nzg > 32 || ioffg > 32) {
+    if (((guint64) iOffset > 64 * (guint64) nPos && nPos > 0) || nz > 32 || ioff > 32 || nzg > 32 || ioffg > 32) {
         fprintf(stderr, _("The bearoff file '%s' is likely to be corrupted.\n"), pbc->szFilename);
 #if !defined(G_DISABLE_ASSERT)
         fprintf(stderr,
@@ -1101,9 +1719,9 @@ GetDistCompressed(unsigned short int aus[64], const bearoffcontext * pbc, const
 
     /* read prob + gammon probs */
 
-    iOffset = 40                /* the header */
-        + nPos * index_entry_size       /* the offset data */
-        + 2 * iOffset;          /* offset to current position */
+    iData = 40                  /* the header */
+        + (size_t) nPos * index_entry_size      /* the offset data */
+        + 2 * (size_t) iOffset; /* offset to current position */
 
     /* read values */
 
@@ -1113,10 +1731,10 @@ GetDistCompressed(unsigned short int aus[64], const bearoffcontext * pbc, const
 
     if (pbc->p)
         /* from memory */
-        puch = pbc->p + iOffset;
+        puch = pbc->p + iData;
     else {
         /* from disk */
-        ReadBearoffFile(pbc, iOffset, ac, nBytes);
+        ReadBearoffFile(pbc, iData, ac, nBytes);
         puch = ac;
 
     }
@@ -1131,11 +1749,11 @@ GetDistUncompressed(unsigned short int aus[64], const bearoffcontext * pbc, cons
 {
     unsigned char ac[128];
     unsigned char *puch;
-    unsigned int iOffset;
+    size_t iOffset;
 
     /* read from file */
 
-    iOffset = 40 + 64 * nPosID * (pbc->fGammon ? 2 : 1);
+    iOffset = 40 + 64 * (size_t) nPosID * (pbc->fGammon ? 2 : 1);
 
     if (pbc->p)
         /* from memory */
@@ -1161,6 +1779,20 @@ ReadBearoffOneSidedExact(const bearoffcontext * pbc, const unsigned int nPosID,
 {
     unsigned short int aus[64];
     unsigned short int *pus = NULL;
+    struct bearoffcache *pcache = BearoffThreadCache(pbc);
+    bearoffdist *pbd = NULL;
+
+    if (pcache) {
+        if (!pcache->abd)
+            pcache->abd = g_new0(bearoffdist, BEAROFF_DIST_CACHE_SIZE);
+        pbd = pcache->abd + nPosID % BEAROFF_DIST_CACHE_SIZE;
+
+        if (pbd->nKey == nPosID + 1) {
+            ++pcache->nHits;
+            goto copy;
+        }
+        ++pcache->nMisses;
+    }
 
     /* get distribution */
     if (pbc->fCompressed)
@@ -1170,10 +1802,33 @@ ReadBearoffOneSidedExact(const bearoffcontext * pbc, const unsigned int nPosID,
 
     if (!pus) {
         printf(_("Error decoding one-sided bearoff database entry; position %u\n"), nPosID);
+        if (pbd)
+            pbd->nKey = 0;
         return -1;
     }
 
-    AssignOneSided(arProb, arGammonProb, ar, ausProb, ausGammonProb, pus, pus + 32);
+    if (!pbd) {
+        AssignOneSided(arProb, arGammonProb, ar, ausProb, ausGammonProb, pus, pus + 32);
+        return 0;
+    }
+
+    /* decode everything once, for whatever later callers ask for */
+
+    memcpy(pbd->aus, pus, sizeof(pbd->aus));
+    AssignOneSided(pbd->arProb, pbd->arGammonProb, pbd->ar, NULL, NULL, pus, pus + 32);
+    pbd->nKey = nPosID + 1;
+
+  copy:
+    if (arProb)
+        memcpy(arProb, pbd->arProb, sizeof(pbd->arProb));
+    if (arGammonProb)
+        memcpy(arGammonProb, pbd->arGammonProb, sizeof(pbd->arGammonProb));
+    if (ar)
+        memcpy(ar, pbd->ar, sizeof(pbd->ar));
+    if (ausProb)
+        memcpy(ausProb, pbd->aus, 32 * sizeof(unsigned short int));
+    if (ausGammonProb)
+        memcpy(ausGammonProb, pbd->aus + 32, 32 * sizeof(unsigned short int));
 
     return 0;
 }
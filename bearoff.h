@@ -32,23 +32,42 @@ typedef enum {
     BEAROFF_HYPERGAMMON
 } bearofftype;
 
+struct bearoffcache;
+
 typedef struct {
     bearofftype bt;             /* type of bearoff database */
     unsigned int nPoints;       /* number of points covered by database */
     unsigned int nChequers;     /* number of chequers for one-sided database */
+    unsigned int nPositions;    /* number of one-sided positions */
     /* one sided dbs */
     int fCompressed;            /* is database compressed? */
     int fGammon;                /* gammon probs included */
     int fND;                    /* normal distibution instead of exact dist? */
+    unsigned int nIndexEntrySize;       /* bytes per index entry if compressed */
     int fHeuristic;             /* heuristic database? */
     /* two sided dbs */
     int fCubeful;               /* cubeful equities included */
+    int fBlocked;               /* stored in compressed blocks? */
+    unsigned int nBlockSize;    /* positions per block */
     FILE *pf;                   /* file pointer */
     char *szFilename;           /* filename */
     GMappedFile *map;
     unsigned char *p;           /* pointer to data in memory */
+    struct bearoffcache **apCache;      /* per-thread record caches for on-disk dbs */
+    GThread *pWarmup;           /* background thread faulting in the mapping */
+    int fStopWarmup;
 } bearoffcontext;
 
+typedef enum {
+    BEAROFF_ADVICE_NORMAL,
+    BEAROFF_ADVICE_RANDOM,
+    BEAROFF_ADVICE_WILLNEED
+} bearoffadvice;
+
+extern bearoffadvice baBearoff;
+extern const char *aszBearoffAdvice[];
+extern int fBearoffWarmup;
+
 enum bearoffoptions {
     BO_NONE = 0,
     BO_IN_MEMORY = 1,
@@ -80,6 +99,22 @@ extern int
 
 extern void BearoffClose(bearoffcontext * pbc);
 
+extern void BearoffAdvise(const bearoffcontext * pbc, bearoffadvice ba);
+
+extern void BearoffWarmup(bearoffcontext * pbc);
+
+extern float BearoffResident(const bearoffcontext * pbc);
+
+/* largest number of positions in a block of a block-compressed
+ * two-sided database */
+#define BEAROFF_MAX_BLOCK_SIZE 4096
+
+/* bound on the encoded size of a block of n 16-bit values */
+#define BEAROFF_BLOCK_BYTES(n) (3 * (n))
+
+extern size_t
+ BearoffEncodeBlock(const unsigned short int aus[], unsigned int nPositions, unsigned int k, unsigned char *puch);
+
 extern int
  isBearoff(const bearoffcontext * pbc, const TanBoard anBoard);
 
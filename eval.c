@@ -575,12 +575,16 @@ weights_failed(char *filename, FILE * weights)
     return 0;
 }
 
+double rEvalBearoffTime = 0.0;
+double rEvalWeightsTime = 0.0;
+
 extern void
 EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pfProgress) (unsigned int))
 {
     FILE *pfWeights = NULL;
     int i, fReadWeights = FALSE;
     static int fInitialised = FALSE;
+    GTimer *pt;
 #if defined(USE_SIMD_INSTRUCTIONS)
     int simderror = TRUE;
 #endif
@@ -638,6 +642,8 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
         fInitialised = TRUE;
     }
 
+    pt = g_timer_new();
+
     if (!fNoBearoff) {
         char *gnubg_bearoff;
         char *gnubg_bearoff_os;
@@ -687,6 +693,9 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
 
     }
 
+    rEvalBearoffTime = g_timer_elapsed(pt, NULL);
+    g_timer_start(pt);
+
     if (szWeightsBinary) {
         pfWeights = g_fopen(szWeightsBinary, "rb");
         if (!binary_weights_failed(szWeightsBinary, pfWeights)) {
@@ -739,6 +748,8 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
         exit(EXIT_FAILURE);
     }
 
+    rEvalWeightsTime = g_timer_elapsed(pt, NULL);
+    g_timer_destroy(pt);
 }
 
 /* Calculates inputs for any contact position, for one player only. */
@@ -5495,6 +5506,8 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
     } else {
         /* at leaf node; use static evaluation */
 
+        MT_GetTLD()->pStats->cEvaluations++;
+
         if (acef[pc] (anBoard, arOutput, pci->bgv, nnStates))
             return -1;
 
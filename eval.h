@@ -344,6 +344,10 @@ extern classevalfunc acef[N_CLASSES];
      ( ( (pci)->fCubeOwner == (pci)->fMove ) ? arEquity[ 0 ] : arEquity[ 3 ] ) )
 
 extern void EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pfProgress) (unsigned int));
+/* seconds the last EvalInitialise() spent loading the bearoff databases
+ * and the neural net weights */
+extern double rEvalBearoffTime;
+extern double rEvalWeightsTime;
 
 extern int EvalShutdown(void);
 
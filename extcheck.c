@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2022 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+/*
+ * Check that the fast path for board commands (extfast.c) agrees with
+ * the grammar (external_l.l, external_y.y).  Random and mutated board and
+ * "evaluation fibsboard" commands are given to both; whenever the fast
+ * path accepts one, the grammar must accept it too and fill the scan
+ * context in the same way.
+ *
+ *   extcheck [commands [seed]]
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include "external.h"
+#include "glib-ext.h"
+
+#define EXTCHECK_COMMANDS 200000
+#define EXTCHECK_SEED 20221018
+
+/* the grammar and the fast path read the default of the Jacoby rule */
+int fJacoby = TRUE;
+
+static const char *aszName[] = {
+    "gnubg", "You", "player_1", "X", "abc123", "123", "\"quoted name\"", "'q'", "", "a-b"
+};
+
+static const char *aszElement[] = {
+    "+3", "-0", "0007", "123456789", "1234567890", "99999999999", "1.5", ".5", "", "x", "-"
+};
+
+static const char *aszOption[] = {
+    "jacobyrule on", "jacobyrule off", "jacobyrule yes", "crawfordrule false", "crawfordrule true",
+    "beavers no", "beavers on", "resignation 0", "resignation 2", "resignation -1", "plies 0",
+    "plies 2", "Plies 1", "noise 0.05", "noise 250", "noise -.1e2", "cube on", "cube off", "cubeful",
+    "cubeless", "prune", "PRUNE", "prune off", "prune yes", "deterministic", "deterministic no",
+    "deterministic on"
+};
+
+/* options the fast path leaves to the grammar */
+static const char *aszOddOption[] = {
+    "crawfordrule 1", "plies 1.5", "plies", "noise 1e2", "noise", "filter", "junk", "'quoted'", "("
+};
+
+static const char *aszWhite[] = { " ", " ", " ", "  ", "\t", "\r" };
+
+static const char szMutation[] = " :\t-+.0123456789abeonfy\"'(";
+
+static void
+ErrorHandler(scancontext * pec, const char *UNUSED(szMessage))
+{
+    pec->fError = TRUE;
+}
+
+static const char *
+Pick(GRand * pr, const char **asz, int c)
+{
+    return asz[g_rand_int_range(pr, 0, c)];
+}
+
+static void
+AddBoard(GRand * pr, GString * gs)
+{
+    int i, c;
+
+    g_string_append(gs, g_rand_int_range(pr, 0, 8) ? "board:" : "BoArD:");
+
+    for (i = 0; i < 2; i++) {
+        if (g_rand_int_range(pr, 0, 4))
+            g_string_append(gs, i ? "gnubg" : "You");
+        else
+            g_string_append(gs, Pick(pr, aszName, G_N_ELEMENTS(aszName)));
+        g_string_append_c(gs, ':');
+    }
+
+    /* a FIBS board has 50 elements, the grammar takes up to 50 */
+    c = g_rand_int_range(pr, 0, 4) ? 50 : g_rand_int_range(pr, 0, 54);
+    for (i = 0; i < c; i++) {
+        if (i)
+            g_string_append_c(gs, ':');
+        if (g_rand_int_range(pr, 0, 400))
+            g_string_append_printf(gs, "%d", g_rand_int_range(pr, -15, 26));
+        else
+            g_string_append(gs, Pick(pr, aszElement, G_N_ELEMENTS(aszElement)));
+    }
+}
+
+static void
+MakeCommand(GRand * pr, GString * gs)
+{
+    int i, c;
+
+    g_string_truncate(gs, 0);
+
+    switch (g_rand_int_range(pr, 0, 8)) {
+    case 0:
+        g_string_append(gs, "evaluation fibsboard ");
+        break;
+    case 1:
+        g_string_append(gs, "Evaluation\tFIBSboard  ");
+        break;
+    case 2:
+        g_string_append(gs, " ");
+        break;
+    default:
+        break;
+    }
+
+    AddBoard(pr, gs);
+
+    c = g_rand_int_range(pr, 0, 6);
+    for (i = 0; i < c; i++) {
+        g_string_append(gs, Pick(pr, aszWhite, G_N_ELEMENTS(aszWhite)));
+        if (g_rand_int_range(pr, 0, 20))
+            g_string_append(gs, Pick(pr, aszOption, G_N_ELEMENTS(aszOption)));
+        else
+            g_string_append(gs, Pick(pr, aszOddOption, G_N_ELEMENTS(aszOddOption)));
+    }
+
+    switch (g_rand_int_range(pr, 0, 6)) {
+    case 0:
+        break;
+    case 1:
+        g_string_append(gs, " ");
+        break;
+    case 2:
+        g_string_append(gs, "\r\n");
+        break;
+    default:
+        g_string_append_c(gs, '\n');
+        break;
+    }
+
+    /* mutate a third of the commands */
+    if (!g_rand_int_range(pr, 0, 3)) {
+        c = g_rand_int_range(pr, 1, 4);
+        for (i = 0; i < c && gs->len; i++) {
+            guint ich = (guint) g_rand_int_range(pr, 0, (gint32) gs->len);
+            char ch = szMutation[g_rand_int_range(pr, 0, sizeof(szMutation) - 1)];
+
+            switch (g_rand_int_range(pr, 0, 4)) {
+            case 0:
+                g_string_erase(gs, ich, 1);
+                break;
+            case 1:
+                g_string_insert_c(gs, ich, ch);
+                break;
+            case 2:
+                gs->str[ich] = ch;
+                break;
+            default:
+                g_string_insert_c(gs, ich, gs->str[ich]);
+                break;
+            }
+        }
+    }
+}
+
+static void
+ClearContext(scancontext * pec)
+{
+    if (pec->bi.gsName)
+        g_string_free(pec->bi.gsName, TRUE);
+    if (pec->bi.gsOpp)
+        g_string_free(pec->bi.gsOpp, TRUE);
+    if (pec->pCmdData)
+        g_value_unsetfree(pec->pCmdData);
+
+    pec->fError = FALSE;
+    pec->ct = COMMAND_NONE;
+    pec->pCmdData = NULL;
+    pec->nPlies = -1;
+    pec->rNoise = -1.0f;
+    pec->fDeterministic = -1;
+    pec->fCubeful = -1;
+    pec->fUsePrune = -1;
+    pec->fEvalOptions = ~0u;
+    pec->fJacobyRule = -1;
+    pec->fCrawfordRule = -1;
+    pec->nResignation = -1;
+    pec->fBeavers = -1;
+    memset(&pec->bi, 0, sizeof(pec->bi));
+}
+
+/* returns NULL if both agree, or what differs */
+static const char *
+Compare(const scancontext * pecFast, const scancontext * pec)
+{
+    if (pec->fError)
+        return "the grammar rejects it";
+    if (pecFast->ct != pec->ct)
+        return "command type";
+    if (memcmp(pecFast->anList, pec->anList, sizeof(pec->anList)))
+        return "board";
+    if (!pec->bi.gsName || strcmp(pecFast->bi.gsName->str, pec->bi.gsName->str))
+        return "player name";
+    if (!pec->bi.gsOpp || strcmp(pecFast->bi.gsOpp->str, pec->bi.gsOpp->str))
+        return "opponent name";
+    if (pecFast->nPlies != pec->nPlies)
+        return "plies";
+    if (pecFast->rNoise != pec->rNoise)
+        return "noise";
+    if (pecFast->fDeterministic != pec->fDeterministic)
+        return "deterministic";
+    if (pecFast->fCubeful != pec->fCubeful)
+        return "cubeful";
+    if (pecFast->fUsePrune != pec->fUsePrune)
+        return "prune";
+    if (pecFast->fEvalOptions != pec->fEvalOptions)
+        return "options given";
+    if (pecFast->fJacobyRule != pec->fJacobyRule)
+        return "Jacoby rule";
+    if (pecFast->fCrawfordRule != pec->fCrawfordRule)
+        return "Crawford rule";
+    if (pecFast->nResignation != pec->nResignation)
+        return "resignation";
+    if (pecFast->fBeavers != pec->fBeavers)
+        return "beavers";
+
+    return NULL;
+}
+
+extern int
+main(int argc, char *argv[])
+{
+    scancontext ecFast, ec;
+    GString *gs = g_string_new(NULL);
+    GRand *pr;
+    int cCommands = argc > 1 ? atoi(argv[1]) : EXTCHECK_COMMANDS;
+    guint32 nSeed = argc > 2 ? (guint32) strtoul(argv[2], NULL, 10) : EXTCHECK_SEED;
+    int i, cFast = 0, cFailed = 0;
+
+#if ! GLIB_CHECK_VERSION(2,36,0)
+    g_type_init();
+#endif
+
+    memset(&ecFast, 0, sizeof(ecFast));
+    memset(&ec, 0, sizeof(ec));
+    if (ExtInitParse((void **) &ec)) {
+        fputs("extcheck: cannot start the parser\n", stderr);
+        return 99;
+    }
+    ec.ExtErrorHandler = ErrorHandler;
+
+    pr = g_rand_new_with_seed(nSeed);
+
+    for (i = 0; i < cCommands; i++) {
+        const char *szDiff;
+
+        MakeCommand(pr, gs);
+        ClearContext(&ecFast);
+        ClearContext(&ec);
+
+        if (!ExtFastParse(&ecFast, gs->str))
+            continue;
+
+        cFast++;
+        ExtStartParse(ec.scanner, gs->str);
+
+        if ((szDiff = Compare(&ecFast, &ec))) {
+            g_strdelimit(gs->str, "\r\n", ' ');
+            printf("%s: %s\n", szDiff, gs->str);
+            cFailed++;
+        }
+    }
+
+    printf("%d of %d commands taken by the fast path, %d differ from the grammar (seed %u)\n",
+           cFast, cCommands, cFailed, nSeed);
+
+    ClearContext(&ecFast);
+    ClearContext(&ec);
+    ExtDestroyParse(ec.scanner);
+    g_rand_free(pr);
+    g_string_free(gs, TRUE);
+
+    return cFailed || !cFast;
+}
@@ -42,6 +42,7 @@
 
 #if HAVE_SYS_SOCKET_H
 #include <sys/types.h>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -49,6 +50,12 @@
 #include <sys/un.h>
 #endif                          /* #if HAVE_SYS_SOCKET_H */
 
+#include <fcntl.h>
+#include <sys/wait.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+
 #else                           /* #ifndef WIN32 */
 
 #include <winsock2.h>
@@ -118,9 +125,256 @@
 #include "drawboard.h"
 #include "external.h"
 #include "rollout.h"
+#include "rolloutqueue.h"
 #include "eval.h"
 #include "matchid.h"
+#include "matchequity.h"
+#include "positionid.h"
 #include "lib/gnubg-types.h"
+#include "multithread.h"
+
+/* see "set external" */
+unsigned int cExternalMaxConnections = 16;
+unsigned int cExternalQueueLimit = 64;
+unsigned int cExternalCacheSize = 4096;
+
+/*
+ * The decision cache: the answers to board requests, most recently
+ * used first, keyed by the position and everything about the match and
+ * the request that the answer depends on.  The global evaluation
+ * settings, the match equity table and the session defaults are the
+ * same for every request, so rather than being part of the key they are
+ * remembered with the cache, which is emptied when they change; what a
+ * request sets for itself is in the key.
+ * Evaluations with non-deterministic noise are not cached.
+ */
+
+typedef struct {
+    positionkey key;
+    int anDice[2];
+    int nCube, fCubeOwner, nMatchTo, anScore[2];
+    int fCrawford, fJacoby, fDoubled, nResignation, nPlies;
+    /* the request's own settings */
+    unsigned int fEvalOptions;
+    int fCubeful, fUsePrune, fDeterministic;
+    float rNoise;
+    int nFilter;
+} extcachekey;
+
+typedef struct {
+    extcachekey k;
+    char *szResponse;
+    GList l;                    /* in qExtCache */
+} extcacheentry;
+
+typedef struct {
+    evalsetup esChequer, esCube, esResign;
+    TmoveFilter aamf;
+    unsigned int nBeavers;
+    bgvariation bgv;
+    unsigned int nMETGeneration;
+    int fCubeUse, fJacoby, fAutoCrawford;
+} extcachesettings;
+
+static GHashTable *phExtCache;
+static GQueue qExtCache = G_QUEUE_INIT;
+static extcachesettings ecsExtCache;
+static unsigned long cExtCacheHits, cExtCacheMisses;
+#if defined(USE_MULTITHREAD)
+static Mutex mutexExtCache;
+#define ExtCacheLock() Mutex_Lock(&mutexExtCache)
+#define ExtCacheUnlock() Mutex_Release(&mutexExtCache)
+#else
+#define ExtCacheLock()
+#define ExtCacheUnlock()
+#endif
+
+/* drop the least recently used entries; the lock must be held */
+static void
+ExtCacheTrim(unsigned int cEntries)
+{
+    GList *pl;
+
+    while (qExtCache.length > cEntries && (pl = g_queue_pop_tail_link(&qExtCache))) {
+        extcacheentry *pe = pl->data;
+
+        g_hash_table_remove(phExtCache, &pe->k);
+        g_free(pe->szResponse);
+        g_free(pe);
+    }
+}
+
+#if HAVE_SOCKETS
+static guint
+ExtCacheHash(gconstpointer p)
+{
+    const unsigned char *pch = p;
+    guint h = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(extcachekey); i++)
+        h = h * 31 + pch[i];
+
+    return h;
+}
+
+static gboolean
+ExtCacheEqual(gconstpointer p0, gconstpointer p1)
+{
+    return !memcmp(p0, p1, sizeof(extcachekey));
+}
+
+static void
+ExtCacheInit(void)
+{
+    if (phExtCache)
+        return;
+
+    phExtCache = g_hash_table_new(ExtCacheHash, ExtCacheEqual);
+#if defined(USE_MULTITHREAD)
+    InitMutex(&mutexExtCache);
+#endif
+}
+
+
+/* empty the cache if the settings have changed; the lock must be held */
+static void
+ExtCacheCheckSettings(void)
+{
+    extcachesettings ecs;
+
+    memset(&ecs, 0, sizeof(ecs));
+    memcpy(&ecs.esChequer, GetEvalChequer(), sizeof(evalsetup));
+    memcpy(&ecs.esCube, GetEvalCube(), sizeof(evalsetup));
+    memcpy(&ecs.esResign, &esEvalCube, sizeof(evalsetup));
+    memcpy(ecs.aamf, *GetEvalMoveFilter(), sizeof(TmoveFilter));
+    ecs.nBeavers = nBeavers;
+    ecs.bgv = bgvDefault;
+    ecs.nMETGeneration = nMETGeneration;
+    ecs.fCubeUse = fCubeUse;
+    ecs.fJacoby = fJacoby;
+    ecs.fAutoCrawford = fAutoCrawford;
+
+    if (memcmp(&ecs, &ecsExtCache, sizeof(ecs))) {
+        ExtCacheTrim(0);
+        ecsExtCache = ecs;
+    }
+}
+
+/* fills in the key; returns FALSE if the answer must not be cached */
+static int
+ExtCacheKey(extcachekey * pk, const ProcessedFIBSBoard * pbd, const scancontext * pec,
+            const evalsetup * pesChequer, const evalsetup * pesCube, const evalsetup * pesResign)
+{
+    const evalsetup *apes[3];
+    int i;
+
+    apes[0] = pesChequer;
+    apes[1] = pesCube;
+    apes[2] = pesResign;
+    for (i = 0; i < 3; i++)
+        if (apes[i]->ec.rNoise != 0.0f && !apes[i]->ec.fDeterministic)
+            return FALSE;
+
+    memset(pk, 0, sizeof(*pk));
+    PositionKey((ConstTanBoard) pbd->anBoard, &pk->key);
+    pk->anDice[0] = pbd->anDice[0];
+    pk->anDice[1] = pbd->anDice[1];
+    pk->nCube = pbd->nCube;
+    pk->fCubeOwner = pbd->fCubeOwner;
+    pk->nMatchTo = pbd->nMatchTo;
+    pk->anScore[0] = pbd->nScore;
+    pk->anScore[1] = pbd->nScoreOpp;
+    pk->fCrawford = pbd->fCrawford;
+    pk->fJacoby = pbd->fJacoby;
+    pk->fDoubled = pbd->fDoubled;
+    pk->nResignation = pec->nResignation;
+    pk->nPlies = pec->nPlies;
+    pk->fEvalOptions = pec->fEvalOptions;
+    if (pec->fEvalOptions) {
+        pk->fCubeful = pec->fCubeful;
+        pk->fUsePrune = pec->fUsePrune;
+        pk->fDeterministic = pec->fDeterministic;
+        pk->rNoise = pec->rNoise;
+    }
+    pk->nFilter = pec->nFilter;
+
+    return cExternalCacheSize > 0;
+}
+
+/* a copy of the cached answer, or NULL */
+static char *
+ExtCacheLookup(const extcachekey * pk)
+{
+    extcacheentry *pe;
+    char *sz = NULL;
+
+    if (!phExtCache)
+        return NULL;
+
+    ExtCacheLock();
+    ExtCacheCheckSettings();
+    if ((pe = g_hash_table_lookup(phExtCache, pk))) {
+        g_queue_unlink(&qExtCache, &pe->l);
+        g_queue_push_head_link(&qExtCache, &pe->l);
+        sz = g_strdup(pe->szResponse);
+        cExtCacheHits++;
+    } else
+        cExtCacheMisses++;
+    ExtCacheUnlock();
+
+    return sz;
+}
+
+static void
+ExtCacheStore(const extcachekey * pk, const char *szResponse)
+{
+    extcacheentry *pe;
+
+    if (!szResponse || !phExtCache)
+        return;
+
+    ExtCacheLock();
+    ExtCacheCheckSettings();
+    if (!g_hash_table_lookup(phExtCache, pk)) {
+        pe = g_new0(extcacheentry, 1);
+        pe->k = *pk;
+        pe->szResponse = g_strdup(szResponse);
+        pe->l.data = pe;
+        g_hash_table_insert(phExtCache, &pe->k, pe);
+        g_queue_push_head_link(&qExtCache, &pe->l);
+        ExtCacheTrim(cExternalCacheSize);
+    }
+    ExtCacheUnlock();
+}
+#endif                          /* HAVE_SOCKETS */
+
+extern void
+ExternalCacheResize(void)
+{
+    if (!phExtCache)
+        return;
+
+    ExtCacheLock();
+    ExtCacheTrim(cExternalCacheSize);
+    ExtCacheUnlock();
+}
+
+extern void
+ExternalCacheStats(unsigned int *pcEntries, unsigned long *pcHits, unsigned long *pcMisses)
+{
+    if (!phExtCache) {
+        *pcEntries = 0;
+        *pcHits = *pcMisses = 0;
+        return;
+    }
+
+    ExtCacheLock();
+    *pcEntries = qExtCache.length;
+    *pcHits = cExtCacheHits;
+    *pcMisses = cExtCacheMisses;
+    ExtCacheUnlock();
+}
 
 #if HAVE_SOCKETS
 
@@ -202,6 +456,9 @@ ExternalSocket(struct sockaddr **ppsa, socklen_t *pcb, char *sz)
 #endif                          /* HAVE_SOCKETS */
 
 #if HAVE_SOCKETS
+/* Read one line into pch.  Only the bytes up to the newline are taken
+ * from the socket, so that whatever the peer sent after it is left for
+ * the next call; a line too long for pch is split. */
 extern int
 ExternalRead(int h, char *pch, size_t cch)
 {
@@ -214,7 +471,7 @@ ExternalRead(int h, char *pch, size_t cch)
     int n;
 #endif
 
-    while (cch) {
+    while (cch > 1) {
         ProcessEvents();
 
         if (fInterrupt)
@@ -225,12 +482,21 @@ ExternalRead(int h, char *pch, size_t cch)
 #endif
 
 #ifdef WIN32
-        /* reading from sockets doesn't work on Windows
-         * use recv instead */
-        n = recv((SOCKET) h, p, cch, 0);
+        n = recv((SOCKET) h, p, cch - 1, MSG_PEEK);
+#else
+        n = recv(h, p, cch - 1, MSG_PEEK);
+#endif
+
+        if (n > 0) {
+            if ((pEnd = memchr(p, '\n', (size_t) n)))
+                n = pEnd - p + 1;
+            /* take what we looked at; it cannot block */
+#ifdef WIN32
+            n = recv((SOCKET) h, p, n, 0);
 #else
-        n = read(h, p, cch);
+            n = recv(h, p, (size_t) n, 0);
 #endif
+        }
 
 #ifndef WIN32
         PortableSignalRestore(SIGPIPE, &sh);
@@ -257,7 +523,7 @@ ExternalRead(int h, char *pch, size_t cch)
 
     }
 
-    p[cch - 1] = 0;
+    *p = 0;
     return 0;
 }
 
@@ -346,13 +612,72 @@ ErrorHandler(scancontext * pScanCtx, const char *szMessage)
     pScanCtx->szError = g_strdup_printf("Error: %s\n", szMessage);
 }
 
+/*
+ * "filter <preset>" and "deadline <ms>" may follow a board.  The scanner
+ * knows neither, so they are taken out of the command (overwritten with
+ * blanks) before it is parsed.
+ */
+
+static int
+ExtRequestOptions(scancontext * pec, char *szCommand)
+{
+    const char *pch = szCommand, *pchWord;
+    size_t cch;
+    int fBoard = FALSE;
+
+    pec->nFilter = -1;
+    pec->msDeadline = 0;
+
+    while ((pchWord = FastWord(&pch, &cch))) {
+        const char *pchValue;
+        size_t cchValue;
+        int i;
+
+        if (cch > 6 && !g_ascii_strncasecmp(pchWord, "board:", 6)) {
+            fBoard = TRUE;
+            continue;
+        } else if (!fBoard || (!FastWordIs(pchWord, cch, "filter") && !FastWordIs(pchWord, cch, "deadline")))
+            continue;
+
+        if (!(pchValue = FastWord(&pch, &cchValue))) {
+            ErrorHandler(pec, "filter and deadline need a value");
+            return FALSE;
+        }
+
+        if (FastWordIs(pchWord, cch, "filter")) {
+            for (i = 0; i < NUM_MOVEFILTER_SETTINGS; i++)
+                if (FastWordIs(pchValue, cchValue, aszMoveFilterSettings[i]))
+                    break;
+            if (i == NUM_MOVEFILTER_SETTINGS) {
+                ErrorHandler(pec, "filter must be tiny, narrow, normal, large or huge");
+                return FALSE;
+            }
+            pec->nFilter = i;
+        } else if (!FastInteger(pchValue, cchValue, &pec->msDeadline) || pec->msDeadline < 0) {
+            ErrorHandler(pec, "deadline must be a number of milliseconds");
+            return FALSE;
+        }
+
+        memset(szCommand + (pchWord - szCommand), ' ', (size_t) (pch - pchWord));
+    }
+
+    return TRUE;
+}
+
 static scancontext *
-ExtParse(scancontext * scanctx, const char *szCommand)
+ExtParse(scancontext * scanctx, char *szCommand)
 {
     scanctx->ExtErrorHandler = ErrorHandler;
     scanctx->fError = FALSE;
     scanctx->szError = NULL;
 
+    if (!ExtRequestOptions(scanctx, szCommand))
+        return NULL;
+
+    /* the debug output wants the grammar's view of the command */
+    if (!scanctx->fDebug && ExtFastParse(scanctx, szCommand))
+        return scanctx;
+
     ExtStartParse(scanctx->scanner, szCommand);
     return scanctx->fError ? NULL : scanctx;
 }
@@ -407,8 +732,40 @@ ExtEvaluation(scancontext * pec)
     return szResponse;
 }
 
+/* a copy of *pesGlobal with the options given on the board command
+ * applied; any of them means a plain evaluation */
+
+static void
+ExtEvalSetup(evalsetup * pes, const evalsetup * pesGlobal, const scancontext * pec)
+{
+    *pes = *pesGlobal;
+
+    if (!pec->fEvalOptions)
+        return;
+
+    pes->et = EVAL_EVAL;
+    if (pec->fEvalOptions & EXT_OPTION_PLIES)
+        pes->ec.nPlies = (unsigned int) pec->nPlies;
+    if (pec->fEvalOptions & EXT_OPTION_CUBEFUL)
+        pes->ec.fCubeful = pec->fCubeful ? 1 : 0;
+    if (pec->fEvalOptions & EXT_OPTION_NOISE)
+        pes->ec.rNoise = pec->rNoise;
+    if (pec->fEvalOptions & EXT_OPTION_PRUNE)
+        pes->ec.fUsePrune = pec->fUsePrune ? 1 : 0;
+    if (pec->fEvalOptions & EXT_OPTION_DETERMINISTIC)
+        pes->ec.fDeterministic = pec->fDeterministic ? 1 : 0;
+}
+
+/* a request with a deadline ("deadline <ms>") is answered with an error
+ * rather than evaluated once the deadline has passed */
+static int
+ExtDeadlinePassed(gint64 tDeadline)
+{
+    return tDeadline && g_get_monotonic_time() > tDeadline;
+}
+
 static char *
-ExtFIBSBoard(scancontext * pec)
+ExtFIBSBoard(scancontext * pec, gint64 tDeadline)
 {
     ProcessedFIBSBoard processedBoard;
     TanBoard anBoardOrig;
@@ -417,6 +774,10 @@ ExtFIBSBoard(scancontext * pec)
     rolloutstat aarsStatistics[2][2];
     cubeinfo ci;
     char *szResponse;
+    extcachekey k;
+    evalsetup esChequer, esCube, esResign;
+    TmoveFilter *paamf;
+    int fCache;
 
     if (ProcessFIBSBoardInfo(&pec->bi, &processedBoard))
         return g_strdup_printf("Error: badly formed board\n");
@@ -438,6 +799,16 @@ ExtFIBSBoard(scancontext * pec)
 
     memcpy(anBoardOrig, processedBoard.anBoard, sizeof(processedBoard.anBoard));
 
+    /* the request's own settings, so that no global needs changing */
+    ExtEvalSetup(&esChequer, GetEvalChequer(), pec);
+    ExtEvalSetup(&esCube, GetEvalCube(), pec);
+    ExtEvalSetup(&esResign, &esEvalCube, pec);
+    paamf = pec->nFilter >= 0 ? &aaamfMoveFilterSettings[pec->nFilter] : GetEvalMoveFilter();
+
+    fCache = ExtCacheKey(&k, &processedBoard, pec, &esChequer, &esCube, &esResign);
+    if (fCache && (szResponse = ExtCacheLookup(&k)))
+        return szResponse;
+
     if (processedBoard.fDoubled) {
         /* take decision */
 
@@ -447,8 +818,11 @@ ExtFIBSBoard(scancontext * pec)
         SetCubeInfo(&ci, processedBoard.nCube, processedBoard.fCubeOwner, fTurn, processedBoard.nMatchTo, anScore,
                     processedBoard.fCrawford, processedBoard.fJacoby, nBeavers, bgvDefault);
 
+        if (ExtDeadlinePassed(tDeadline))
+            return g_strdup("Error: deadline exceeded\n");
+
         if (GeneralCubeDecision(aarOutput, aarStdDev,
-                                aarsStatistics, (ConstTanBoard) processedBoard.anBoard, &ci, GetEvalCube(), NULL,
+                                aarsStatistics, (ConstTanBoard) processedBoard.anBoard, &ci, &esCube, NULL,
                                 NULL) < 0)
             return NULL;
 
@@ -496,7 +870,7 @@ ExtFIBSBoard(scancontext * pec)
         float rEqBefore, rEqAfter;
         const float epsilon = 1.0e-6f;
 
-        getResignation(arOutput, processedBoard.anBoard, &ci, &esEvalCube);
+        getResignation(arOutput, processedBoard.anBoard, &ci, &esResign);
 
         getResignEquities(arOutput, &ci, pec->nResignation, &rEqBefore, &rEqAfter);
 
@@ -509,16 +883,23 @@ ExtFIBSBoard(scancontext * pec)
     } else if (processedBoard.anDice[0]) {
         /* move */
         char szMove[FORMATEDMOVESIZE];
+
+        if (ExtDeadlinePassed(tDeadline))
+            return g_strdup("Error: deadline exceeded\n");
+
         if (FindBestMove(anMove, processedBoard.anDice[0], processedBoard.anDice[1],
-                         processedBoard.anBoard, &ci, &GetEvalChequer()->ec, *GetEvalMoveFilter()) < 0)
+                         processedBoard.anBoard, &ci, &esChequer.ec, *paamf) < 0)
             return NULL;
 
         FormatMovePlain(szMove, (ConstTanBoard)anBoardOrig, anMove);
         szResponse = g_strconcat(szMove, "\n", NULL);
     } else {
         /* double decision */
+        if (ExtDeadlinePassed(tDeadline))
+            return g_strdup("Error: deadline exceeded\n");
+
         if (GeneralCubeDecision(aarOutput, aarStdDev,
-                                aarsStatistics, (ConstTanBoard) processedBoard.anBoard, &ci, GetEvalCube(),
+                                aarsStatistics, (ConstTanBoard) processedBoard.anBoard, &ci, &esCube,
                                 NULL, NULL) < 0)
             return NULL;
 
@@ -562,266 +943,1576 @@ ExtFIBSBoard(scancontext * pec)
         }
     }
 
+    if (fCache)
+        ExtCacheStore(&k, szResponse);
     return szResponse;
 }
-#endif
 
-extern void
-CommandExternal(char *sz)
-{
+/*
+ * Batch evaluation: "batch evaluation <n> [options]" followed by n
+ * lines, each a position ID and a match ID separated by a colon or a
+ * space.  Without a match ID the position is evaluated for money with
+ * the cube centred.  The options are plies <n>, cubeful, cubeless,
+ * prune, noprune, noise <r>, deterministic and nondeterministic, with
+ * the same defaults as for "evaluation".  The boards are evaluated in
+ * parallel as one request and answered with n lines in the format of
+ * "evaluation", in order.  A batch is held in memory until it is
+ * complete, so n is at most EXT_MAX_BATCH; clients send larger sets as
+ * several batches.
+ */
 
-#if !defined(HAVE_SOCKETS)
-    (void) sz;                  /* silence compiler warning */
-    outputl(_("This installation of GNU Backgammon was compiled without\n"
-              "socket support, and does not implement external controllers."));
-#else
-    int h, hPeer;
-    socklen_t cb;
-    struct sockaddr *psa;
-    char szCommand[256];
-    char *szResponse = NULL;
-    struct sockaddr_in saRemote;
-    socklen_t saLen;
-    scancontext scanctx;
-    int fExit;
-    int fRestart = TRUE;
-    int retval = 0;
+#define EXT_MAX_BATCH 4096
+#define EXT_BATCH_CHUNK 32
 
-    sz = NextToken(&sz);
+typedef struct {
+    evalcontext ec;
+    unsigned int cBoards;       /* announced in the header */
+    unsigned int cReceived;
+    char **aszBoards;
+    float (*aarResult)[6];
+    int *afError;
+} extbatch;
+
+typedef struct {
+    extbatch *pb;
+    unsigned int iFirst, cBoards;
+} extbatchchunk;
 
-    if (!sz || !*sz) {
-        outputl(_("You must specify the name of the socket to the external controller."));
-        return;
+static void
+ExtBatchFree(extbatch * pb)
+{
+    g_strfreev(pb->aszBoards);
+    g_free(pb->aarResult);
+    g_free(pb->afError);
+    g_free(pb);
+}
+
+/* parse the header after "batch"; on failure sets *pszError, which
+ * must be NULL on entry */
+static extbatch *
+ExtBatchNew(char *sz, char **pszError)
+{
+    extbatch *pb;
+    char *pch;
+    int n;
+    float r;
+
+    if (!(pch = NextToken(&sz)) || g_ascii_strcasecmp(pch, "evaluation")) {
+        *pszError = g_strdup("Error: only batch evaluation is supported\n");
+        return NULL;
     }
 
-    memset(&scanctx, 0, sizeof(scanctx));
-    ExtInitParse(&scanctx.scanner);
+    if ((n = ParseNumber(&sz)) < 0 || n > EXT_MAX_BATCH) {
+        *pszError = g_strdup_printf("Error: batch size must be between 0 and %d\n", EXT_MAX_BATCH);
+        return NULL;
+    }
 
-  listenloop:
-    {
-        fExit = FALSE;
-        scanctx.fDebug = FALSE;
-        scanctx.fNewInterface = FALSE;
+    pb = g_new0(extbatch, 1);
+    pb->cBoards = (unsigned int) n;
+    pb->ec.fDeterministic = TRUE;
 
-        if ((h = ExternalSocket(&psa, &cb, sz)) < 0) {
-            SockErr(sz);
-            ExtDestroyParse(scanctx.scanner);
-            return;
+    while ((pch = NextToken(&sz))) {
+        if (!g_ascii_strcasecmp(pch, KEY_STR_PLIES)) {
+            if ((n = ParseNumber(&sz)) < 0 || n > 7) {
+                *pszError = g_strdup("Error: plies must be between 0 and 7\n");
+                break;
+            }
+            pb->ec.nPlies = (unsigned int) n;
+        } else if (!g_ascii_strcasecmp(pch, KEY_STR_CUBEFUL))
+            pb->ec.fCubeful = TRUE;
+        else if (!g_ascii_strcasecmp(pch, "cubeless"))
+            pb->ec.fCubeful = FALSE;
+        else if (!g_ascii_strcasecmp(pch, KEY_STR_PRUNE))
+            pb->ec.fUsePrune = TRUE;
+        else if (!g_ascii_strcasecmp(pch, "noprune"))
+            pb->ec.fUsePrune = FALSE;
+        else if (!g_ascii_strcasecmp(pch, KEY_STR_DETERMINISTIC))
+            pb->ec.fDeterministic = TRUE;
+        else if (!g_ascii_strcasecmp(pch, "nondeterministic"))
+            pb->ec.fDeterministic = FALSE;
+        else if (!g_ascii_strcasecmp(pch, KEY_STR_NOISE)) {
+            if ((r = ParseReal(&sz)) < 0.0f) {
+                *pszError = g_strdup("Error: noise must be a non-negative number\n");
+                break;
+            }
+            pb->ec.rNoise = r;
+        } else {
+            *pszError = g_strdup_printf("Error: unknown batch option '%s'\n", pch);
+            break;
         }
+    }
 
-        if (bind(h, psa, cb) < 0) {
-            SockErr(sz);
-            closesocket(h);
-            g_free(psa);
-            ExtDestroyParse(scanctx.scanner);
-            return;
-        }
+    if (*pszError) {
+        g_free(pb);
+        return NULL;
+    }
 
-        g_free(psa);
+    pb->aszBoards = g_new0(char *, pb->cBoards + 1);
+    return pb;
+}
 
-        if (listen(h, 1) < 0) {
-            SockErr("listen");
-            closesocket(h);
-            ExtDestroyParse(scanctx.scanner);
-            return;
-        }
-        outputf(_("Waiting for a connection from %s...\n"), sz);
-        outputx();
-        ProcessEvents();
+/* evaluate one "positionid:matchid" line; returns -1 if it is bad */
+static int
+ExtBatchBoard(const evalcontext * pec, const char *sz, float ar[6])
+{
+    TanBoard anBoard;
+    float arOutput[NUM_ROLLOUT_OUTPUTS];
+    cubeinfo ci;
+    unsigned int anDice[2];
+    int fTurn, fResigned, fDoubled, fMove = 1, fCubeOwner = -1, fCrawford = FALSE;
+    int nMatchTo = 0, anScore[2] = { 0, 0 }, nCube = 1, fJacoby = FALSE;
+    gamestate gs;
+    size_t cch = strcspn(sz, ": \t");
+    char szPosition[L_POSITIONID + 1];
+
+    if (cch != L_POSITIONID)
+        return -1;
+    memcpy(szPosition, sz, L_POSITIONID);
+    szPosition[L_POSITIONID] = 0;
+    if (!PositionFromID(anBoard, szPosition))
+        return -1;
 
-        /* Must set length when using windows */
-        saLen = sizeof(struct sockaddr);
-        while ((hPeer = accept(h, (struct sockaddr *) &saRemote, &saLen)) < 0) {
-            if (errno == EINTR) {
-                ProcessEvents();
-
-                if (fInterrupt) {
-                    closesocket(h);
-                    ExtDestroyParse(scanctx.scanner);
-                    return;
-                }
+    sz += cch;
+    sz += strspn(sz, ": \t");
+    if (*sz && (strlen(sz) != L_MATCHID
+                || MatchFromID(anDice, &fTurn, &fResigned, &fDoubled, &fMove, &fCubeOwner, &fCrawford,
+                               &nMatchTo, anScore, &nCube, &fJacoby, &gs, sz) < 0))
+        return -1;
 
-                continue;
-            }
+    if (SetCubeInfo(&ci, nCube, fCubeOwner, fMove, nMatchTo, anScore, fCrawford, fJacoby, nBeavers, bgvDefault))
+        return -1;
 
-            SockErr("accept");
-            closesocket(h);
-            ExtDestroyParse(scanctx.scanner);
-            return;
-        }
+    if (GeneralEvaluationE(arOutput, (ConstTanBoard) anBoard, &ci, pec))
+        return -1;
 
-        closesocket(h);
+    memcpy(ar, arOutput, 5 * sizeof(float));
+    if (nMatchTo)
+        ar[5] = pec->fCubeful ? arOutput[OUTPUT_CUBEFUL_EQUITY] : eq2mwc(arOutput[OUTPUT_EQUITY], &ci);
+    else
+        ar[5] = pec->fCubeful ? arOutput[6] : arOutput[5];
 
-        /* print info about remove client */
+    return 0;
+}
 
-        outputf(_("Accepted connection from %s.\n"), inet_ntoa(saRemote.sin_addr));
-        outputx();
-        ProcessEvents();
+static void
+ExtBatchChunk(extbatchchunk * pbc)
+{
+    extbatch *pb = pbc->pb;
+    unsigned int i;
 
-        while (!fExit && !(retval = ExternalRead(hPeer, szCommand, sizeof(szCommand)))) {
-            /* To keep lexer happy terminate each line with \n */
-            if (szCommand[strlen(szCommand) - 1] != '\n')
-                strcat(szCommand, "\n");
-
-            if ((ExtParse(&scanctx, szCommand)) == 0) {
-                /* parse error */
-                szResponse = scanctx.szError;
-            } else {
-                ProcessedFIBSBoard processedBoard;
-                gchar *szOptStr;
-
-                switch (scanctx.ct) {
-                case COMMAND_HELP:
-                    szResponse = g_strdup("\tNo help information available\n");
-                    break;
+    for (i = pbc->iFirst; i < pbc->iFirst + pbc->cBoards; i++)
+        pb->afError[i] = ExtBatchBoard(&pb->ec, pb->aszBoards[i], pb->aarResult[i]);
+}
 
-                case COMMAND_SET:
-                    szOptStr = g_value_get_gstring_gchar(g_list_nth_data(scanctx.pCmdData, 0));
-                    if (g_ascii_strcasecmp(szOptStr, KEY_STR_DEBUG) == 0) {
-                        scanctx.fDebug = g_value_get_int(g_list_nth_data(scanctx.pCmdData, 1));
-                        szResponse = g_strdup_printf("Debug output %s\n", scanctx.fDebug ? "ON" : "OFF");
-                    } else if (g_ascii_strcasecmp(szOptStr, KEY_STR_NEWINTERFACE) == 0) {
-                        scanctx.fNewInterface = g_value_get_int(g_list_nth_data(scanctx.pCmdData, 1));
-                        szResponse = g_strdup_printf("New interface %s\n", scanctx.fNewInterface ? "ON" : "OFF");
-                    } else {
-                        szResponse = g_strdup_printf("Error: set option '%s' not supported\n", szOptStr);
-                    }
-                    g_list_gv_boxed_free(scanctx.pCmdData);
+static char *
+ExtBatchEvaluate(extbatch * pb)
+{
+    mtsync ms = { 0 };
+    unsigned int cChunks = (pb->cBoards + EXT_BATCH_CHUNK - 1) / EXT_BATCH_CHUNK;
+    extbatchchunk *abc = g_new(extbatchchunk, cChunks);
+    GString *pgs = g_string_sized_new(pb->cBoards * 56);
+    unsigned int i;
+
+    pb->aarResult = g_malloc(pb->cBoards * sizeof(*pb->aarResult));
+    pb->afError = g_new(int, pb->cBoards);
+
+    for (i = 0; i < cChunks; i++) {
+        abc[i].pb = pb;
+        abc[i].iFirst = i * EXT_BATCH_CHUNK;
+        abc[i].cBoards = MIN(EXT_BATCH_CHUNK, pb->cBoards - abc[i].iFirst);
+        MT_Spawn(&ms, (AsyncFun) ExtBatchChunk, &abc[i]);
+    }
+    MT_Sync(&ms);
+    g_free(abc);
 
-                    break;
+    for (i = 0; i < pb->cBoards; i++) {
+        float *ar = pb->aarResult[i];
 
-                case COMMAND_VERSION:
-                    szResponse = g_strdup("Interface: " EXTERNAL_INTERFACE_VERSION "\n"
-                                          "RFBF: " RFBF_VERSION_SUPPORTED "\n"
-                                          "Engine: " WEIGHTS_VERSION "\n" "Software: " VERSION "\n");
+        if (pb->afError[i])
+            g_string_append(pgs, "Error: bad position\n");
+        else
+            g_string_append_printf(pgs, "%f %f %f %f %f %f\n", ar[0], ar[1], ar[2], ar[3], ar[4], ar[5]);
+    }
 
-                    break;
+    return g_string_free(pgs, FALSE);
+}
 
-                case COMMAND_NONE:
-                    szResponse = g_strdup("Error: no command given\n");
-                    break;
+/*
+ * The server.
+ *
+ * Any number of controllers (up to cExternalMaxConnections) may be
+ * connected at once.  Each has its own scanner and session settings.
+ * Commands are read as they arrive and answered in order, but
+ * evaluations and board decisions are run on the thread pool so that
+ * a slow request from one client does not hold up the others.  A
+ * client with cExternalQueueLimit requests outstanding is not read
+ * from until some of them are answered, except for the rest of a
+ * batch or an HTTP request it has started.  The sockets are watched
+ * with epoll on Linux and with select() elsewhere.
+ *
+ * A command may start with "@<id> "; every line of its answer then
+ * starts with the same.  After "set pipeline on" a client gets each
+ * answer as soon as it is ready rather than in order, which makes
+ * sense together with the ids.
+ */
 
-                case COMMAND_FIBSBOARD:
-                case COMMAND_EVALUATION:
-                    if (scanctx.fDebug) {
-                        GValue *optionsmapgv;
-                        GValue *boarddatagv;
-                        GString *dbgStr;
-                        int anScore[2];
-                        int fcrawford, fjacoby;
-                        char *asz[7] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
-                        char szBoard[10000];
-                        char **aszLines, **aszLinesOrig;
-                        char *szMatchID;
-
-                        optionsmapgv = (GValue *) g_list_nth_data(g_value_get_boxed(scanctx.pCmdData), 1);
-                        boarddatagv = (GValue *) g_list_nth_data(g_value_get_boxed(scanctx.pCmdData), 0);
-                        dbgStr = g_string_new(DEBUG_PREFIX);
-                        g_value_tostring(dbgStr, optionsmapgv, 0);
-                        g_string_append(dbgStr, "\n" DEBUG_PREFIX);
-                        g_value_tostring(dbgStr, boarddatagv, 0);
-                        g_string_append(dbgStr, "\n" DEBUG_PREFIX "\n");
-                        ExternalWrite(hPeer, dbgStr->str, strlen(dbgStr->str));
-                        ProcessFIBSBoardInfo(&scanctx.bi, &processedBoard);
-
-                        anScore[0] = processedBoard.nScoreOpp;
-                        anScore[1] = processedBoard.nScore;
-                        /* If the session isn't using Crawford rule, set Crawford flag to false */
-                        fcrawford = scanctx.fCrawfordRule ? processedBoard.fCrawford : FALSE;
-                        /* Set the Jacoby flag appropriately from the external interface settings */
-                        fjacoby = scanctx.fJacobyRule;
-
-                        szMatchID = MatchID((unsigned int *) processedBoard.anDice, 1, processedBoard.nResignation,
-                                            processedBoard.fDoubled, 1, processedBoard.fCubeOwner, fcrawford,
-                                            processedBoard.nMatchTo, anScore, processedBoard.nCube, fjacoby,
-                                            GAME_PLAYING);
-
-                        DrawBoard(szBoard, (ConstTanBoard) & processedBoard.anBoard, 1, asz, szMatchID, 15);
-
-                        aszLines = g_strsplit(&szBoard[0], "\n", 32);
-                        aszLinesOrig = aszLines;
-                        while (*aszLines) {
-                            ExternalWrite(hPeer, DEBUG_PREFIX, strlen(DEBUG_PREFIX));
-                            ExternalWrite(hPeer, *aszLines, strlen(*aszLines));
-                            ExternalWrite(hPeer, "\n", 1);
-                            aszLines++;
-                        }
-
-                        dbgStr = g_string_assign(dbgStr, "");
-                        g_string_append_printf(dbgStr, DEBUG_PREFIX "X is %s, O is %s\n", processedBoard.szPlayer,
-                                               processedBoard.szOpp);
-                        if (processedBoard.nMatchTo) {
-                            g_string_append_printf(dbgStr, DEBUG_PREFIX "Match Play %s Crawford Rule\n",
-                                                   scanctx.fCrawfordRule ? "with" : "without");
-                            g_string_append_printf(dbgStr, DEBUG_PREFIX "Score: %d-%d/%d%s, ", processedBoard.nScore,
-                                                   processedBoard.nScoreOpp, processedBoard.nMatchTo,
-                                                   fcrawford ? "*" : "");
-                        } else {
-                            g_string_append_printf(dbgStr, DEBUG_PREFIX "Money Session %s Jacoby Rule, %s Beavers\n",
-                                                   scanctx.fJacobyRule ? "with" : "without",
-                                                   scanctx.fBeavers ? "with" : "without");
-                            g_string_append_printf(dbgStr, DEBUG_PREFIX "Score: %d-%d, ", processedBoard.nScore,
-                                                   processedBoard.nScoreOpp);
-                        }
-                        g_string_append_printf(dbgStr, "Roll: %d%d\n",
-                                               processedBoard.anDice[0], processedBoard.anDice[1]);
-                        g_string_append_printf(dbgStr,
-                                               DEBUG_PREFIX
-                                               "CubeOwner: %d, Cube: %d, Turn: %c, Doubled: %d, Resignation: %d\n",
-                                               processedBoard.fCubeOwner, processedBoard.nCube, 'X',
-                                               processedBoard.fDoubled, processedBoard.nResignation);
-                        g_string_append(dbgStr, DEBUG_PREFIX "\n");
-                        ExternalWrite(hPeer, dbgStr->str, strlen(dbgStr->str));
-
-                        g_string_free(dbgStr, TRUE);
-                        g_strfreev(aszLinesOrig);
-                    }
-                    g_value_unsetfree(scanctx.pCmdData);
-
-                    if (scanctx.ct == COMMAND_EVALUATION)
-                        szResponse = ExtEvaluation(&scanctx);
-                    else
-                        szResponse = ExtFIBSBoard(&scanctx);
+#define EXT_READ 1
+#define EXT_WRITE 2
+#define EXT_MAX_EVENTS 64
+#define EXT_MAX_LINE 65536
+#define EXT_YIELD_TIME 50       /* milliseconds between serving the clients during a rollout */
+
+/* the kinds of request counted apart in the metrics */
+typedef enum {
+    EXT_KIND_OTHER, EXT_KIND_BOARD, EXT_KIND_EVALUATION, EXT_KIND_BATCH, EXT_KIND_JOB, EXT_KINDS
+} extkind;
+
+typedef struct {
+    scancontext sc;             /* a copy of the client's, owning the board names */
+    char *szID;                 /* echoed on each line of the answer */
+    extbatch *pBatch;           /* for batch evaluations */
+    GString *pgsResponse;       /* debug output, then the answer */
+    gint64 tReceived;           /* monotonic time */
+    gint64 tDeadline;           /* monotonic time, 0 for none */
+    extkind kind;
+    int fDone;
+} extrequest;
+
+typedef struct {
+    int h;                      /* -1 once closed */
+    char szAddress[64];
+    scancontext scanctx;
+    GString *pgsIn;             /* received, not yet a complete line */
+    GString *pgsOut;            /* answers not yet sent */
+    GQueue *pqRequests;         /* answered in this order */
+    unsigned int nInterest;     /* EXT_READ and EXT_WRITE as last registered */
+    int fExit;                  /* close once the answers are sent */
+    int fPipeline;              /* answer as soon as ready, in any order */
+    extrequest *prqBatch;       /* collecting the boards of a batch */
+    extrequest *prqHttp;        /* skipping the headers of an HTTP request */
+    int fHttpFound;             /* it asked for the metrics */
+    int fDiscard;               /* dropping the rest of a line that was too long */
+} extclient;
+
+typedef struct {
+    int h;                      /* the listening socket */
+#if defined(__linux__)
+    int hEpoll;
+#endif
+    GList *plClients;
+    unsigned int cClients;      /* still connected */
+    int fShared;                /* other processes accept on h too */
+    GQueue *pqRollouts;         /* board requests waiting to be rolled out */
+#if defined(USE_MULTITHREAD)
+    mtgroup *pg;
+#endif
+} extserver;
 
-                    break;
+#ifndef WIN32
+/* written to by the workers when an answer is ready */
+static int ahWake[2] = { -1, -1 };
+#endif
 
-                case COMMAND_EXIT:
-                    closesocket(hPeer);
-                    fExit = TRUE;
-                    break;
+static void
+SetNonBlocking(int h)
+{
+#ifdef WIN32
+    u_long f = 1;
 
-                default:
-                    szResponse = g_strdup("Unsupported Command\n");
-                }
-                unset_scan_context(&scanctx, FALSE);
-            }
+    ioctlsocket((SOCKET) h, FIONBIO, &f);
+#else
+    fcntl(h, F_SETFL, fcntl(h, F_GETFL) | O_NONBLOCK);
+#endif
+}
 
-            if (szResponse) {
-                /* outputf("%s", szResponse); */
-                if (ExternalWrite(hPeer, szResponse, strlen(szResponse)))
-                    break;
+static int
+SocketWouldBlock(void)
+{
+#ifdef WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
 
-                g_free(szResponse);
-                szResponse = NULL;
-            }
+static void
+RequestDone(extrequest * prq, char *szResponse)
+{
+    if (szResponse) {
+        g_string_append(prq->pgsResponse, szResponse);
+        g_free(szResponse);
+    }
 
-        }
-        /* Interrupted : get out of listen loop */
-        if (retval == -2) {
-            ProcessEvents();
-            fRestart = FALSE;
-        }
+    MT_SafeSet(&prq->fDone, TRUE);
+}
+
+static void
+ExtRequestTask(extrequest * prq)
+{
+    char *szResponse;
+
+    if (prq->pBatch) {
+        szResponse = ExtBatchEvaluate(prq->pBatch);
+        ExtBatchFree(prq->pBatch);
+        prq->pBatch = NULL;
+    } else if (ExtDeadlinePassed(prq->tDeadline))
+        /* waited too long in the queue; the answer would be no use */
+        szResponse = g_strdup("Error: deadline exceeded\n");
+    else if (prq->sc.ct == COMMAND_EVALUATION)
+        szResponse = ExtEvaluation(&prq->sc);
+    else
+        szResponse = ExtFIBSBoard(&prq->sc, prq->tDeadline);
+
+    unset_scan_context(&prq->sc, FALSE);
+    RequestDone(prq, szResponse);
+
+#ifndef WIN32
+    {
+        ssize_t n = write(ahWake[1], "", 1);
+
+        (void) n;               /* the pipe being full is as good */
+    }
+#endif
+}
+
+static void
+ExtDebugBoard(scancontext * psc, GString * pgs)
+{
+    ProcessedFIBSBoard processedBoard;
+    GValue *optionsmapgv;
+    GValue *boarddatagv;
+    int anScore[2];
+    int fcrawford, fjacoby;
+    char *asz[7] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    char szBoard[10000];
+    char **aszLines, **aszLinesOrig;
+    char *szMatchID;
+
+    optionsmapgv = (GValue *) g_list_nth_data(g_value_get_boxed(psc->pCmdData), 1);
+    boarddatagv = (GValue *) g_list_nth_data(g_value_get_boxed(psc->pCmdData), 0);
+    g_string_append(pgs, DEBUG_PREFIX);
+    g_value_tostring(pgs, optionsmapgv, 0);
+    g_string_append(pgs, "\n" DEBUG_PREFIX);
+    g_value_tostring(pgs, boarddatagv, 0);
+    g_string_append(pgs, "\n" DEBUG_PREFIX "\n");
+    ProcessFIBSBoardInfo(&psc->bi, &processedBoard);
+
+    anScore[0] = processedBoard.nScoreOpp;
+    anScore[1] = processedBoard.nScore;
+    /* If the session isn't using Crawford rule, set Crawford flag to false */
+    fcrawford = psc->fCrawfordRule ? processedBoard.fCrawford : FALSE;
+    /* Set the Jacoby flag appropriately from the external interface settings */
+    fjacoby = psc->fJacobyRule;
+
+    szMatchID = MatchID((unsigned int *) processedBoard.anDice, 1, processedBoard.nResignation,
+                        processedBoard.fDoubled, 1, processedBoard.fCubeOwner, fcrawford,
+                        processedBoard.nMatchTo, anScore, processedBoard.nCube, fjacoby, GAME_PLAYING);
 
-        closesocket(hPeer);
-        if (szResponse)
-            g_free(szResponse);
+    DrawBoard(szBoard, (ConstTanBoard) & processedBoard.anBoard, 1, asz, szMatchID, 15);
 
-        szResponse = NULL;
-        scanctx.szError = NULL;
+    aszLines = g_strsplit(&szBoard[0], "\n", 32);
+    aszLinesOrig = aszLines;
+    while (*aszLines) {
+        g_string_append_printf(pgs, DEBUG_PREFIX "%s\n", *aszLines);
+        aszLines++;
     }
-    if (fRestart)
-        goto listenloop;
 
-    unset_scan_context(&scanctx, TRUE);
+    g_string_append_printf(pgs, DEBUG_PREFIX "X is %s, O is %s\n", processedBoard.szPlayer, processedBoard.szOpp);
+    if (processedBoard.nMatchTo) {
+        g_string_append_printf(pgs, DEBUG_PREFIX "Match Play %s Crawford Rule\n",
+                               psc->fCrawfordRule ? "with" : "without");
+        g_string_append_printf(pgs, DEBUG_PREFIX "Score: %d-%d/%d%s, ", processedBoard.nScore,
+                               processedBoard.nScoreOpp, processedBoard.nMatchTo, fcrawford ? "*" : "");
+    } else {
+        g_string_append_printf(pgs, DEBUG_PREFIX "Money Session %s Jacoby Rule, %s Beavers\n",
+                               psc->fJacobyRule ? "with" : "without", psc->fBeavers ? "with" : "without");
+        g_string_append_printf(pgs, DEBUG_PREFIX "Score: %d-%d, ", processedBoard.nScore,
+                               processedBoard.nScoreOpp);
+    }
+    g_string_append_printf(pgs, "Roll: %d%d\n", processedBoard.anDice[0], processedBoard.anDice[1]);
+    g_string_append_printf(pgs,
+                           DEBUG_PREFIX "CubeOwner: %d, Cube: %d, Turn: %c, Doubled: %d, Resignation: %d\n",
+                           processedBoard.fCubeOwner, processedBoard.nCube, 'X',
+                           processedBoard.fDoubled, processedBoard.nResignation);
+    g_string_append(pgs, DEBUG_PREFIX "\n");
+
+    g_strfreev(aszLinesOrig);
+}
+
+/* Board requests evaluated with a rollout; the rollout waits for the thread
+ * pool itself, so these cannot be tasks of the pool */
+
+static int
+RequestIsRollout(const extrequest * prq)
+{
+    return !prq->pBatch && prq->sc.ct != COMMAND_EVALUATION && !prq->sc.fEvalOptions
+        && (GetEvalCube()->et == EVAL_ROLLOUT || esEvalCube.et == EVAL_ROLLOUT);
+}
+
+/* Run an evaluation, batch or board request; the request owns a copy of the
+ * client's scan context */
+
+static void
+DispatchRequest(extserver * ps, extrequest * prq)
+{
+    if (RequestIsRollout(prq)) {
+        /* ServerRun() plays them one at a time */
+        g_queue_push_tail(ps->pqRollouts, prq);
+        return;
+    }
+#if defined(USE_MULTITHREAD)
+    {
+        Task *pt = (Task *) g_malloc(sizeof(Task));
+
+        pt->fun = (AsyncFun) ExtRequestTask;
+        pt->data = prq;
+        pt->pLinkedTask = NULL;
+        MT_GroupAddTask(ps->pg, pt);
+    }
+#else
+    ExtRequestTask(prq);
+#endif
+}
+
+static extrequest *
+ClientRequest(extclient * pc)
+{
+    extrequest *prq = g_new0(extrequest, 1);
+
+    prq->pgsResponse = g_string_new(NULL);
+    prq->tReceived = g_get_monotonic_time();
+    g_queue_push_tail(pc->pqRequests, prq);
+    return prq;
+}
+
+/*
+ * Metrics in the Prometheus text format, for the "metrics" command and
+ * for "GET /metrics" over HTTP on the same socket.  The request counts
+ * and latencies are kept by the main thread alone; the work of the
+ * evaluation threads comes from their own counters (MT_GetStats()), so
+ * nothing on the evaluation path takes a lock or an atomic for them.
+ */
+
+static const char *aszExtKind[EXT_KINDS] = { "other", "board", "evaluation", "batch", "job" };
+
+/* upper bounds of the latency buckets, in seconds */
+static const double arExtLatencyBucket[] = { 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10, 60 };
+
+#define EXT_LATENCY_BUCKETS (sizeof(arExtLatencyBucket) / sizeof(arExtLatencyBucket[0]))
+
+static guint64 aacExtLatency[EXT_KINDS][EXT_LATENCY_BUCKETS];   /* not cumulative */
+static guint64 acExtRequests[EXT_KINDS];
+static double arExtLatencySum[EXT_KINDS];
+
+static void
+ExtMetricsObserve(const extrequest * prq)
+{
+    double r = (double) (g_get_monotonic_time() - prq->tReceived) / 1.0e6;
+    unsigned int i;
+
+    acExtRequests[prq->kind]++;
+    arExtLatencySum[prq->kind] += r;
+    for (i = 0; i < EXT_LATENCY_BUCKETS; i++)
+        if (r <= arExtLatencyBucket[i]) {
+            aacExtLatency[prq->kind][i]++;
+            break;
+        }
+}
+
+static void
+ExtMetricsHeader(GString * pgs, const char *szName, const char *szType, const char *szHelp)
+{
+    g_string_append_printf(pgs, "# HELP %s %s\n# TYPE %s %s\n", szName, szHelp, szName, szType);
+}
+
+static char *
+ExtMetrics(const extserver * ps)
+{
+    GString *pgs = g_string_new(NULL);
+    char ach[G_ASCII_DTOSTR_BUF_SIZE];
+    unsigned int i, j, c;
+    unsigned int cOutstanding = 0;
+    unsigned int cEntries;
+    unsigned long cHits, cMisses;
+    mtstats *ams;
+    GList *pl;
+
+    ExtMetricsHeader(pgs, "gnubg_external_requests_total", "counter", "Requests answered.");
+    for (i = 0; i < EXT_KINDS; i++)
+        g_string_append_printf(pgs, "gnubg_external_requests_total{kind=\"%s\"} %" G_GUINT64_FORMAT "\n",
+                               aszExtKind[i], acExtRequests[i]);
+
+    ExtMetricsHeader(pgs, "gnubg_external_request_duration_seconds", "histogram",
+                     "Time from receiving a request to its answer being ready.");
+    for (i = 0; i < EXT_KINDS; i++) {
+        guint64 cCumulative = 0;
+
+        for (j = 0; j < EXT_LATENCY_BUCKETS; j++) {
+            cCumulative += aacExtLatency[i][j];
+            g_string_append_printf(pgs,
+                                   "gnubg_external_request_duration_seconds_bucket{kind=\"%s\",le=\"%s\"} %"
+                                   G_GUINT64_FORMAT "\n", aszExtKind[i],
+                                   g_ascii_dtostr(ach, sizeof(ach), arExtLatencyBucket[j]), cCumulative);
+        }
+        g_string_append_printf(pgs,
+                               "gnubg_external_request_duration_seconds_bucket{kind=\"%s\",le=\"+Inf\"} %"
+                               G_GUINT64_FORMAT "\n", aszExtKind[i], acExtRequests[i]);
+        g_string_append_printf(pgs, "gnubg_external_request_duration_seconds_sum{kind=\"%s\"} %s\n",
+                               aszExtKind[i], g_ascii_dtostr(ach, sizeof(ach), arExtLatencySum[i]));
+        g_string_append_printf(pgs, "gnubg_external_request_duration_seconds_count{kind=\"%s\"} %"
+                               G_GUINT64_FORMAT "\n", aszExtKind[i], acExtRequests[i]);
+    }
+
+    for (pl = ps->plClients; pl; pl = pl->next)
+        cOutstanding += g_queue_get_length(((extclient *) pl->data)->pqRequests);
+
+    ExtMetricsHeader(pgs, "gnubg_external_connections", "gauge", "Open connections.");
+    g_string_append_printf(pgs, "gnubg_external_connections %u\n", ps->cClients);
+    ExtMetricsHeader(pgs, "gnubg_external_requests_outstanding", "gauge", "Requests not yet answered.");
+    g_string_append_printf(pgs, "gnubg_external_requests_outstanding %u\n", cOutstanding);
+
+    ExternalCacheStats(&cEntries, &cHits, &cMisses);
+    ExtMetricsHeader(pgs, "gnubg_external_cache_entries", "gauge", "Board decisions cached.");
+    g_string_append_printf(pgs, "gnubg_external_cache_entries %u\n", cEntries);
+    ExtMetricsHeader(pgs, "gnubg_external_cache_hits_total", "counter", "Board requests answered from the cache.");
+    g_string_append_printf(pgs, "gnubg_external_cache_hits_total %lu\n", cHits);
+    ExtMetricsHeader(pgs, "gnubg_external_cache_misses_total", "counter", "Board requests not found in the cache.");
+    g_string_append_printf(pgs, "gnubg_external_cache_misses_total %lu\n", cMisses);
+
+#if CACHE_STATS
+    {
+        unsigned int cUsed, cLookup, cHit;
+
+        EvalCacheStats(&cUsed, &cLookup, &cHit);
+        ExtMetricsHeader(pgs, "gnubg_eval_cache_lookups_total", "counter", "Evaluation cache lookups.");
+        g_string_append_printf(pgs, "gnubg_eval_cache_lookups_total %u\n", cLookup);
+        ExtMetricsHeader(pgs, "gnubg_eval_cache_hits_total", "counter", "Evaluation cache hits.");
+        g_string_append_printf(pgs, "gnubg_eval_cache_hits_total %u\n", cHit);
+    }
+#endif
+
+    /* the threads outside the pool come first, labelled "main" */
+    ams = g_new(mtstats, MT_GetNumThreads() + 1);
+    c = MT_GetStats(ams, MT_GetNumThreads() + 1);
+
+    ExtMetricsHeader(pgs, "gnubg_evaluations_total", "counter", "Static evaluations, by thread.");
+    if (c)
+        g_string_append_printf(pgs, "gnubg_evaluations_total{thread=\"main\"} %" G_GUINT64_FORMAT "\n",
+                               ams[0].cEvaluations);
+    for (i = 1; i < c; i++)
+        g_string_append_printf(pgs, "gnubg_evaluations_total{thread=\"%u\"} %" G_GUINT64_FORMAT "\n",
+                               i - 1, ams[i].cEvaluations);
+    ExtMetricsHeader(pgs, "gnubg_thread_tasks_total", "counter", "Tasks run, by thread.");
+    for (i = 1; i < c; i++)
+        g_string_append_printf(pgs, "gnubg_thread_tasks_total{thread=\"%u\"} %" G_GUINT64_FORMAT "\n",
+                               i - 1, ams[i].cTasks);
+    ExtMetricsHeader(pgs, "gnubg_thread_busy_seconds_total", "counter", "Time spent running tasks, by thread.");
+    for (i = 1; i < c; i++)
+        g_string_append_printf(pgs, "gnubg_thread_busy_seconds_total{thread=\"%u\"} %s\n", i - 1,
+                               g_ascii_dtostr(ach, sizeof(ach), (double) ams[i].usBusy / 1.0e6));
+    g_free(ams);
+
+    return g_string_free(pgs, FALSE);
+}
+
+/* "set pipeline" is handled here rather than by the grammar; returns
+ * NULL for other commands */
+
+static char *
+ClientSetPipeline(extclient * pc, char *szCommand)
+{
+    char *pch = szCommand;
+    char *szSet = NextToken(&pch);
+    char *szKey = NextToken(&pch);
+    char *szValue = NextToken(&pch);
+
+    if (!szSet || g_ascii_strcasecmp(szSet, "set") || !szKey || g_ascii_strcasecmp(szKey, "pipeline"))
+        return NULL;
+
+    if (!szValue)
+        return g_strdup("Error: set pipeline on|off\n");
+    else if (!g_ascii_strcasecmp(szValue, "on") || !g_ascii_strcasecmp(szValue, "yes")
+             || !g_ascii_strcasecmp(szValue, "true"))
+        pc->fPipeline = TRUE;
+    else if (!g_ascii_strcasecmp(szValue, "off") || !g_ascii_strcasecmp(szValue, "no")
+             || !g_ascii_strcasecmp(szValue, "false"))
+        pc->fPipeline = FALSE;
+    else
+        return g_strdup_printf("Error: '%s' is not on or off\n", szValue);
+
+    return g_strdup_printf("Pipeline %s\n", pc->fPipeline ? "ON" : "OFF");
+}
+
+static int
+ClientIsMetrics(const char *szCommand)
+{
+    const char *pch = szCommand;
+    size_t cch;
+    const char *pchWord = FastWord(&pch, &cch);
+
+    return pchWord && FastWordIs(pchWord, cch, "metrics") && !FastWord(&pch, &cch);
+}
+
+static void
+ClientCommand(extserver * ps, extclient * pc, char *szCommand)
+{
+    extrequest *prq = ClientRequest(pc);
+    char *szResponse = NULL;
+    gchar *szOptStr;
+
+    if (*szCommand == '@') {
+        /* a request id */
+        size_t cch = strcspn(szCommand, " \t\r\n");
+
+        prq->szID = g_strndup(szCommand, cch);
+        szCommand += cch;
+        szCommand += strspn(szCommand, " \t");
+    }
+
+    if (!g_ascii_strncasecmp(szCommand, "set ", 4)) {
+        char *szCopy = g_strdup(szCommand);
+
+        szResponse = ClientSetPipeline(pc, szCopy);
+        g_free(szCopy);
+        if (szResponse) {
+            RequestDone(prq, szResponse);
+            return;
+        }
+    }
+
+    if (!strncmp(szCommand, "GET ", 4)) {
+        /* a scrape over HTTP: answered after the headers, then closed */
+        pc->prqHttp = prq;
+        pc->fHttpFound = !strncmp(szCommand + 4, "/metrics", 8) && strchr(" ?\r\n", szCommand[12]);
+        return;
+    }
+
+    if (ClientIsMetrics(szCommand)) {
+        char *sz = ExtMetrics(ps);
+
+        /* where the answer ends; a comment to Prometheus */
+        RequestDone(prq, g_strconcat(sz, "# EOF\n", NULL));
+        g_free(sz);
+        return;
+    }
+
+    if (!strncmp(szCommand, "job ", 4)) {
+        /* the rollout job queue has its own little language */
+        prq->kind = EXT_KIND_JOB;
+        RequestDone(prq, RolloutQueueCommand(pc->szAddress, szCommand + 4));
+        return;
+    }
+
+    if (!g_ascii_strncasecmp(szCommand, "batch ", 6)) {
+        char *szError = NULL;
+
+        prq->kind = EXT_KIND_BATCH;
+        if (!(prq->pBatch = ExtBatchNew(szCommand + 6, &szError)))
+            RequestDone(prq, szError);
+        else if (prq->pBatch->cBoards)
+            pc->prqBatch = prq; /* the boards follow */
+        else
+            DispatchRequest(ps, prq);
+        return;
+    }
+
+    if (!ExtParse(&pc->scanctx, szCommand)) {
+        /* parse error */
+        szResponse = pc->scanctx.szError;
+        pc->scanctx.szError = NULL;
+        unset_scan_context(&pc->scanctx, FALSE);
+        RequestDone(prq, szResponse);
+        return;
+    }
+
+    switch (pc->scanctx.ct) {
+    case COMMAND_HELP:
+        szResponse = g_strdup("\tNo help information available\n");
+        break;
+
+    case COMMAND_SET:
+        szOptStr = g_value_get_gstring_gchar(g_list_nth_data(pc->scanctx.pCmdData, 0));
+        if (g_ascii_strcasecmp(szOptStr, KEY_STR_DEBUG) == 0) {
+            pc->scanctx.fDebug = g_value_get_int(g_list_nth_data(pc->scanctx.pCmdData, 1));
+            szResponse = g_strdup_printf("Debug output %s\n", pc->scanctx.fDebug ? "ON" : "OFF");
+        } else if (g_ascii_strcasecmp(szOptStr, KEY_STR_NEWINTERFACE) == 0) {
+            pc->scanctx.fNewInterface = g_value_get_int(g_list_nth_data(pc->scanctx.pCmdData, 1));
+            szResponse = g_strdup_printf("New interface %s\n", pc->scanctx.fNewInterface ? "ON" : "OFF");
+        } else {
+            szResponse = g_strdup_printf("Error: set option '%s' not supported\n", szOptStr);
+        }
+        g_list_gv_boxed_free(pc->scanctx.pCmdData);
+
+        break;
+
+    case COMMAND_VERSION:
+        szResponse = g_strdup("Interface: " EXTERNAL_INTERFACE_VERSION "\n"
+                              "RFBF: " RFBF_VERSION_SUPPORTED "\n"
+                              "Engine: " WEIGHTS_VERSION "\n" "Software: " VERSION "\n");
+
+        break;
+
+    case COMMAND_NONE:
+        szResponse = g_strdup("Error: no command given\n");
+        break;
+
+    case COMMAND_FIBSBOARD:
+    case COMMAND_EVALUATION:
+        prq->kind = pc->scanctx.ct == COMMAND_EVALUATION ? EXT_KIND_EVALUATION : EXT_KIND_BOARD;
+        if (pc->scanctx.fDebug)
+            ExtDebugBoard(&pc->scanctx, prq->pgsResponse);
+        if (pc->scanctx.pCmdData) {
+            g_value_unsetfree(pc->scanctx.pCmdData);
+            pc->scanctx.pCmdData = NULL;
+        }
+
+        if (pc->scanctx.msDeadline)
+            prq->tDeadline = g_get_monotonic_time() + (gint64) pc->scanctx.msDeadline * 1000;
+
+        /* the request takes the board names with it */
+        prq->sc = pc->scanctx;
+        prq->sc.szError = NULL;
+        pc->scanctx.bi.gsName = NULL;
+        pc->scanctx.bi.gsOpp = NULL;
+        unset_scan_context(&pc->scanctx, FALSE);
+
+        DispatchRequest(ps, prq);
+        return;
+
+    case COMMAND_EXIT:
+        pc->fExit = TRUE;
+        break;
+
+    default:
+        szResponse = g_strdup("Unsupported Command\n");
+    }
+
+    unset_scan_context(&pc->scanctx, FALSE);
+    RequestDone(prq, szResponse);
+}
+
+/* the headers of an HTTP request end with an empty line */
+static void
+ClientHttpLine(extserver * ps, extclient * pc, const char *sz)
+{
+    extrequest *prq = pc->prqHttp;
+
+    if (sz[strspn(sz, "\r\n")])
+        return;
+
+    if (pc->fHttpFound) {
+        char *szMetrics = ExtMetrics(ps);
+
+        g_string_printf(prq->pgsResponse, "HTTP/1.0 200 OK\r\n"
+                        "Content-Type: text/plain; version=0.0.4\r\n"
+                        "Content-Length: %lu\r\n\r\n%s", (unsigned long) strlen(szMetrics), szMetrics);
+        g_free(szMetrics);
+    } else
+        g_string_assign(prq->pgsResponse, "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+
+    pc->prqHttp = NULL;
+    pc->fExit = TRUE;
+    RequestDone(prq, NULL);
+}
+
+static void
+ClientBatchLine(extserver * ps, extclient * pc, char *sz)
+{
+    extbatch *pb = pc->prqBatch->pBatch;
+
+    pb->aszBoards[pb->cReceived++] = g_strdup(g_strstrip(sz));
+    if (pb->cReceived == pb->cBoards) {
+        DispatchRequest(ps, pc->prqBatch);
+        pc->prqBatch = NULL;
+    }
+}
+
+/* the lines of a batch or HTTP request already queued don't add to the
+ * queue, so they are read even when it is full */
+static int
+ClientReadable(const extclient * pc)
+{
+    return !pc->fExit && (pc->prqBatch || pc->prqHttp || g_queue_get_length(pc->pqRequests) < cExternalQueueLimit);
+}
+
+/* handle the complete lines received, as far as the queue limit allows */
+static void
+ClientInput(extserver * ps, extclient * pc)
+{
+    while (pc->h >= 0 && ClientReadable(pc)) {
+        char *pch = memchr(pc->pgsIn->str, '\n', pc->pgsIn->len);
+        char *szCommand;
+
+        if (pc->fDiscard) {
+            if (!pch) {
+                g_string_truncate(pc->pgsIn, 0);
+                return;
+            }
+            g_string_erase(pc->pgsIn, 0, (pch - pc->pgsIn->str) + 1);
+            pc->fDiscard = FALSE;
+            continue;
+        }
+
+        if (!pch) {
+            if (pc->pgsIn->len > EXT_MAX_LINE) {
+                /* the rest of the line is not a new command */
+                g_string_truncate(pc->pgsIn, 0);
+                pc->fDiscard = TRUE;
+                RequestDone(ClientRequest(pc), g_strdup("Error: line too long\n"));
+            }
+            return;
+        }
+
+        /* keep the newline: the lexer wants it */
+        szCommand = g_strndup(pc->pgsIn->str, (gsize) (pch - pc->pgsIn->str) + 1);
+        g_string_erase(pc->pgsIn, 0, (pch - pc->pgsIn->str) + 1);
+        if (pc->prqBatch)
+            ClientBatchLine(ps, pc, szCommand);
+        else if (pc->prqHttp)
+            ClientHttpLine(ps, pc, szCommand);
+        else
+            ClientCommand(ps, pc, szCommand);
+        g_free(szCommand);
+    }
+}
+
+static void
+ClientClose(extserver * ps, extclient * pc)
+{
+    if (pc->h < 0)
+        return;
+
+#if defined(__linux__)
+    epoll_ctl(ps->hEpoll, EPOLL_CTL_DEL, pc->h, NULL);
+#endif
+    closesocket(pc->h);
+    pc->h = -1;
+    ps->cClients--;
+
+    if (pc->prqBatch) {
+        /* the rest of the boards will never come */
+        ExtBatchFree(pc->prqBatch->pBatch);
+        pc->prqBatch->pBatch = NULL;
+        RequestDone(pc->prqBatch, NULL);
+        pc->prqBatch = NULL;
+    }
+
+    if (pc->prqHttp) {
+        RequestDone(pc->prqHttp, NULL);
+        pc->prqHttp = NULL;
+    }
+
+    outputf(_("External connection from %s closed.\n"), pc->szAddress);
+    outputx();
+}
+
+static void
+ClientWrite(extserver * ps, extclient * pc)
+{
+#ifndef WIN32
+    psighandler sh;
+#endif
+
+    while (pc->h >= 0 && pc->pgsOut->len) {
+        int n;
+
+#ifndef WIN32
+        PortableSignal(SIGPIPE, SIG_IGN, &sh, FALSE);
+#endif
+        n = (int) send(pc->h, pc->pgsOut->str, pc->pgsOut->len, 0);
+#ifndef WIN32
+        PortableSignalRestore(SIGPIPE, &sh);
+#endif
+
+        if (n > 0)
+            g_string_erase(pc->pgsOut, 0, n);
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && SocketWouldBlock())
+            return;
+        else {
+            SockErr(_("writing to external connection"));
+            ClientClose(ps, pc);
+        }
+    }
+}
+
+static void
+ClientRead(extserver * ps, extclient * pc)
+{
+    char ach[4096];
+    int n;
+
+    for (;;) {
+        n = (int) recv(pc->h, ach, sizeof(ach), 0);
+
+        if (n > 0)
+            g_string_append_len(pc->pgsIn, ach, n);
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && SocketWouldBlock())
+            break;
+        else {
+            if (n < 0)
+                SockErr(_("reading from external connection"));
+            ClientClose(ps, pc);
+            return;
+        }
+    }
+
+    ClientInput(ps, pc);
+}
+
+static void
+ClientAnswer(extclient * pc, const extrequest * prq)
+{
+    const char *pch = prq->pgsResponse->str;
+    const char *pchEnd = pch + prq->pgsResponse->len;
+
+    if (!prq->szID) {
+        g_string_append_len(pc->pgsOut, pch, prq->pgsResponse->len);
+        return;
+    }
+
+    while (pch < pchEnd) {
+        const char *pchNL = memchr(pch, '\n', (size_t) (pchEnd - pch));
+        const char *pchNext = pchNL ? pchNL + 1 : pchEnd;
+
+        g_string_append_printf(pc->pgsOut, "%s ", prq->szID);
+        g_string_append_len(pc->pgsOut, pch, pchNext - pch);
+        if (!pchNL)
+            g_string_append_c(pc->pgsOut, '\n');
+        pch = pchNext;
+    }
+}
+
+/* Send the answers that are ready, in order unless the client asked
+ * otherwise; returns the number of requests still outstanding */
+
+static unsigned int
+ClientFlush(extserver * ps, extclient * pc)
+{
+    extrequest *prq;
+
+    do {
+        GList *pl = pc->pqRequests->head, *plNext;
+
+        for (; pl; pl = plNext) {
+            plNext = pl->next;
+            prq = pl->data;
+
+            if (!MT_SafeGet(&prq->fDone)) {
+                if (pc->fPipeline)
+                    continue;
+                break;
+            }
+
+            g_queue_delete_link(pc->pqRequests, pl);
+            ExtMetricsObserve(prq);
+            if (pc->h >= 0)
+                ClientAnswer(pc, prq);
+            g_free(prq->szID);
+            g_string_free(prq->pgsResponse, TRUE);
+            g_free(prq);
+        }
+
+        /* room for more: the new requests may be answered at once */
+        ClientInput(ps, pc);
+    } while ((prq = g_queue_peek_head(pc->pqRequests)) && MT_SafeGet(&prq->fDone));
+
+    ClientWrite(ps, pc);
+
+    if (pc->h >= 0 && pc->fExit && !pc->pgsOut->len && g_queue_is_empty(pc->pqRequests))
+        ClientClose(ps, pc);
+
+    return g_queue_get_length(pc->pqRequests);
+}
+
+static void
+ClientFree(extclient * pc)
+{
+    extrequest *prq;
+
+    /* only requests that never ran are left */
+    while ((prq = g_queue_pop_head(pc->pqRequests)) != NULL) {
+        if (!prq->fDone)
+            unset_scan_context(&prq->sc, FALSE);
+        if (prq->pBatch)
+            ExtBatchFree(prq->pBatch);
+        g_free(prq->szID);
+        g_string_free(prq->pgsResponse, TRUE);
+        g_free(prq);
+    }
+    g_queue_free(pc->pqRequests);
+    unset_scan_context(&pc->scanctx, TRUE);
+    g_string_free(pc->pgsIn, TRUE);
+    g_string_free(pc->pgsOut, TRUE);
+    g_free(pc);
+}
+
+static unsigned int
+ClientInterest(const extclient * pc)
+{
+    unsigned int n = 0;
+
+    if (ClientReadable(pc))
+        n |= EXT_READ;
+    if (pc->pgsOut->len)
+        n |= EXT_WRITE;
+
+    return n;
+}
+
+#if defined(__linux__)
+static void
+Watch(extserver * ps, int h, int op, unsigned int nInterest, void *p)
+{
+    struct epoll_event ev;
+
+    ev.events = (nInterest & EXT_READ ? EPOLLIN : 0) | (nInterest & EXT_WRITE ? EPOLLOUT : 0);
+#if defined(EPOLLEXCLUSIVE)
+    /* wake one of the processes sharing the listening socket, not all */
+    if (!p && ps->fShared)
+        ev.events |= EPOLLEXCLUSIVE;
+#endif
+    ev.data.ptr = p;
+    if (epoll_ctl(ps->hEpoll, op, h, &ev) < 0)
+        SockErr("epoll_ctl");
+}
+#endif
+
+static void
+ServerAccept(extserver * ps)
+{
+    struct sockaddr_in saRemote;
+    socklen_t saLen;
+    extclient *pc;
+    int h;
+
+    for (;;) {
+        /* Must set length when using windows */
+        saLen = sizeof(struct sockaddr);
+        if ((h = accept(ps->h, (struct sockaddr *) &saRemote, &saLen)) < 0) {
+            if (errno == EINTR)
+                continue;
+            if (!SocketWouldBlock())
+                SockErr("accept");
+            return;
+        }
+
+        if (ps->cClients >= cExternalMaxConnections) {
+            static const char szBusy[] = "Error: too many connections\n";
+
+            if (send(h, szBusy, sizeof(szBusy) - 1, 0) < 0)
+                SockErr(_("writing to external connection"));
+            closesocket(h);
+            continue;
+        }
+
+        SetNonBlocking(h);
+
+        pc = g_new0(extclient, 1);
+        pc->h = h;
+        /* rollout jobs are queued on behalf of the remote address */
+        g_strlcpy(pc->szAddress, inet_ntoa(saRemote.sin_addr), sizeof(pc->szAddress));
+        ExtInitParse(&pc->scanctx.scanner);
+        pc->pgsIn = g_string_new(NULL);
+        pc->pgsOut = g_string_new(NULL);
+        pc->pqRequests = g_queue_new();
+        pc->nInterest = EXT_READ;
+#if defined(__linux__)
+        Watch(ps, h, EPOLL_CTL_ADD, pc->nInterest, pc);
+#endif
+        ps->plClients = g_list_append(ps->plClients, pc);
+        ps->cClients++;
+
+        outputf(_("Accepted connection from %s.\n"), pc->szAddress);
+        outputx();
+    }
+}
+
+static void
+ClientEvent(extserver * ps, extclient * pc, unsigned int nReady)
+{
+    if (pc->h >= 0 && (nReady & EXT_READ))
+        ClientRead(ps, pc);
+    if (pc->h >= 0 && (nReady & EXT_WRITE))
+        ClientWrite(ps, pc);
+}
+
+#ifndef WIN32
+static void
+DrainWake(void)
+{
+    char ach[256];
+
+    while (read(ahWake[0], ach, sizeof(ach)) > 0);
+}
+#endif
+
+/* wait up to msTimeout milliseconds and handle what happens */
+static int
+ServerWait(extserver * ps, int msTimeout)
+{
+#if defined(__linux__)
+    struct epoll_event aev[EXT_MAX_EVENTS];
+    int i, n;
+
+    if ((n = epoll_wait(ps->hEpoll, aev, EXT_MAX_EVENTS, msTimeout)) < 0)
+        return errno == EINTR ? 0 : -1;
+
+    for (i = 0; i < n; i++) {
+        void *p = aev[i].data.ptr;
+
+        if (!p)
+            ServerAccept(ps);
+        else if (p == ahWake)
+            DrainWake();
+        else
+            ClientEvent(ps, p, (aev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR) ? EXT_READ : 0) |
+                        (aev[i].events & EPOLLOUT ? EXT_WRITE : 0));
+    }
+#else
+    fd_set fdsRead, fdsWrite;
+    struct timeval tv;
+    GList *pl;
+    int hMax = ps->h, n;
+
+    FD_ZERO(&fdsRead);
+    FD_ZERO(&fdsWrite);
+    FD_SET(ps->h, &fdsRead);
+#ifndef WIN32
+    FD_SET(ahWake[0], &fdsRead);
+    hMax = MAX(hMax, ahWake[0]);
+#endif
+    for (pl = ps->plClients; pl; pl = pl->next) {
+        extclient *pc = pl->data;
+
+        if (pc->h < 0)
+            continue;
+        if (pc->nInterest & EXT_READ)
+            FD_SET(pc->h, &fdsRead);
+        if (pc->nInterest & EXT_WRITE)
+            FD_SET(pc->h, &fdsWrite);
+        hMax = MAX(hMax, pc->h);
+    }
+
+    tv.tv_sec = msTimeout / 1000;
+    tv.tv_usec = (msTimeout % 1000) * 1000;
+
+    if ((n = select(hMax + 1, &fdsRead, &fdsWrite, NULL, &tv)) < 0)
+        return errno == EINTR ? 0 : -1;
+
+    if (n == 0)
+        return 0;
+
+    if (FD_ISSET(ps->h, &fdsRead))
+        ServerAccept(ps);
+#ifndef WIN32
+    if (FD_ISSET(ahWake[0], &fdsRead))
+        DrainWake();
+#endif
+    for (pl = ps->plClients; pl; pl = pl->next) {
+        extclient *pc = pl->data;
+
+        if (pc->h >= 0)
+            ClientEvent(ps, pc, (FD_ISSET(pc->h, &fdsRead) ? EXT_READ : 0) |
+                        (FD_ISSET(pc->h, &fdsWrite) ? EXT_WRITE : 0));
+    }
+#endif
+
+    return n;
+}
+
+/* the listening socket, or -1 */
+static int
+ServerListen(char *sz)
+{
+    struct sockaddr *psa;
+    socklen_t cb;
+    int h;
+
+    if ((h = ExternalSocket(&psa, &cb, sz)) < 0) {
+        SockErr(sz);
+        return -1;
+    }
+
+    if (bind(h, psa, cb) < 0) {
+        SockErr(sz);
+        closesocket(h);
+        g_free(psa);
+        return -1;
+    }
+
+    g_free(psa);
+
+    if (listen(h, SOMAXCONN) < 0) {
+        SockErr("listen");
+        closesocket(h);
+        return -1;
+    }
+
+    SetNonBlocking(h);
+    return h;
+}
+
+/* serve on the listening socket h, which ServerClose() will close */
+static int
+ServerStart(extserver * ps, int h)
+{
+    ps->h = h;
+
+#ifndef WIN32
+    if (pipe(ahWake) < 0) {
+        SockErr("pipe");
+        closesocket(ps->h);
+        return -1;
+    }
+    SetNonBlocking(ahWake[0]);
+    SetNonBlocking(ahWake[1]);
+#endif
+
+#if defined(__linux__)
+    if ((ps->hEpoll = epoll_create1(0)) < 0) {
+        SockErr("epoll_create1");
+        close(ahWake[0]);
+        close(ahWake[1]);
+        closesocket(ps->h);
+        return -1;
+    }
+    Watch(ps, ps->h, EPOLL_CTL_ADD, EXT_READ, NULL);
+    Watch(ps, ahWake[0], EPOLL_CTL_ADD, EXT_READ, ahWake);
+#endif
+
+    ps->pqRollouts = g_queue_new();
+#if defined(USE_MULTITHREAD)
+    ps->pg = MT_GroupNew(MT_PRIORITY_INTERACTIVE);
+#endif
+    return 0;
+}
+
+static int
+ServerOpen(extserver * ps, char *sz)
+{
+    int h = ServerListen(sz);
+
+    return h < 0 ? -1 : ServerStart(ps, h);
+}
+
+static void
+ServerClose(extserver * ps)
+{
+    GList *pl;
+
+    for (pl = ps->plClients; pl; pl = pl->next)
+        ClientClose(ps, pl->data);
+
+#if defined(USE_MULTITHREAD)
+    /* let the requests being evaluated finish */
+    MT_GroupCancel(ps->pg);
+    MT_GroupWait(ps->pg, NULL, 0, FALSE);
+    MT_GroupFree(ps->pg);
+#endif
+
+    /* ClientFree() disposes of the requests never rolled out */
+    g_queue_free(ps->pqRollouts);
+    g_list_foreach(ps->plClients, (GFunc) ClientFree, NULL);
+    g_list_free(ps->plClients);
+
+#if defined(__linux__)
+    close(ps->hEpoll);
+#endif
+#ifndef WIN32
+    close(ahWake[0]);
+    close(ahWake[1]);
+    ahWake[0] = ahWake[1] = -1;
+#endif
+    closesocket(ps->h);
+}
+
+/* send the answers that are ready and read more requests; returns the
+ * number of requests not yet answered */
+static unsigned int
+ServerFlush(extserver * ps)
+{
+    unsigned int cOutstanding = 0;
+    GList *pl, *plNext;
+
+    for (pl = ps->plClients; pl; pl = plNext) {
+        extclient *pc = pl->data;
+        unsigned int nInterest;
+
+        plNext = pl->next;
+        cOutstanding += ClientFlush(ps, pc);
+
+        if (pc->h < 0) {
+            if (g_queue_is_empty(pc->pqRequests)) {
+                ps->plClients = g_list_delete_link(ps->plClients, pl);
+                ClientFree(pc);
+            }
+            continue;
+        }
+
+        if ((nInterest = ClientInterest(pc)) != pc->nInterest) {
+#if defined(__linux__)
+            Watch(ps, pc->h, EPOLL_CTL_MOD, nInterest, pc);
+#endif
+            pc->nInterest = nInterest;
+        }
+    }
+
+    return cOutstanding;
+}
+
+/* Serve the clients from inside a rollout, which calls ProcessEvents()
+ * while it waits for its trials. New rollouts are only queued here, and
+ * the other requests go to the thread pool as usual. */
+static gboolean
+ServerYield(gpointer p)
+{
+    extserver *ps = p;
+
+    ServerFlush(ps);
+    if (ServerWait(ps, 0) > 0)
+        ServerFlush(ps);
+
+    return TRUE;
+}
+
+static void
+ServerRun(extserver * ps)
+{
+    int fIdle = FALSE;
+
+    while (!fInterrupt) {
+        unsigned int cOutstanding = ServerFlush(ps);
+        extrequest *prq = g_queue_pop_head(ps->pqRollouts);
+        int fBusy = FALSE;
+        int msTimeout, n;
+
+        /* roll out the boards that need it, or play queued rollout jobs
+         * while the controllers have nothing to say; the clients are
+         * served meanwhile */
+        if (prq || (fIdle && !cOutstanding)) {
+            guint nYield = g_timeout_add(EXT_YIELD_TIME, ServerYield, ps);
+
+            if (prq) {
+                ExtRequestTask(prq);
+                fBusy = TRUE;
+            } else
+                fBusy = RolloutQueueSlice();
+
+            g_source_remove(nYield);
+        }
+
+        if (fBusy)
+            msTimeout = 0;
+        else
+#ifdef WIN32
+            /* nothing wakes us when an answer is ready */
+            msTimeout = cOutstanding ? 10 : UI_UPDATETIME;
+#else
+            msTimeout = UI_UPDATETIME;
+#endif
+
+        if ((n = ServerWait(ps, msTimeout)) < 0) {
+            SockErr(_("waiting for external connections"));
+            break;
+        }
+        fIdle = n == 0;
+
+        ProcessEvents();
+    }
+}
+#endif
+
+extern void
+CommandExternal(char *sz)
+{
+
+#if !defined(HAVE_SOCKETS)
+    (void) sz;                  /* silence compiler warning */
+    outputl(_("This installation of GNU Backgammon was compiled without\n"
+              "socket support, and does not implement external controllers."));
+#else
+    extserver es;
+
+    sz = NextToken(&sz);
+
+    if (!sz || !*sz) {
+        outputl(_("You must specify the name of the socket to the external controller."));
+        return;
+    }
+
+    memset(&es, 0, sizeof(es));
+    ExtCacheInit();
+
+    if (ServerOpen(&es, sz) < 0)
+        return;
+
+    outputf(_("Waiting for connections from %s...\n"), sz);
+    outputx();
+    ProcessEvents();
+
+    ServerRun(&es);
+    ServerClose(&es);
+#endif
+}
+
+/*
+ * "gnubg --serve": the parent process has loaded the neural nets, the
+ * bearoff databases and the match equity table once; the workers forked
+ * here share them copy on write and accept on the same listening
+ * socket, each with its own threads and decision cache.  The parent
+ * restarts the workers that die until it is interrupted, then stops
+ * them.  Without fork() the server runs in this process alone.
+ */
+
+#if HAVE_SOCKETS && !defined(WIN32)
+
+#define EXT_SERVE_RESPAWN 1000000       /* microseconds between starts of a worker */
+
+typedef struct {
+    pid_t pid;                  /* 0 when not running */
+    gint64 tStarted;
+} extworker;
+
+/* the pid of the new worker, or -1; does not return in the worker */
+static pid_t
+ServeFork(int h, int fQueue)
+{
+    extserver es;
+    pid_t pid;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    if ((pid = fork()) != 0) {
+        if (pid < 0)
+            outputerr("fork");
+        return pid;
+    }
+
+    fInterrupt = FALSE;
+    PortableSignal(SIGINT, HandleInterrupt, NULL, FALSE);
+    PortableSignal(SIGTERM, HandleInterrupt, NULL, FALSE);
+
+#if defined(USE_MULTITHREAD)
+    MT_StartThreads();
+#endif
+
+    /* the workers would all play the same jobs and hand out the same ids */
+    if (!fQueue)
+        RolloutQueueDisable("the rollout queue is not available with more than one worker process");
+
+    memset(&es, 0, sizeof(es));
+    es.fShared = TRUE;
+    ExtCacheInit();
+
+    if (ServerStart(&es, h) < 0)
+        _exit(EXIT_FAILURE);
+
+    ServerRun(&es);
+    ServerClose(&es);
+
+    fflush(stdout);
+    fflush(stderr);
+    _exit(EXIT_SUCCESS);
+}
+
+static void
+ServeReaped(const extworker * pew, int nStatus)
+{
+    if (WIFSIGNALED(nStatus))
+        outputf(_("Worker %d was killed by signal %d.\n"), (int) pew->pid, WTERMSIG(nStatus));
+    else if (WIFEXITED(nStatus) && WEXITSTATUS(nStatus) != EXIT_SUCCESS)
+        outputf(_("Worker %d exited with status %d.\n"), (int) pew->pid, WEXITSTATUS(nStatus));
+    outputx();
+}
+#endif
+
+extern int
+ExternalServe(char *szAddress, unsigned int cWorkers)
+{
+#if !defined(HAVE_SOCKETS)
+    (void) szAddress;           /* silence compiler warning */
+    (void) cWorkers;            /* silence compiler warning */
+    outputl(_("This installation of GNU Backgammon was compiled without\n"
+              "socket support, and does not implement external controllers."));
+    return -1;
+#elif defined(WIN32)
+    (void) cWorkers;            /* silence compiler warning */
+    outputl(_("Worker processes are not supported on this platform; serving in this process."));
+    CommandExternal(szAddress);
+    return 0;
+#else
+    extworker *aew;
+    unsigned int i, cRunning = 0;
+    int h, fStopping = FALSE;
+
+    if (!cWorkers) {
+        /* enough to keep the processors busy */
+        unsigned int cProcessors = 1;
+
+#if GLIB_CHECK_VERSION (2,36,0)
+        cProcessors = g_get_num_processors();
+#endif
+        cWorkers = MAX(1, cProcessors / MAX(1, MT_GetNumThreads()));
+    }
+
+    if ((h = ServerListen(szAddress)) < 0)
+        return -1;
+
+#if defined(USE_MULTITHREAD)
+    /* each worker starts its own */
+    MT_StopThreads();
+#endif
+
+    fInterrupt = FALSE;
+    PortableSignal(SIGINT, HandleInterrupt, NULL, FALSE);
+    PortableSignal(SIGTERM, HandleInterrupt, NULL, FALSE);
+
+    outputf(_("Waiting for connections from %s with %u worker processes...\n"), szAddress, cWorkers);
+    outputx();
+
+    aew = g_new0(extworker, cWorkers);
+
+    while (!fInterrupt || cRunning) {
+        int nStatus;
+        pid_t pid;
+
+        for (i = 0; i < cWorkers && !fInterrupt; i++)
+            if (!aew[i].pid && g_get_monotonic_time() - aew[i].tStarted >= EXT_SERVE_RESPAWN) {
+                /* a worker failing at once is not restarted in a loop */
+                aew[i].tStarted = g_get_monotonic_time();
+                if ((pid = ServeFork(h, cWorkers == 1)) > 0) {
+                    aew[i].pid = pid;
+                    cRunning++;
+                }
+            }
+
+        if (fInterrupt && !fStopping) {
+            for (i = 0; i < cWorkers; i++)
+                if (aew[i].pid)
+                    kill(aew[i].pid, SIGTERM);
+            fStopping = TRUE;
+        }
+
+        if ((pid = waitpid(-1, &nStatus, WNOHANG)) <= 0) {
+            g_usleep(100000);
+            continue;
+        }
+
+        for (i = 0; i < cWorkers; i++)
+            if (aew[i].pid == pid) {
+                ServeReaped(&aew[i], nStatus);
+                aew[i].pid = 0;
+                cRunning--;
+            }
+    }
+
+    g_free(aew);
+    closesocket(h);
+    return 0;
 #endif
 }
@@ -155,6 +155,12 @@ typedef struct {
     TanBoard anBoard;
 } ProcessedFIBSBoard;
 
+#define EXT_OPTION_PLIES 1
+#define EXT_OPTION_CUBEFUL 2
+#define EXT_OPTION_NOISE 4
+#define EXT_OPTION_PRUNE 8
+#define EXT_OPTION_DETERMINISTIC 16
+
 typedef struct scancontext {
     /* scanner ptr must be first element in structure */
     void *scanner;
@@ -175,6 +181,13 @@ typedef struct scancontext {
     int fCubeful;
     int fUsePrune;
 
+    /* on board commands: which of the above were given (EXT_OPTION_*),
+     * the move filter preset (-1 for the global filter) and the deadline
+     * in ms (0 for none) */
+    unsigned int fEvalOptions;
+    int nFilter;
+    int msDeadline;
+
     /* session rules */
     int fJacobyRule;
     int fCrawfordRule;
@@ -188,6 +201,21 @@ typedef struct scancontext {
     };
 } scancontext;
 
+/* the fast path for board commands (extfast.c) */
+extern int ExtFastParse(scancontext * pec, const char *szCommand);
+extern const char *FastWord(const char **ppch, size_t * pcch);
+extern int FastWordIs(const char *pch, size_t cch, const char *sz);
+extern int FastInteger(const char *pch, size_t cch, int *pn);
+
+/* limits of the "external" server */
+extern unsigned int cExternalMaxConnections;
+extern unsigned int cExternalQueueLimit;
+extern unsigned int cExternalCacheSize;
+
+extern void ExternalCacheResize(void);
+extern void ExternalCacheStats(unsigned int *pcEntries, unsigned long *pcHits, unsigned long *pcMisses);
+extern int ExternalServe(char *szAddress, unsigned int cWorkers);
+
 #if HAVE_SOCKETS
 
 #ifndef WIN32
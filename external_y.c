@@ -169,10 +169,20 @@ void yyerror(scancontext *scanner, const char *str)
         fprintf(stderr,"Error: %s\n",str);
 }
 
+static unsigned int
+evaloption_given(GMap *optionsmap, const char *key, unsigned int flag)
+{
+    GString *gskey = g_string_new(key);
+    GMapEntry *entry = str2gv_map_has_key(optionsmap, gskey);
+
+    g_string_free(gskey, TRUE);
+    return entry ? flag : 0;
+}
+
 #endif
 
 
-#line 176 "external_y.c"
+#line 186 "external_y.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -291,7 +301,7 @@ extern int yydebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 114 "../gnubg/external_y.y"
+#line 124 "../gnubg/external_y.y"
 
     gboolean boolean;
     gchar character;
@@ -302,7 +312,7 @@ union YYSTYPE
     GList *list;
     commandinfo *cmd;
 
-#line 306 "external_y.c"
+#line 316 "external_y.c"
 
 };
 typedef union YYSTYPE YYSTYPE;
@@ -368,29 +378,28 @@ enum yysymbol_kind_t
   YYSYMBOL_endboard = 44,                  /* endboard  */
   YYSYMBOL_sessionoption = 45,             /* sessionoption  */
   YYSYMBOL_evaloption = 46,                /* evaloption  */
-  YYSYMBOL_sessionoptions = 47,            /* sessionoptions  */
-  YYSYMBOL_evaloptions = 48,               /* evaloptions  */
-  YYSYMBOL_boardcommand = 49,              /* boardcommand  */
-  YYSYMBOL_evalcommand = 50,               /* evalcommand  */
-  YYSYMBOL_board = 51,                     /* board  */
-  YYSYMBOL_float_type = 52,                /* float_type  */
-  YYSYMBOL_string_type = 53,               /* string_type  */
-  YYSYMBOL_integer_type = 54,              /* integer_type  */
-  YYSYMBOL_boolean_type = 55,              /* boolean_type  */
-  YYSYMBOL_list_type = 56,                 /* list_type  */
-  YYSYMBOL_basic_types = 57,               /* basic_types  */
-  YYSYMBOL_list = 58,                      /* list  */
-  YYSYMBOL_list_element = 59,              /* list_element  */
-  YYSYMBOL_list_elements = 60              /* list_elements  */
+  YYSYMBOL_evaloptions = 47,               /* evaloptions  */
+  YYSYMBOL_boardcommand = 48,              /* boardcommand  */
+  YYSYMBOL_evalcommand = 49,               /* evalcommand  */
+  YYSYMBOL_board = 50,                     /* board  */
+  YYSYMBOL_float_type = 51,                /* float_type  */
+  YYSYMBOL_string_type = 52,               /* string_type  */
+  YYSYMBOL_integer_type = 53,              /* integer_type  */
+  YYSYMBOL_boolean_type = 54,              /* boolean_type  */
+  YYSYMBOL_list_type = 55,                 /* list_type  */
+  YYSYMBOL_basic_types = 56,               /* basic_types  */
+  YYSYMBOL_list = 57,                      /* list  */
+  YYSYMBOL_list_element = 58,              /* list_element  */
+  YYSYMBOL_list_elements = 59              /* list_elements  */
 };
 typedef enum yysymbol_kind_t yysymbol_kind_t;
 
 
 /* Second part of user prologue.  */
-#line 125 "../gnubg/external_y.y"
+#line 135 "../gnubg/external_y.y"
 
 
-#line 394 "external_y.c"
+#line 403 "external_y.c"
 
 
 #ifdef short
@@ -714,16 +723,16 @@ union yyalloc
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  25
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   74
+#define YYLAST   70
 
 /* YYNTOKENS -- Number of terminals.  */
 #define YYNTOKENS  38
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  23
+#define YYNNTS  22
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  55
+#define YYNRULES  53
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  85
+#define YYNSTATES  84
 
 /* YYMAXUTOK -- Last valid token kind.  */
 #define YYMAXUTOK   288
@@ -775,12 +784,12 @@ static const yytype_int8 yytranslate[] =
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int16 yyrline[] =
 {
-       0,   173,   173,   179,   186,   192,   198,   204,   258,   263,
-     269,   275,   282,   290,   298,   310,   314,   319,   326,   330,
-     335,   340,   345,   352,   357,   362,   370,   375,   380,   385,
-     390,   395,   400,   408,   425,   433,   450,   455,   462,   476,
-     491,   503,   511,   520,   528,   536,   546,   546,   546,   546,
-     551,   558,   558,   563,   567,   572
+       0,   182,   182,   188,   195,   201,   207,   213,   276,   281,
+     287,   293,   300,   308,   316,   328,   332,   337,   344,   348,
+     353,   358,   363,   370,   375,   380,   388,   393,   398,   403,
+     408,   413,   418,   426,   443,   448,   455,   469,   484,   496,
+     504,   513,   521,   529,   539,   539,   539,   539,   544,   551,
+     551,   556,   560,   565
 };
 #endif
 
@@ -804,10 +813,9 @@ static const char *const yytname[] =
   "CUBEFUL", "CUBELESS", "DETERMINISTIC", "NOISE", "PLIES", "PRUNE", "':'",
   "'('", "')'", "','", "$accept", "commands", "setcommand", "command",
   "board_element", "board_elements", "endboard", "sessionoption",
-  "evaloption", "sessionoptions", "evaloptions", "boardcommand",
-  "evalcommand", "board", "float_type", "string_type", "integer_type",
-  "boolean_type", "list_type", "basic_types", "list", "list_element",
-  "list_elements", YY_NULLPTR
+  "evaloption", "evaloptions", "boardcommand", "evalcommand", "board",
+  "float_type", "string_type", "integer_type", "boolean_type", "list_type",
+  "basic_types", "list", "list_element", "list_elements", YY_NULLPTR
 };
 
 static const char *
@@ -817,7 +825,7 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 }
 #endif
 
-#define YYPACT_NINF (-49)
+#define YYPACT_NINF (-50)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
@@ -831,15 +839,15 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-       3,   -49,     7,   -23,    15,    10,    26,     0,    19,    32,
-      41,   -49,   -49,   -49,   -49,   -14,   -49,   -49,    27,    18,
-      34,    44,   -49,    16,    43,   -49,   -49,    12,   -49,   -49,
-     -49,   -49,   -49,   -49,   -49,   -49,   -49,   -49,   -49,   -49,
-       4,   -49,   -49,   -49,   -49,   -49,    49,   -49,    27,    27,
-      48,    27,   -49,   -49,   -14,    33,    29,   -49,   -49,   -49,
-     -49,   -49,    48,    27,   -49,   -49,    27,    25,    48,    27,
-     -49,   -49,   -49,    -8,   -49,   -49,   -49,   -49,   -49,   -49,
-     -49,   -49,    48,   -49,   -49
+       6,   -50,     0,   -22,    12,    11,    14,     9,    32,    53,
+      51,   -50,   -50,   -50,   -50,   -13,   -50,   -50,    36,    26,
+      41,    54,   -50,    24,    39,   -50,   -50,    18,   -50,   -50,
+     -50,   -50,   -50,   -50,   -50,   -50,   -50,   -50,   -50,   -50,
+     -16,   -50,   -50,   -50,   -50,   -50,    45,   -50,    36,    36,
+      44,    36,    36,   -50,   -50,    36,    21,    44,    36,   -50,
+     -50,   -50,   -13,    28,    18,   -50,   -50,   -50,   -50,   -50,
+     -50,   -50,   -50,   -50,   -50,   -50,    44,   -50,    -5,   -50,
+     -50,    44,   -50,   -50
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -848,30 +856,30 @@ static const yytype_int8 yypact[] =
 static const yytype_int8 yydefact[] =
 {
        0,     2,     0,     0,     0,     0,     0,     0,     0,     0,
-       0,    12,    13,    33,     6,    53,    14,     4,     0,     0,
-       0,     0,     5,     0,     0,     1,     7,    38,    42,    43,
-      41,    44,    48,    47,    49,    46,    52,    51,    45,    54,
-       0,     8,     9,    10,    11,     3,     0,    35,     0,     0,
-       0,     0,    34,    50,     0,     0,    39,    20,    19,    21,
-      22,    55,     0,     0,    31,    32,    28,     0,     0,    26,
-      37,    36,    16,     0,    15,    30,    29,    24,    25,    23,
-      27,    18,     0,    40,    17
+       0,    12,    13,    33,     6,    51,    14,     4,     0,     0,
+       0,     0,     5,     0,     0,     1,     7,    36,    40,    41,
+      39,    42,    46,    45,    47,    44,    50,    49,    43,    52,
+       0,     8,     9,    10,    11,     3,     0,    33,     0,     0,
+       0,     0,     0,    31,    32,    28,     0,     0,    26,    35,
+      34,    48,     0,     0,    37,    20,    19,    21,    22,    30,
+      29,    24,    25,    23,    27,    53,     0,    16,     0,    15,
+      18,     0,    38,    17
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -49,   -49,   -49,   -49,   -16,   -49,   -49,    13,   -49,   -49,
-     -49,   -49,   -49,    46,     1,    51,   -48,   -18,   -49,   -49,
-      69,    20,   -49
+     -50,   -50,   -50,   -50,   -17,   -50,   -50,   -50,   -50,    16,
+     -50,   -50,    42,    13,    47,   -49,   -18,   -50,   -50,    62,
+       8,   -50
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-       0,     9,    21,    10,    72,    73,    83,    52,    71,    27,
-      56,    11,    12,    13,    32,    33,    34,    35,    36,    37,
-      38,    39,    40
+       0,     9,    21,    10,    77,    78,    82,    59,    60,    27,
+      11,    12,    13,    32,    33,    34,    35,    36,    37,    38,
+      39,    40
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -879,26 +887,26 @@ static const yytype_int8 yydefgoto[] =
    number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int8 yytable[] =
 {
-      41,    28,    59,    29,    30,    31,     1,     2,     3,     4,
-      14,     5,    15,    81,    74,    23,     6,    18,    17,    78,
-      79,    15,    19,     7,    20,     8,    82,    42,    43,    22,
-      57,    58,    25,    60,    74,    48,    49,    50,    51,    24,
-      53,    54,    29,    30,    26,    75,    31,    45,    76,    28,
-      46,    80,    48,    49,    50,    51,    63,    64,    65,    66,
-      67,    68,    69,     7,    55,    29,    84,    62,    77,    70,
-      47,    44,    16,     0,    61
+      41,    67,    28,    14,    29,    30,    31,    72,    73,     1,
+       2,     3,     4,    15,     5,    17,    80,    22,    18,     6,
+      61,    62,    15,    19,    23,    20,     7,    79,     8,    81,
+      65,    66,    79,    68,    69,    42,    43,    70,    29,    30,
+      74,    48,    49,    50,    51,    52,    53,    54,    55,    56,
+      57,    58,    24,    25,    26,    31,    28,    45,    46,     7,
+      63,    29,    76,    64,    83,    16,    47,    44,     0,    71,
+      75
 };
 
 static const yytype_int8 yycheck[] =
 {
-      18,    15,    50,    17,    18,    19,     3,     4,     5,     6,
-       3,     8,    35,    21,    62,    15,    13,     7,     3,    67,
-      68,    35,    12,    20,    14,    22,    34,     9,    10,     3,
-      48,    49,     0,    51,    82,    23,    24,    25,    26,    20,
-      36,    37,    17,    18,     3,    63,    19,     3,    66,    15,
-      34,    69,    23,    24,    25,    26,    27,    28,    29,    30,
-      31,    32,    33,    20,    15,    17,    82,    34,    67,    56,
-      24,    20,     3,    -1,    54
+      18,    50,    15,     3,    17,    18,    19,    56,    57,     3,
+       4,     5,     6,    35,     8,     3,    21,     3,     7,    13,
+      36,    37,    35,    12,    15,    14,    20,    76,    22,    34,
+      48,    49,    81,    51,    52,     9,    10,    55,    17,    18,
+      58,    23,    24,    25,    26,    27,    28,    29,    30,    31,
+      32,    33,    20,     0,     3,    19,    15,     3,    34,    20,
+      15,    17,    34,    47,    81,     3,    24,    20,    -1,    56,
+      62
 };
 
 /* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
@@ -906,14 +914,14 @@ static const yytype_int8 yycheck[] =
 static const yytype_int8 yystos[] =
 {
        0,     3,     4,     5,     6,     8,    13,    20,    22,    39,
-      41,    49,    50,    51,     3,    35,    58,     3,     7,    12,
+      41,    48,    49,    50,     3,    35,    57,     3,     7,    12,
       14,    40,     3,    15,    20,     0,     3,    47,    15,    17,
-      18,    19,    52,    53,    54,    55,    56,    57,    58,    59,
-      60,    55,     9,    10,    53,     3,    34,    51,    23,    24,
-      25,    26,    45,    36,    37,    15,    48,    55,    55,    54,
-      55,    59,    34,    27,    28,    29,    30,    31,    32,    33,
-      45,    46,    42,    43,    54,    55,    55,    52,    54,    54,
-      55,    21,    34,    44,    42
+      18,    19,    51,    52,    53,    54,    55,    56,    57,    58,
+      59,    54,     9,    10,    52,     3,    34,    50,    23,    24,
+      25,    26,    27,    28,    29,    30,    31,    32,    33,    45,
+      46,    36,    37,    15,    47,    54,    54,    53,    54,    54,
+      54,    51,    53,    53,    54,    58,    34,    42,    43,    53,
+      21,    34,    44,    42
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
@@ -922,9 +930,9 @@ static const yytype_int8 yyr1[] =
        0,    38,    39,    39,    39,    39,    39,    39,    40,    40,
       40,    40,    41,    41,    41,    42,    43,    43,    44,    45,
       45,    45,    45,    46,    46,    46,    46,    46,    46,    46,
-      46,    46,    46,    47,    47,    48,    48,    48,    49,    50,
-      51,    52,    53,    54,    55,    56,    57,    57,    57,    57,
-      58,    59,    59,    60,    60,    60
+      46,    46,    46,    47,    47,    47,    48,    49,    50,    51,
+      52,    53,    54,    55,    56,    56,    56,    56,    57,    58,
+      58,    59,    59,    59
 };
 
 /* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
@@ -933,9 +941,9 @@ static const yytype_int8 yyr2[] =
        0,     2,     1,     3,     2,     2,     2,     2,     2,     2,
        2,     2,     1,     1,     2,     1,     1,     3,     1,     2,
        2,     2,     2,     2,     2,     2,     1,     2,     1,     2,
-       2,     1,     1,     0,     2,     0,     2,     2,     2,     4,
-       7,     1,     1,     1,     1,     1,     1,     1,     1,     1,
-       3,     1,     1,     0,     1,     3
+       2,     1,     1,     0,     2,     2,     2,     4,     7,     1,
+       1,     1,     1,     1,     1,     1,     1,     1,     3,     1,
+       1,     0,     1,     3
 };
 
 
@@ -1408,129 +1416,123 @@ yydestruct (const char *yymsg,
   switch (yykind)
     {
     case YYSYMBOL_E_STRING: /* E_STRING  */
-#line 166 "../gnubg/external_y.y"
+#line 175 "../gnubg/external_y.y"
             { if (((*yyvaluep).str)) g_string_free(((*yyvaluep).str), TRUE); }
-#line 1414 "external_y.c"
+#line 1422 "external_y.c"
         break;
 
     case YYSYMBOL_setcommand: /* setcommand  */
-#line 167 "../gnubg/external_y.y"
+#line 176 "../gnubg/external_y.y"
             { if (((*yyvaluep).list)) g_list_free(((*yyvaluep).list)); }
-#line 1420 "external_y.c"
+#line 1428 "external_y.c"
         break;
 
     case YYSYMBOL_command: /* command  */
-#line 169 "../gnubg/external_y.y"
+#line 178 "../gnubg/external_y.y"
             { if (((*yyvaluep).cmd)) { g_free(((*yyvaluep).cmd)); }}
-#line 1426 "external_y.c"
+#line 1434 "external_y.c"
         break;
 
     case YYSYMBOL_board_element: /* board_element  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1432 "external_y.c"
+#line 1440 "external_y.c"
         break;
 
     case YYSYMBOL_board_elements: /* board_elements  */
-#line 167 "../gnubg/external_y.y"
+#line 176 "../gnubg/external_y.y"
             { if (((*yyvaluep).list)) g_list_free(((*yyvaluep).list)); }
-#line 1438 "external_y.c"
+#line 1446 "external_y.c"
         break;
 
     case YYSYMBOL_sessionoption: /* sessionoption  */
-#line 167 "../gnubg/external_y.y"
+#line 176 "../gnubg/external_y.y"
             { if (((*yyvaluep).list)) g_list_free(((*yyvaluep).list)); }
-#line 1444 "external_y.c"
+#line 1452 "external_y.c"
         break;
 
     case YYSYMBOL_evaloption: /* evaloption  */
-#line 167 "../gnubg/external_y.y"
-            { if (((*yyvaluep).list)) g_list_free(((*yyvaluep).list)); }
-#line 1450 "external_y.c"
-        break;
-
-    case YYSYMBOL_sessionoptions: /* sessionoptions  */
-#line 167 "../gnubg/external_y.y"
+#line 176 "../gnubg/external_y.y"
             { if (((*yyvaluep).list)) g_list_free(((*yyvaluep).list)); }
-#line 1456 "external_y.c"
+#line 1458 "external_y.c"
         break;
 
     case YYSYMBOL_evaloptions: /* evaloptions  */
-#line 167 "../gnubg/external_y.y"
+#line 176 "../gnubg/external_y.y"
             { if (((*yyvaluep).list)) g_list_free(((*yyvaluep).list)); }
-#line 1462 "external_y.c"
+#line 1464 "external_y.c"
         break;
 
     case YYSYMBOL_boardcommand: /* boardcommand  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1468 "external_y.c"
+#line 1470 "external_y.c"
         break;
 
     case YYSYMBOL_evalcommand: /* evalcommand  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1474 "external_y.c"
+#line 1476 "external_y.c"
         break;
 
     case YYSYMBOL_board: /* board  */
-#line 167 "../gnubg/external_y.y"
+#line 176 "../gnubg/external_y.y"
             { if (((*yyvaluep).list)) g_list_free(((*yyvaluep).list)); }
-#line 1480 "external_y.c"
+#line 1482 "external_y.c"
         break;
 
     case YYSYMBOL_float_type: /* float_type  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1486 "external_y.c"
+#line 1488 "external_y.c"
         break;
 
     case YYSYMBOL_string_type: /* string_type  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1492 "external_y.c"
+#line 1494 "external_y.c"
         break;
 
     case YYSYMBOL_integer_type: /* integer_type  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1498 "external_y.c"
+#line 1500 "external_y.c"
         break;
 
     case YYSYMBOL_boolean_type: /* boolean_type  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1504 "external_y.c"
+#line 1506 "external_y.c"
         break;
 
     case YYSYMBOL_list_type: /* list_type  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1510 "external_y.c"
+#line 1512 "external_y.c"
         break;
 
     case YYSYMBOL_basic_types: /* basic_types  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1516 "external_y.c"
+#line 1518 "external_y.c"
         break;
 
     case YYSYMBOL_list: /* list  */
-#line 167 "../gnubg/external_y.y"
+#line 176 "../gnubg/external_y.y"
             { if (((*yyvaluep).list)) g_list_free(((*yyvaluep).list)); }
-#line 1522 "external_y.c"
+#line 1524 "external_y.c"
         break;
 
     case YYSYMBOL_list_element: /* list_element  */
-#line 168 "../gnubg/external_y.y"
+#line 177 "../gnubg/external_y.y"
             { if (((*yyvaluep).gv)) { g_value_unsetfree(((*yyvaluep).gv)); }}
-#line 1528 "external_y.c"
+#line 1530 "external_y.c"
         break;
 
     case YYSYMBOL_list_elements: /* list_elements  */
-#line 167 "../gnubg/external_y.y"
+#line 176 "../gnubg/external_y.y"
             { if (((*yyvaluep).list)) g_list_free(((*yyvaluep).list)); }
-#line 1534 "external_y.c"
+#line 1536 "external_y.c"
         break;
 
       default:
@@ -1807,53 +1809,53 @@ yyreduce:
   switch (yyn)
     {
   case 2: /* commands: EOL  */
-#line 174 "../gnubg/external_y.y"
+#line 183 "../gnubg/external_y.y"
         {
             extcmd->ct = COMMAND_NONE;
             YYACCEPT;
         }
-#line 1816 "external_y.c"
+#line 1818 "external_y.c"
     break;
 
   case 3: /* commands: SET setcommand EOL  */
-#line 180 "../gnubg/external_y.y"
+#line 189 "../gnubg/external_y.y"
         {
             extcmd->pCmdData = (yyvsp[-1].list);
             extcmd->ct = COMMAND_SET;
             YYACCEPT;
         }
-#line 1826 "external_y.c"
+#line 1828 "external_y.c"
     break;
 
   case 4: /* commands: INTERFACEVERSION EOL  */
-#line 187 "../gnubg/external_y.y"
+#line 196 "../gnubg/external_y.y"
         {
             extcmd->ct = COMMAND_VERSION;
             YYACCEPT;
         }
-#line 1835 "external_y.c"
+#line 1837 "external_y.c"
     break;
 
   case 5: /* commands: HELP EOL  */
-#line 193 "../gnubg/external_y.y"
+#line 202 "../gnubg/external_y.y"
         {
             extcmd->ct = COMMAND_HELP;
             YYACCEPT;
         }
-#line 1844 "external_y.c"
+#line 1846 "external_y.c"
     break;
 
   case 6: /* commands: EXIT EOL  */
-#line 199 "../gnubg/external_y.y"
+#line 208 "../gnubg/external_y.y"
         {
             extcmd->ct = COMMAND_EXIT;
             YYACCEPT;
         }
-#line 1853 "external_y.c"
+#line 1855 "external_y.c"
     break;
 
   case 7: /* commands: command EOL  */
-#line 205 "../gnubg/external_y.y"
+#line 214 "../gnubg/external_y.y"
         {
             if ((yyvsp[-1].cmd)->cmdType == COMMAND_LIST) {
                 g_value_unsetfree((yyvsp[-1].cmd)->pvData);
@@ -1890,6 +1892,15 @@ yyreduce:
                     extcmd->nResignation = g_value_get_int(str2gv_map_get_key_value(optionsmap, KEY_STR_RESIGNATION, gvfalse));
                     extcmd->fBeavers = g_value_get_int(str2gv_map_get_key_value(optionsmap, KEY_STR_BEAVERS, gvtrue));
 
+                    /* a board command only overrides what it names */
+                    extcmd->fEvalOptions = 0;
+                    if (extcmd->ct == COMMAND_FIBSBOARD)
+                        extcmd->fEvalOptions = evaloption_given(optionsmap, KEY_STR_PLIES, EXT_OPTION_PLIES)
+                            | evaloption_given(optionsmap, KEY_STR_CUBEFUL, EXT_OPTION_CUBEFUL)
+                            | evaloption_given(optionsmap, KEY_STR_NOISE, EXT_OPTION_NOISE)
+                            | evaloption_given(optionsmap, KEY_STR_PRUNE, EXT_OPTION_PRUNE)
+                            | evaloption_given(optionsmap, KEY_STR_DETERMINISTIC, EXT_OPTION_DETERMINISTIC);
+
                     g_value_unsetfree(gvtrue);
                     g_value_unsetfree(gvfalse);
                     g_value_unsetfree(gvfloatzero);
@@ -1904,67 +1915,67 @@ yyreduce:
                 }
             }
         }
-#line 1908 "external_y.c"
+#line 1919 "external_y.c"
     break;
 
   case 8: /* setcommand: DEBUG boolean_type  */
-#line 259 "../gnubg/external_y.y"
+#line 277 "../gnubg/external_y.y"
         {
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_DEBUG, (yyvsp[0].gv));
         }
-#line 1916 "external_y.c"
+#line 1927 "external_y.c"
     break;
 
   case 9: /* setcommand: E_INTERFACE NEW  */
-#line 264 "../gnubg/external_y.y"
+#line 282 "../gnubg/external_y.y"
         {
             GVALUE_CREATE(G_TYPE_INT, int, 1, gvint); 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_NEWINTERFACE, gvint);
         }
-#line 1925 "external_y.c"
+#line 1936 "external_y.c"
     break;
 
   case 10: /* setcommand: E_INTERFACE OLD  */
-#line 270 "../gnubg/external_y.y"
+#line 288 "../gnubg/external_y.y"
         {
             GVALUE_CREATE(G_TYPE_INT, int, 0, gvint); 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_NEWINTERFACE, gvint);
         }
-#line 1934 "external_y.c"
+#line 1945 "external_y.c"
     break;
 
   case 11: /* setcommand: PROMPT string_type  */
-#line 276 "../gnubg/external_y.y"
+#line 294 "../gnubg/external_y.y"
         {
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_PROMPT, (yyvsp[0].gv));
         }
-#line 1942 "external_y.c"
+#line 1953 "external_y.c"
     break;
 
   case 12: /* command: boardcommand  */
-#line 283 "../gnubg/external_y.y"
+#line 301 "../gnubg/external_y.y"
         {
             commandinfo *cmdInfo = g_malloc0(sizeof(commandinfo));
             cmdInfo->pvData = (yyvsp[0].gv);
             cmdInfo->cmdType = COMMAND_FIBSBOARD;
             (yyval.cmd) = cmdInfo;
         }
-#line 1953 "external_y.c"
+#line 1964 "external_y.c"
     break;
 
   case 13: /* command: evalcommand  */
-#line 291 "../gnubg/external_y.y"
+#line 309 "../gnubg/external_y.y"
         {
             commandinfo *cmdInfo = g_malloc0(sizeof(commandinfo));
             cmdInfo->pvData = (yyvsp[0].gv);
             cmdInfo->cmdType = COMMAND_EVALUATION;
             (yyval.cmd) = cmdInfo;
         }
-#line 1964 "external_y.c"
+#line 1975 "external_y.c"
     break;
 
   case 14: /* command: DISABLED list  */
-#line 299 "../gnubg/external_y.y"
+#line 317 "../gnubg/external_y.y"
         { 
             GVALUE_CREATE(G_TYPE_BOXED_GLIST_GV, boxed, (yyvsp[0].list), gvptr);
             g_list_free((yyvsp[0].list));
@@ -1973,171 +1984,142 @@ yyreduce:
             cmdInfo->cmdType = COMMAND_LIST;
             (yyval.cmd) = cmdInfo;
         }
-#line 1977 "external_y.c"
+#line 1988 "external_y.c"
     break;
 
   case 16: /* board_elements: board_element  */
-#line 315 "../gnubg/external_y.y"
+#line 333 "../gnubg/external_y.y"
         { 
             (yyval.list) = g_list_prepend(NULL, (yyvsp[0].gv)); 
         }
-#line 1985 "external_y.c"
+#line 1996 "external_y.c"
     break;
 
   case 17: /* board_elements: board_elements ':' board_element  */
-#line 320 "../gnubg/external_y.y"
+#line 338 "../gnubg/external_y.y"
         { 
             (yyval.list) = g_list_prepend((yyvsp[-2].list), (yyvsp[0].gv)); 
         }
-#line 1993 "external_y.c"
+#line 2004 "external_y.c"
     break;
 
   case 19: /* sessionoption: JACOBYRULE boolean_type  */
-#line 331 "../gnubg/external_y.y"
+#line 349 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_JACOBYRULE, (yyvsp[0].gv)); 
         }
-#line 2001 "external_y.c"
+#line 2012 "external_y.c"
     break;
 
   case 20: /* sessionoption: CRAWFORDRULE boolean_type  */
-#line 336 "../gnubg/external_y.y"
+#line 354 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_CRAWFORDRULE, (yyvsp[0].gv));
         }
-#line 2009 "external_y.c"
+#line 2020 "external_y.c"
     break;
 
   case 21: /* sessionoption: RESIGNATION integer_type  */
-#line 341 "../gnubg/external_y.y"
+#line 359 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_RESIGNATION, (yyvsp[0].gv));
         }
-#line 2017 "external_y.c"
+#line 2028 "external_y.c"
     break;
 
   case 22: /* sessionoption: BEAVERS boolean_type  */
-#line 346 "../gnubg/external_y.y"
+#line 364 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_BEAVERS, (yyvsp[0].gv));
         }
-#line 2025 "external_y.c"
+#line 2036 "external_y.c"
     break;
 
   case 23: /* evaloption: PLIES integer_type  */
-#line 353 "../gnubg/external_y.y"
+#line 371 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_PLIES, (yyvsp[0].gv)); 
         }
-#line 2033 "external_y.c"
+#line 2044 "external_y.c"
     break;
 
   case 24: /* evaloption: NOISE float_type  */
-#line 358 "../gnubg/external_y.y"
+#line 376 "../gnubg/external_y.y"
         {
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_NOISE, (yyvsp[0].gv)); 
         }
-#line 2041 "external_y.c"
+#line 2052 "external_y.c"
     break;
 
   case 25: /* evaloption: NOISE integer_type  */
-#line 363 "../gnubg/external_y.y"
+#line 381 "../gnubg/external_y.y"
         {
             float floatval = (float) g_value_get_int((yyvsp[0].gv)) / 10000.0f;
             GVALUE_CREATE(G_TYPE_FLOAT, float, floatval, gvfloat); 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_NOISE, gvfloat); 
             g_value_unsetfree((yyvsp[0].gv));
         }
-#line 2052 "external_y.c"
+#line 2063 "external_y.c"
     break;
 
   case 26: /* evaloption: PRUNE  */
-#line 371 "../gnubg/external_y.y"
+#line 389 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2int_tuple (KEY_STR_PRUNE, TRUE);
         }
-#line 2060 "external_y.c"
+#line 2071 "external_y.c"
     break;
 
   case 27: /* evaloption: PRUNE boolean_type  */
-#line 376 "../gnubg/external_y.y"
+#line 394 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_PRUNE, (yyvsp[0].gv));
         }
-#line 2068 "external_y.c"
+#line 2079 "external_y.c"
     break;
 
   case 28: /* evaloption: DETERMINISTIC  */
-#line 381 "../gnubg/external_y.y"
+#line 399 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2int_tuple (KEY_STR_DETERMINISTIC, TRUE);
         }
-#line 2076 "external_y.c"
+#line 2087 "external_y.c"
     break;
 
   case 29: /* evaloption: DETERMINISTIC boolean_type  */
-#line 386 "../gnubg/external_y.y"
+#line 404 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_DETERMINISTIC, (yyvsp[0].gv));
         }
-#line 2084 "external_y.c"
+#line 2095 "external_y.c"
     break;
 
   case 30: /* evaloption: CUBE boolean_type  */
-#line 391 "../gnubg/external_y.y"
+#line 409 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2gvalue_tuple (KEY_STR_CUBEFUL, (yyvsp[0].gv));
         }
-#line 2092 "external_y.c"
+#line 2103 "external_y.c"
     break;
 
   case 31: /* evaloption: CUBEFUL  */
-#line 396 "../gnubg/external_y.y"
+#line 414 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2int_tuple (KEY_STR_CUBEFUL, TRUE); 
         }
-#line 2100 "external_y.c"
+#line 2111 "external_y.c"
     break;
 
   case 32: /* evaloption: CUBELESS  */
-#line 401 "../gnubg/external_y.y"
+#line 419 "../gnubg/external_y.y"
         { 
             (yyval.list) = create_str2int_tuple (KEY_STR_CUBEFUL, FALSE); 
         }
-#line 2108 "external_y.c"
+#line 2119 "external_y.c"
     break;
 
-  case 33: /* sessionoptions: %empty  */
-#line 408 "../gnubg/external_y.y"
-        { 
-            /* Setup the defaults */
-            STR2GV_MAPENTRY_CREATE(KEY_STR_JACOBYRULE, fJacoby, G_TYPE_INT, 
-                                    int, jacobyentry);
-            STR2GV_MAPENTRY_CREATE(KEY_STR_CRAWFORDRULE, TRUE, G_TYPE_INT, 
-                                    int, crawfordentry);
-            STR2GV_MAPENTRY_CREATE(KEY_STR_RESIGNATION, FALSE, G_TYPE_INT, 
-                                    int, resignentry);
-            STR2GV_MAPENTRY_CREATE(KEY_STR_BEAVERS, TRUE, G_TYPE_INT, 
-                                    int, beaversentry);
-
-            GList *defaults = 
-                g_list_prepend(g_list_prepend(g_list_prepend(g_list_prepend(NULL, jacobyentry), crawfordentry), \
-                               resignentry), beaversentry);
-            (yyval.list) = defaults;
-        }
-#line 2129 "external_y.c"
-    break;
-
-  case 34: /* sessionoptions: sessionoptions sessionoption  */
+  case 33: /* evaloptions: %empty  */
 #line 426 "../gnubg/external_y.y"
-        { 
-            STR2GV_MAP_ADD_ENTRY((yyvsp[-1].list), (yyvsp[0].list), (yyval.list)); 
-        }
-#line 2137 "external_y.c"
-    break;
-
-  case 35: /* evaloptions: %empty  */
-#line 433 "../gnubg/external_y.y"
         { 
             /* Setup the defaults */
             STR2GV_MAPENTRY_CREATE(KEY_STR_JACOBYRULE, fJacoby, G_TYPE_INT, 
@@ -2154,27 +2136,27 @@ yyreduce:
                                resignentry), beaversentry);
             (yyval.list) = defaults;
         }
-#line 2158 "external_y.c"
+#line 2140 "external_y.c"
     break;
 
-  case 36: /* evaloptions: evaloptions evaloption  */
-#line 451 "../gnubg/external_y.y"
+  case 34: /* evaloptions: evaloptions evaloption  */
+#line 444 "../gnubg/external_y.y"
         { 
             STR2GV_MAP_ADD_ENTRY((yyvsp[-1].list), (yyvsp[0].list), (yyval.list)); 
         }
-#line 2166 "external_y.c"
+#line 2148 "external_y.c"
     break;
 
-  case 37: /* evaloptions: evaloptions sessionoption  */
-#line 456 "../gnubg/external_y.y"
+  case 35: /* evaloptions: evaloptions sessionoption  */
+#line 449 "../gnubg/external_y.y"
         { 
             STR2GV_MAP_ADD_ENTRY((yyvsp[-1].list), (yyvsp[0].list), (yyval.list)); 
         }
-#line 2174 "external_y.c"
+#line 2156 "external_y.c"
     break;
 
-  case 38: /* boardcommand: board sessionoptions  */
-#line 463 "../gnubg/external_y.y"
+  case 36: /* boardcommand: board evaloptions  */
+#line 456 "../gnubg/external_y.y"
         {
             GVALUE_CREATE(G_TYPE_BOXED_GLIST_GV, boxed, (yyvsp[-1].list), gvptr1);
             GVALUE_CREATE(G_TYPE_BOXED_MAP_GV, boxed, (yyvsp[0].list), gvptr2);
@@ -2185,11 +2167,11 @@ yyreduce:
             g_list_free((yyvsp[-1].list));
             g_list_free((yyvsp[0].list));
         }
-#line 2189 "external_y.c"
+#line 2171 "external_y.c"
     break;
 
-  case 39: /* evalcommand: EVALUATION FIBSBOARD board evaloptions  */
-#line 477 "../gnubg/external_y.y"
+  case 37: /* evalcommand: EVALUATION FIBSBOARD board evaloptions  */
+#line 470 "../gnubg/external_y.y"
         {
             GVALUE_CREATE(G_TYPE_BOXED_GLIST_GV, boxed, (yyvsp[-1].list), gvptr1);
             GVALUE_CREATE(G_TYPE_BOXED_MAP_GV, boxed, (yyvsp[0].list), gvptr2);
@@ -2201,11 +2183,11 @@ yyreduce:
             g_list_free((yyvsp[-1].list));
             g_list_free((yyvsp[0].list));
         }
-#line 2205 "external_y.c"
+#line 2187 "external_y.c"
     break;
 
-  case 40: /* board: FIBSBOARD E_STRING ':' E_STRING ':' board_elements endboard  */
-#line 492 "../gnubg/external_y.y"
+  case 38: /* board: FIBSBOARD E_STRING ':' E_STRING ':' board_elements endboard  */
+#line 485 "../gnubg/external_y.y"
         {
             GVALUE_CREATE(G_TYPE_GSTRING, boxed, (yyvsp[-3].str), gvstr1); 
             GVALUE_CREATE(G_TYPE_GSTRING, boxed, (yyvsp[-5].str), gvstr2); 
@@ -2214,90 +2196,90 @@ yyreduce:
             g_string_free((yyvsp[-3].str), TRUE);
             g_string_free((yyvsp[-5].str), TRUE);
         }
-#line 2218 "external_y.c"
+#line 2200 "external_y.c"
     break;
 
-  case 41: /* float_type: E_FLOAT  */
-#line 504 "../gnubg/external_y.y"
+  case 39: /* float_type: E_FLOAT  */
+#line 497 "../gnubg/external_y.y"
         { 
             GVALUE_CREATE(G_TYPE_FLOAT, float, (yyvsp[0].floatnum), gvfloat); 
             (yyval.gv) = gvfloat; 
         }
-#line 2227 "external_y.c"
+#line 2209 "external_y.c"
     break;
 
-  case 42: /* string_type: E_STRING  */
-#line 512 "../gnubg/external_y.y"
+  case 40: /* string_type: E_STRING  */
+#line 505 "../gnubg/external_y.y"
         { 
             GVALUE_CREATE(G_TYPE_GSTRING, boxed, (yyvsp[0].str), gvstr); 
             g_string_free ((yyvsp[0].str), TRUE); 
             (yyval.gv) = gvstr; 
         }
-#line 2237 "external_y.c"
+#line 2219 "external_y.c"
     break;
 
-  case 43: /* integer_type: E_INTEGER  */
-#line 521 "../gnubg/external_y.y"
+  case 41: /* integer_type: E_INTEGER  */
+#line 514 "../gnubg/external_y.y"
         { 
             GVALUE_CREATE(G_TYPE_INT, int, (yyvsp[0].intnum), gvint); 
             (yyval.gv) = gvint; 
         }
-#line 2246 "external_y.c"
+#line 2228 "external_y.c"
     break;
 
-  case 44: /* boolean_type: E_BOOLEAN  */
-#line 529 "../gnubg/external_y.y"
+  case 42: /* boolean_type: E_BOOLEAN  */
+#line 522 "../gnubg/external_y.y"
         { 
             GVALUE_CREATE(G_TYPE_INT, int, (yyvsp[0].boolean), gvint); 
             (yyval.gv) = gvint; 
         }
-#line 2255 "external_y.c"
+#line 2237 "external_y.c"
     break;
 
-  case 45: /* list_type: list  */
-#line 537 "../gnubg/external_y.y"
+  case 43: /* list_type: list  */
+#line 530 "../gnubg/external_y.y"
         { 
             GVALUE_CREATE(G_TYPE_BOXED_GLIST_GV, boxed, (yyvsp[0].list), gvptr);
             g_list_free((yyvsp[0].list));
             (yyval.gv) = gvptr;
         }
-#line 2265 "external_y.c"
+#line 2247 "external_y.c"
     break;
 
-  case 50: /* list: '(' list_elements ')'  */
-#line 552 "../gnubg/external_y.y"
+  case 48: /* list: '(' list_elements ')'  */
+#line 545 "../gnubg/external_y.y"
         { 
             (yyval.list) = g_list_reverse((yyvsp[-1].list));
         }
-#line 2273 "external_y.c"
+#line 2255 "external_y.c"
     break;
 
-  case 53: /* list_elements: %empty  */
-#line 563 "../gnubg/external_y.y"
+  case 51: /* list_elements: %empty  */
+#line 556 "../gnubg/external_y.y"
         { 
             (yyval.list) = NULL; 
         }
-#line 2281 "external_y.c"
+#line 2263 "external_y.c"
     break;
 
-  case 54: /* list_elements: list_element  */
-#line 568 "../gnubg/external_y.y"
+  case 52: /* list_elements: list_element  */
+#line 561 "../gnubg/external_y.y"
         { 
             (yyval.list) = g_list_prepend(NULL, (yyvsp[0].gv));
         }
-#line 2289 "external_y.c"
+#line 2271 "external_y.c"
     break;
 
-  case 55: /* list_elements: list_elements ',' list_element  */
-#line 573 "../gnubg/external_y.y"
+  case 53: /* list_elements: list_elements ',' list_element  */
+#line 566 "../gnubg/external_y.y"
         { 
             (yyval.list) = g_list_prepend((yyvsp[-2].list), (yyvsp[0].gv)); 
         }
-#line 2297 "external_y.c"
+#line 2279 "external_y.c"
     break;
 
 
-#line 2301 "external_y.c"
+#line 2283 "external_y.c"
 
       default: break;
     }
@@ -2521,7 +2503,7 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 577 "../gnubg/external_y.y"
+#line 570 "../gnubg/external_y.y"
 
 
 #ifdef EXTERNAL_TEST
@@ -129,7 +129,7 @@ extern int yydebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 114 "../gnubg/external_y.y"
+#line 124 "../gnubg/external_y.y"
 
     gboolean boolean;
     gchar character;
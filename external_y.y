@@ -99,6 +99,16 @@ void yyerror(scancontext *scanner, const char *str)
         fprintf(stderr,"Error: %s\n",str);
 }
 
+static unsigned int
+evaloption_given(GMap *optionsmap, const char *key, unsigned int flag)
+{
+    GString *gskey = g_string_new(key);
+    GMapEntry *entry = str2gv_map_has_key(optionsmap, gskey);
+
+    g_string_free(gskey, TRUE);
+    return entry ? flag : 0;
+}
+
 #endif
 
 %}
@@ -156,7 +166,6 @@ void yyerror(scancontext *scanner, const char *str)
 %type <list>        evaloptions
 %type <list>        evaloption
 %type <list>        sessionoption
-%type <list>        sessionoptions
 %type <list>        setcommand
 
 %type <gv>          evalcommand
@@ -238,6 +247,15 @@ commands:
                     extcmd->nResignation = g_value_get_int(str2gv_map_get_key_value(optionsmap, KEY_STR_RESIGNATION, gvfalse));
                     extcmd->fBeavers = g_value_get_int(str2gv_map_get_key_value(optionsmap, KEY_STR_BEAVERS, gvtrue));
 
+                    /* a board command only overrides what it names */
+                    extcmd->fEvalOptions = 0;
+                    if (extcmd->ct == COMMAND_FIBSBOARD)
+                        extcmd->fEvalOptions = evaloption_given(optionsmap, KEY_STR_PLIES, EXT_OPTION_PLIES)
+                            | evaloption_given(optionsmap, KEY_STR_CUBEFUL, EXT_OPTION_CUBEFUL)
+                            | evaloption_given(optionsmap, KEY_STR_NOISE, EXT_OPTION_NOISE)
+                            | evaloption_given(optionsmap, KEY_STR_PRUNE, EXT_OPTION_PRUNE)
+                            | evaloption_given(optionsmap, KEY_STR_DETERMINISTIC, EXT_OPTION_DETERMINISTIC);
+
                     g_value_unsetfree(gvtrue);
                     g_value_unsetfree(gvfalse);
                     g_value_unsetfree(gvfloatzero);
@@ -403,31 +421,6 @@ evaloption:
         }
     ;
 
-sessionoptions:
-    /* Empty */
-        { 
-            /* Setup the defaults */
-            STR2GV_MAPENTRY_CREATE(KEY_STR_JACOBYRULE, fJacoby, G_TYPE_INT, 
-                                    int, jacobyentry);
-            STR2GV_MAPENTRY_CREATE(KEY_STR_CRAWFORDRULE, TRUE, G_TYPE_INT, 
-                                    int, crawfordentry);
-            STR2GV_MAPENTRY_CREATE(KEY_STR_RESIGNATION, FALSE, G_TYPE_INT, 
-                                    int, resignentry);
-            STR2GV_MAPENTRY_CREATE(KEY_STR_BEAVERS, TRUE, G_TYPE_INT, 
-                                    int, beaversentry);
-
-            GList *defaults = 
-                g_list_prepend(g_list_prepend(g_list_prepend(g_list_prepend(NULL, jacobyentry), crawfordentry), \
-                               resignentry), beaversentry);
-            $$ = defaults;
-        }
-    |
-    sessionoptions sessionoption
-        { 
-            STR2GV_MAP_ADD_ENTRY($1, $2, $$); 
-        }
-    ;
-
 evaloptions:
     /* Empty */
         { 
@@ -459,7 +452,7 @@ evaloptions:
     ;
 
 boardcommand:
-    board sessionoptions
+    board evaloptions
         {
             GVALUE_CREATE(G_TYPE_BOXED_GLIST_GV, boxed, $1, gvptr1);
             GVALUE_CREATE(G_TYPE_BOXED_MAP_GV, boxed, $2, gvptr2);
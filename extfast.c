@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2022 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "external.h"
+
+/*
+ * A fast path for the board and "evaluation fibsboard" commands, which
+ * make up nearly all of the traffic.  They are parsed straight into the
+ * scan context without building the GValue trees of the grammar, and
+ * nothing but the player names is allocated.  Anything it is not sure
+ * of (quoted or numeric names, floats in the board, syntax errors) is
+ * left to the grammar, so that both accept the same commands with the
+ * same meaning; extcheck (make check) compares the two on random
+ * commands.
+ */
+
+#define EXT_MAX_BOARD_ELEMENTS (MAX_RFBF_ELEMENTS - 3)
+
+/* the next word, as far as the lexer's whitespace */
+extern const char *
+FastWord(const char **ppch, size_t * pcch)
+{
+    const char *pch = *ppch + strspn(*ppch, " \t\r\n");
+
+    *pcch = strcspn(pch, " \t\r\n");
+    *ppch = pch + *pcch;
+
+    return *pcch ? pch : NULL;
+}
+
+extern int
+FastWordIs(const char *pch, size_t cch, const char *sz)
+{
+    return cch == strlen(sz) && !g_ascii_strncasecmp(pch, sz, cch);
+}
+
+extern int
+FastInteger(const char *pch, size_t cch, int *pn)
+{
+    const char *pchEnd = pch + cch;
+    int fNegative = FALSE, n = 0;
+
+    if (cch && (*pch == '-' || *pch == '+'))
+        fNegative = *pch++ == '-';
+
+    /* leave anything that might overflow to atoi() */
+    if (pch == pchEnd || pchEnd - pch > 9)
+        return FALSE;
+
+    for (; pch < pchEnd; pch++) {
+        if (!g_ascii_isdigit(*pch))
+            return FALSE;
+        n = n * 10 + (*pch - '0');
+    }
+
+    *pn = fNegative ? -n : n;
+    return TRUE;
+}
+
+/* [-+]?[0-9]*\.[0-9]+([eE][-+]?[0-9]+)? */
+static int
+FastFloat(const char *pch, size_t cch, float *pr)
+{
+    const char *pchEnd = pch + cch, *pchDigits;
+    char sz[64];
+
+    if (cch >= sizeof(sz))
+        return FALSE;
+
+    if (pch < pchEnd && (*pch == '-' || *pch == '+'))
+        pch++;
+    while (pch < pchEnd && g_ascii_isdigit(*pch))
+        pch++;
+    if (pch == pchEnd || *pch++ != '.')
+        return FALSE;
+    for (pchDigits = pch; pch < pchEnd && g_ascii_isdigit(*pch); pch++);
+    if (pch == pchDigits)
+        return FALSE;
+    if (pch < pchEnd && (*pch == 'e' || *pch == 'E')) {
+        if (++pch < pchEnd && (*pch == '-' || *pch == '+'))
+            pch++;
+        for (pchDigits = pch; pch < pchEnd && g_ascii_isdigit(*pch); pch++);
+        if (pch == pchDigits)
+            return FALSE;
+    }
+    if (pch != pchEnd)
+        return FALSE;
+
+    memcpy(sz, pchEnd - cch, cch);
+    sz[cch] = 0;
+    *pr = (float) g_ascii_strtod(sz, NULL);
+    return TRUE;
+}
+
+static int
+FastBoolean(const char *pch, size_t cch, int *pf)
+{
+    if (FastWordIs(pch, cch, "yes") || FastWordIs(pch, cch, "on") || FastWordIs(pch, cch, "true"))
+        *pf = TRUE;
+    else if (FastWordIs(pch, cch, "no") || FastWordIs(pch, cch, "off") || FastWordIs(pch, cch, "false"))
+        *pf = FALSE;
+    else
+        return FALSE;
+
+    return TRUE;
+}
+
+/* an unquoted player name; all digits is an integer to the lexer */
+static int
+FastName(const char *pch, size_t cch)
+{
+    int fDigits = TRUE;
+    size_t i;
+
+    for (i = 0; i < cch; i++) {
+        if (!g_ascii_isalnum(pch[i]) && pch[i] != '_')
+            return FALSE;
+        fDigits = fDigits && g_ascii_isdigit(pch[i]);
+    }
+
+    return cch && !fDigits;
+}
+
+/* returns TRUE if the command was parsed into pec */
+extern int
+ExtFastParse(scancontext * pec, const char *szCommand)
+{
+    const char *pch = szCommand, *pchWord, *pchName, *pchOpp, *pchEnd;
+    size_t cch, cchName, cchOpp;
+    int an[EXT_MAX_BOARD_ELEMENTS], c = 0;
+    cmdtype ct = COMMAND_FIBSBOARD;
+    int nPlies = 0, fCubeful = FALSE, fUsePrune = FALSE, fDeterministic = TRUE;
+    unsigned int fEvalOptions = 0;
+    int fJacobyRule = fJacoby, fCrawfordRule = TRUE, nResignation = 0, fBeavers = TRUE;
+    float rNoise = 0.0f;
+
+    /* every keyword and the board must be followed by whitespace */
+    cch = strlen(szCommand);
+    if (!cch || !strchr(" \t\r\n", szCommand[cch - 1]))
+        return FALSE;
+
+    if (!(pchWord = FastWord(&pch, &cch)))
+        return FALSE;
+
+    if (FastWordIs(pchWord, cch, "evaluation")) {
+        ct = COMMAND_EVALUATION;
+        if (!(pchWord = FastWord(&pch, &cch)) || !FastWordIs(pchWord, cch, "fibsboard")
+            || !(pchWord = FastWord(&pch, &cch)))
+            return FALSE;
+    }
+
+    /* board:name:opp:n:...:n */
+    pchEnd = pchWord + cch;
+    if (cch < 6 || g_ascii_strncasecmp(pchWord, "board:", 6))
+        return FALSE;
+
+    pchName = pchWord + 6;
+    if (!(pchOpp = memchr(pchName, ':', (size_t) (pchEnd - pchName))))
+        return FALSE;
+    cchName = (size_t) (pchOpp++ - pchName);
+    if (!FastName(pchName, cchName) || !(pchWord = memchr(pchOpp, ':', (size_t) (pchEnd - pchOpp))))
+        return FALSE;
+    cchOpp = (size_t) (pchWord - pchOpp);
+    if (!FastName(pchOpp, cchOpp))
+        return FALSE;
+
+    while (pchWord < pchEnd) {
+        const char *pchNext;
+
+        pchWord++;
+        if (!(pchNext = memchr(pchWord, ':', (size_t) (pchEnd - pchWord))))
+            pchNext = pchEnd;
+        if (c == EXT_MAX_BOARD_ELEMENTS || !FastInteger(pchWord, (size_t) (pchNext - pchWord), an + c++))
+            return FALSE;
+        pchWord = pchNext;
+    }
+
+    /* the options; the last of each wins */
+    while ((pchWord = FastWord(&pch, &cch))) {
+        const char *pchSave = pch;
+        size_t cchValue;
+        const char *pchValue = FastWord(&pch, &cchValue);
+
+        if (FastWordIs(pchWord, cch, "jacobyrule")) {
+            if (!pchValue || !FastBoolean(pchValue, cchValue, &fJacobyRule))
+                return FALSE;
+        } else if (FastWordIs(pchWord, cch, "crawfordrule")) {
+            if (!pchValue || !FastBoolean(pchValue, cchValue, &fCrawfordRule))
+                return FALSE;
+        } else if (FastWordIs(pchWord, cch, "beavers")) {
+            if (!pchValue || !FastBoolean(pchValue, cchValue, &fBeavers))
+                return FALSE;
+        } else if (FastWordIs(pchWord, cch, "resignation")) {
+            if (!pchValue || !FastInteger(pchValue, cchValue, &nResignation))
+                return FALSE;
+        } else if (FastWordIs(pchWord, cch, "plies")) {
+            if (!pchValue || !FastInteger(pchValue, cchValue, &nPlies))
+                return FALSE;
+            fEvalOptions |= EXT_OPTION_PLIES;
+        } else if (FastWordIs(pchWord, cch, "noise")) {
+            int n;
+
+            if (pchValue && FastInteger(pchValue, cchValue, &n))
+                rNoise = (float) n / 10000.0f;
+            else if (!pchValue || !FastFloat(pchValue, cchValue, &rNoise))
+                return FALSE;
+            fEvalOptions |= EXT_OPTION_NOISE;
+        } else if (FastWordIs(pchWord, cch, "cube")) {
+            if (!pchValue || !FastBoolean(pchValue, cchValue, &fCubeful))
+                return FALSE;
+            fEvalOptions |= EXT_OPTION_CUBEFUL;
+        } else if (FastWordIs(pchWord, cch, "cubeful") || FastWordIs(pchWord, cch, "cubeless")) {
+            fCubeful = FastWordIs(pchWord, cch, "cubeful");
+            fEvalOptions |= EXT_OPTION_CUBEFUL;
+            pch = pchSave;
+        } else if (FastWordIs(pchWord, cch, "prune")) {
+            if (!pchValue || !FastBoolean(pchValue, cchValue, &fUsePrune)) {
+                fUsePrune = TRUE;
+                pch = pchSave;
+            }
+            fEvalOptions |= EXT_OPTION_PRUNE;
+        } else if (FastWordIs(pchWord, cch, "deterministic")) {
+            if (!pchValue || !FastBoolean(pchValue, cchValue, &fDeterministic)) {
+                fDeterministic = TRUE;
+                pch = pchSave;
+            }
+            fEvalOptions |= EXT_OPTION_DETERMINISTIC;
+        } else
+            return FALSE;
+    }
+
+    pec->ct = ct;
+    pec->pCmdData = NULL;
+    memcpy(pec->anList, an, c * sizeof(int));
+    pec->nPlies = nPlies;
+    pec->fCrawfordRule = fCrawfordRule;
+    pec->fJacobyRule = fJacobyRule;
+    pec->fUsePrune = fUsePrune;
+    pec->fCubeful = fCubeful;
+    pec->rNoise = rNoise;
+    pec->fDeterministic = fDeterministic;
+    pec->nResignation = nResignation;
+    pec->fBeavers = fBeavers;
+    pec->fEvalOptions = ct == COMMAND_FIBSBOARD ? fEvalOptions : 0;
+
+    if (pec->bi.gsName)
+        g_string_free(pec->bi.gsName, TRUE);
+    if (pec->bi.gsOpp)
+        g_string_free(pec->bi.gsOpp, TRUE);
+    pec->bi.gsName = g_string_new_len(pchName, (gssize) cchName);
+    pec->bi.gsOpp = g_string_new_len(pchOpp, (gssize) cchOpp);
+
+    return TRUE;
+}
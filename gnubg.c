@@ -525,11 +525,16 @@ player ap[2] = {
 char default_names[2][MAX_NAME_LEN] = { "gnubg", "user" };
 
 /* Usage strings */
-static char szDICE[] = N_("<die> <die>"),
+static char szADDRESS[] = N_("[host]:port"),
+    szALLOCATION[] = "uniform|lucb",
+    szADVICE[] = "normal|random|willneed",
+    szAFFINITY[] = "compact|scatter|none",
+    szDICE[] = N_("<die> <die>"),
     szCOMMAND[] = N_("<command>"),
     szCOMMENT[] = N_("<comment>"),
     szER[] = "evaluation|rollout",
     szFILENAME[] = N_("<filename>"),
+    szJOB[] = N_("submit|status|cancel|result|run [...]"),
     szKEYVALUE[] = N_("[<key>=<value> ...]"),
     szLENGTH[] = N_("<length>"),
     szLIMIT[] = N_("<limit>"),
@@ -541,16 +546,23 @@ static char szDICE[] = N_("<die> <die>"),
     szQUIET[] = "[quiet]",
     szLANG[] = N_("system|<language code>"),
     szONOFF[] = "on|off",
+    szOPTADDRESSES[] = N_("[host:port ...]"),
     szOPTCOMMAND[] = N_("[command]"),
     szOPTDATE[] = N_("[yyyy-mm-dd]"),
     szOPTDEPTH[] = N_("[depth]"),
     szOPTFILENAME[] = N_("[filename]"),
+    szOPTFILENAMESECONDS[] = N_("[filename [seconds]]"),
     szOPTLENGTH[] = N_("[length]"),
+    szOPTLOOKUPSTHREADS[] = N_("[lookups [maximum threads]]"),
     szOPTMODULUSOPTSEED[] = N_("[modulus <modulus>|factors <factor> <factor>] "
                                "[seed]"),
     szOPTNAME[] = N_("[name]"),
     szOPTPOSITION[] = N_("[position]"),
     szOPTSEED[] = N_("[seed]"),
+    szOPTTASKSTHREADS[] = N_("[tasks [maximum threads]]"),
+    szOPTTRIALSCANDIDATES[] = N_("[trials [candidates]]"),
+    szOPTTRIALSNTHREADS[] = N_("[trials [threads]]"),
+    szOPTTRIALSTHREADS[] = N_("[trials [maximum threads]]"),
     szOPTVALUE[] = N_("[value]"),
     szPLAYER[] = N_("<player>"),
     szPLAYEROPTRATING[] = N_("<player> [rating]"),
@@ -2632,7 +2644,7 @@ CommandRollout(char *sz)
     void *p;
 
     if (CountTokens(sz) > 0) {
-        outputerrf("%s", _("The rollout command takes no arguments and only rollouts the current position"));
+        HandleCommand(sz, acRollout);
         return;
     }
     if (ms.gs != GAME_PLAYING) {
@@ -3293,9 +3305,13 @@ SaveEvaluationSettings(FILE * pf)
     SaveEvalSetupSettings(pf, "set evaluation cubedecision", &esEvalCube);
     SaveMoveFilterSettings(pf, "set evaluation movefilter", aamfEval);
     fprintf(pf, "set cache %u\n", GetEvalCacheEntries());
+    fprintf(pf, "set bearoff advice %s\n", aszBearoffAdvice[baBearoff]);
+    fprintf(pf, "set bearoff warmup %s\n", fBearoffWarmup ? "on" : "off");
     fprintf(pf, "set matchequitytable \"%s\"\n", miCurrent.szFileName);
     fprintf(pf, "set invert matchequitytable %s\n", fInvertMET ? "on" : "off");
 #if defined(USE_MULTITHREAD)
+    fprintf(pf, "set threads affinity %s\n", aszThreadAffinity[taThreads]);
+    fprintf(pf, "set threads smt %s\n", fThreadsSMT ? "on" : "off");
     fprintf(pf, "set threads %u\n", MT_GetNumThreads());
 #endif
 }
@@ -3349,6 +3365,9 @@ SaveMiscSettings(FILE * pf)
     fprintf(pf, "set prompt %s\n", szPrompt);
     fprintf(pf, "set browser \"%s\"\n", get_web_browser());
     fprintf(pf, "set priority nice %d\n", nThreadPriority);
+    fprintf(pf, "set external cache %u\n", cExternalCacheSize);
+    fprintf(pf, "set external connections %u\n", cExternalMaxConnections);
+    fprintf(pf, "set external queue %u\n", cExternalQueueLimit);
     fprintf(pf, "set ratingoffset %s\n", g_ascii_formatd(buf, G_ASCII_DTOSTR_BUF_SIZE, "%f", rRatingOffset));
 
     fprintf(pf, "set usekeynames %s\n", fUseKeyNames ? "on" : "off");
@@ -3430,6 +3449,14 @@ CommandSaveSettings(char *szParam)
     SavePlayerSettings(pf);
     SaveRNGSettings(pf, "set", rngCurrent, rngctxCurrent);
     SaveRolloutSettings(pf, "set rollout", &rcRollout);
+    fprintf(pf, "set rollout mergeinterval %u\n", nRolloutMergeInterval);
+    fprintf(pf, "set rollout allocation %s\n", fRolloutLUCB ? "lucb" : "uniform");
+    if (szRolloutWorkers)
+        fprintf(pf, "set rollout workers %s\n", szRolloutWorkers);
+    if (szRolloutCheckpoint)
+        fprintf(pf, "set rollout checkpoint \"%s\" %u\n", szRolloutCheckpoint, nRolloutCheckpointInterval);
+    if (szRolloutResultDir)
+        fprintf(pf, "set rollout resultdir \"%s\"\n", szRolloutResultDir);
     SaveImportExportSettings(pf);
     SaveSoundSettings(pf);
     RelationalSaveSettings(pf);
@@ -4592,6 +4619,18 @@ callback_parse_python_option(const gchar *UNUSED(name), const gchar *value, gpoi
     return TRUE;
 }
 
+static void
+PrintStartupProfile(double rMET, double rThreads, double rRC, double rTotal)
+{
+    g_print("%s\n", _("Startup profile (seconds):"));
+    g_print("  %-28s %8.3f\n", _("Match equity table"), rMET);
+    g_print("  %-28s %8.3f\n", _("Bearoff databases"), rEvalBearoffTime);
+    g_print("  %-28s %8.3f\n", _("Neural net weights"), rEvalWeightsTime);
+    g_print("  %-28s %8.3f\n", _("Thread data"), rThreads);
+    g_print("  %-28s %8.3f\n", _("User settings"), rRC);
+    g_print("  %-28s %8.3f\n", _("Total"), rTotal);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -4605,6 +4644,11 @@ main(int argc, char *argv[])
 
     static char *pchCommands = NULL, *lang = NULL;
     static int fNoBearoff = FALSE, fNoX = FALSE, fSplash = FALSE, fNoTTY = FALSE, show_version = FALSE, debug = FALSE;
+    static int fStartupProfile = FALSE;
+    static char *szServe = NULL;
+    static int nServeWorkers = 0;
+    GTimer *ptStartup, *pt;
+    double rMET, rThreads, rRC = 0.0;
     GOptionEntry ao[] = {
         {"no-bearoff", 'b', 0, G_OPTION_ARG_NONE, &fNoBearoff,
          N_("Do not use bearoff database"), NULL},
@@ -4637,6 +4681,12 @@ main(int argc, char *argv[])
          N_("Specify location of program documentation"), NULL},
         {"prefsdir", 's', 0, G_OPTION_ARG_STRING, &prefsdir,
          N_("Specify location of user's preferences directory"), NULL},
+        {"print-startup-profile", 0, 0, G_OPTION_ARG_NONE, &fStartupProfile,
+         N_("Print the time spent in each step of start-up"), NULL},
+        {"serve", 0, 0, G_OPTION_ARG_STRING, &szServe,
+         N_("Serve external controllers on ADDRESS with a pool of worker processes"), "ADDRESS"},
+        {"serve-workers", 0, 0, G_OPTION_ARG_INT, &nServeWorkers,
+         N_("Number of worker processes for --serve (default: enough for the processors; rollout jobs need 1)"), "N"},
         {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
     };
     GError *error = NULL;
@@ -4691,6 +4741,14 @@ main(int argc, char *argv[])
     if (!debug)
         g_log_set_handler(NULL, G_LOG_LEVEL_DEBUG, &null_debug, NULL);
 
+    if (szServe) {
+        if (nServeWorkers < 0) {
+            outputerrf(_("The number of worker processes must not be negative.\n"));
+            exit(EXIT_FAILURE);
+        }
+        fNoX = TRUE;
+    }
+
     if (prefsdir) {
         szHomeDirectory = prefsdir;
     }
@@ -4746,17 +4804,23 @@ main(int argc, char *argv[])
     PushSplash(pwSplash, _("Initialising"), _("Random number generator"));
     init_rng();
 
+    ptStartup = g_timer_new();
+    pt = g_timer_new();
+
     PushSplash(pwSplash, _("Initialising"), _("match equity table"));
     met = BuildFilename2("met", "Kazaross-XG2.xml");
     InitMatchEquity(met);
     g_free(met);
+    rMET = g_timer_elapsed(pt, NULL);
 
     PushSplash(pwSplash, _("Initialising"), _("neural nets"));
     init_nets(fNoBearoff);
 
+    g_timer_start(pt);
     PushSplash(pwSplash, _("Initialising"), _("initialising thread data"));
     glib_ext_init();
     MT_InitThreads();
+    rThreads = g_timer_elapsed(pt, NULL);
 
 #if defined(WIN32) && defined(HAVE_SOCKETS)
     PushSplash(pwSplash, _("Initialising"), _("Windows sockets"));
@@ -4773,15 +4837,32 @@ main(int argc, char *argv[])
     /* -r option given */
     if (!fNoRC) {
         PushSplash(pwSplash, _("Loading"), _("User Settings"));
+        g_timer_start(pt);
         LoadRCFiles();
+        rRC = g_timer_elapsed(pt, NULL);
     }
 
+    if (fStartupProfile)
+        PrintStartupProfile(rMET, rThreads, rRC, g_timer_elapsed(ptStartup, NULL));
+    g_timer_destroy(pt);
+    g_timer_destroy(ptStartup);
+
     strcpy(ap[0].szName, default_names[0]);
     strcpy(ap[1].szName, default_names[1]);
 
     fflush(stdout);
     fflush(stderr);
 
+    /* --serve given: the workers start their own threads once forked */
+    if (szServe) {
+        int n;
+
+        fInteractive = FALSE;
+        n = ExternalServe(szServe, (unsigned int) nServeWorkers);
+        Shutdown();
+        exit(n < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
 #if defined(USE_MULTITHREAD)
     /* Make sure threads started */
     MT_StartThreads();
@@ -5566,18 +5647,21 @@ RunAsyncProcess(AsyncFun fun, void *data, const char *msg)
 {
     int ret;
 #if defined(USE_MULTITHREAD)
+    /* the user is waiting: go ahead of any analysis or rollout */
+    mtgroup *pg = MT_GroupNew(MT_PRIORITY_INTERACTIVE);
     Task *pt = (Task *) g_malloc(sizeof(Task));
 
     pt->pLinkedTask = NULL;
     pt->fun = fun;
     pt->data = data;
-    MT_AddTask(pt, TRUE);
+    MT_GroupAddTask(pg, pt);
 #endif
 
     ProgressStart(msg);
 
 #if defined(USE_MULTITHREAD)
-    ret = MT_WaitForTasks(Progress, 100, FALSE);
+    ret = MT_GroupWait(pg, Progress, 100, FALSE);
+    MT_GroupFree(pg);
 #else
     asyncRet = 0;
     fun(data);                  /* Just call function in single threaded build */
@@ -34,6 +34,7 @@
 #include "matchequity.h"
 #include "positionid.h"
 #include "matchid.h"
+#include "rolloutqueue.h"
 #include "util.h"
 #include "lib/gnubg-types.h"
 #include "lib/simd.h"
@@ -1014,6 +1015,27 @@ PythonShow(PyObject * UNUSED(self), PyObject * args)
     return p;
 }
 
+static PyObject *
+PythonRolloutJob(PyObject * UNUSED(self), PyObject * args)
+{
+    PyObject *p;
+    char *pch;
+    char *sz;
+    char *szResponse;
+
+    if (!PyArg_ParseTuple(args, "s:rolloutjob", &pch))
+        return NULL;
+
+    sz = g_strdup(pch);
+    szResponse = RolloutQueueCommand("python", sz);
+    g_free(sz);
+
+    p = PyUnicode_FromString(szResponse);
+    g_free(szResponse);
+
+    return p;
+}
+
 static PyObject *
 PythonSetGNUbgID(PyObject * UNUSED(self), PyObject * args)
 {
@@ -3178,6 +3200,11 @@ static PyMethodDef gnubgMethods[] = {
     {"show", PythonShow, METH_VARARGS,
      "Execute the 'show arguments' command\n" "    arguments: string containing arguments\n" "    returns: result, with final newline(s) stripped, as string"}
     ,
+    {"rolloutjob", PythonRolloutJob, METH_VARARGS,
+     "Submit, query, cancel or collect queued rollouts (see 'help rollout job')\n"
+     "    arguments: string containing 'submit', 'status', 'cancel' or 'result' and their arguments\n"
+     "    returns: the response of the job queue as string"}
+    ,
     {"setgnubgid", PythonSetGNUbgID, METH_VARARGS,
      "Set current board and matchid\n" "    arguments: string containing a GNUbgID or XGID\n" "    returns: None"}
     ,
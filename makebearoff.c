@@ -182,7 +182,7 @@ OSLookup(const unsigned int iPos,
 
         /* find offsets and no. of non-zero elements */
 
-        if (fseek(pfOutput, 40 + iPos * index_entry_size, SEEK_SET) < 0) {
+        if (fseek(pfOutput, 40 + (long) iPos * index_entry_size, SEEK_SET) < 0) {
             perror("output file");
             exit(-1);
         }
@@ -258,7 +258,7 @@ OSLookup(const unsigned int iPos,
 
         /* look up position by seeking */
 
-        if (fseek(pfOutput, 40 + iPos * (fGammon ? 128 : 64), SEEK_SET) < 0) {
+        if (fseek(pfOutput, 40 + (long) iPos * (fGammon ? 128 : 64), SEEK_SET) < 0) {
             g_printerr(_("Error seeking in pfOutput\n"));
             exit(-1);
         }
@@ -542,6 +542,11 @@ WriteIndex(unsigned int *pnpos, const unsigned short int aus[64], const int fGam
     putc(nNonZero & 0xFF, output);
     putc(iIdx & 0xFF, output);
 
+    if (*pnpos > G_MAXUINT - 64) {
+        g_printerr(_("The compressed database is too large for its 32 bit offsets\n"));
+        exit(3);
+    }
+
     *pnpos += nNonZero;
 
     /* gammon probs: write index and number of non-zero elements */
@@ -689,6 +694,205 @@ generate_os(const int nOS, const int fHeader,
 }
 
 
+/*
+ * Out-of-core generation of one-sided databases.
+ *
+ * Every move lowers the pip count by 1 to 24, so the positions with a
+ * given pip count only depend on the 24 pip counts below. The positions
+ * are generated a pip count (level) at a time, so the xhash only has to
+ * hold about 24 levels to serve nearly every lookup. Each finished
+ * level is written to a raw temporary file indexed by position, which
+ * also serves the lookups the xhash misses. Finally the raw file is read
+ * in position order and written out like generate_os does.
+ */
+
+static void
+CollectLevel(unsigned int anBoard[25], const int iPoint, const unsigned int nChequers,
+             const unsigned int nPips, const unsigned int nPoints, GArray * pa)
+{
+    unsigned int c, cMax;
+
+    if (iPoint < 0) {
+        if (!nPips) {
+            unsigned int nId = PositionBearoff(anBoard, nPoints, 15);
+            g_array_append_val(pa, nId);
+        }
+        return;
+    }
+
+    if (nPips > nChequers * (unsigned int) (iPoint + 1))
+        return;
+
+    cMax = MIN(nChequers, nPips / (unsigned int) (iPoint + 1));
+    for (c = 0; c <= cMax; ++c) {
+        anBoard[iPoint] = c;
+        CollectLevel(anBoard, iPoint - 1, nChequers - c, nPips - c * (unsigned int) (iPoint + 1), nPoints, pa);
+    }
+    anBoard[iPoint] = 0;
+}
+
+static gint
+CompareId(gconstpointer a, gconstpointer b)
+{
+    unsigned int i = *(const unsigned int *) a, j = *(const unsigned int *) b;
+
+    return (i > j) - (i < j);
+}
+
+static int
+generate_os_levels(const int nOS, const int fHeader,
+                   const int fCompress, const int fGammon, const int nHashSize, bearoffcontext * pbc, FILE * output)
+{
+    unsigned int n = Combination(nOS + 15, nOS);
+    unsigned int nRecord = fGammon ? 128 : 64;
+    unsigned int anBoard[25];
+    unsigned int i, nPips, nDone = 0, npos = 0;
+    unsigned short int aus[64];
+    unsigned char ac[128];
+    GArray *pa = g_array_new(FALSE, FALSE, sizeof(unsigned int));
+    GTimer *pt = g_timer_new();
+    xhash h;
+    FILE *pfRaw, *pfTmp = NULL;
+    char *szRaw, *tmpfile = NULL;
+    int fTTY = isatty(STDERR_FILENO);
+    double rElapsed;
+
+    if (XhashCreate(&h, nHashSize / (int) nRecord)) {
+        g_printerr(_("Error creating xhash with %d elements\n"), nHashSize / (int) nRecord);
+        exit(2);
+    }
+
+    XhashStatus(&h);
+
+    /* the raw file has room for a header, so OSLookup can read it as
+     * an uncompressed database */
+
+    if (!(pfRaw = GetTemporaryFile(NULL, &szRaw))) {
+        g_printerr(_("Error creating temporary file\n"));
+        exit(2);
+    }
+
+    memset(anBoard, 0, sizeof(anBoard));
+
+    for (nPips = 0; nPips <= 15 * (unsigned int) nOS; ++nPips) {
+        double rLevel = g_timer_elapsed(pt, NULL);
+
+        g_array_set_size(pa, 0);
+        CollectLevel(anBoard, nOS - 1, 15, nPips, (unsigned int) nOS, pa);
+        g_array_sort(pa, CompareId);
+
+        for (i = 0; i < pa->len; ++i) {
+            unsigned int nId = g_array_index(pa, unsigned int, i);
+            unsigned int j;
+
+            BearOff((int) nId, (unsigned int) nOS, aus, fGammon, &h, pbc, FALSE, pfRaw, NULL);
+            XhashAdd(&h, nId, aus, (int) nRecord);
+
+            for (j = 0; j < nRecord / 2; ++j) {
+                ac[2 * j] = aus[j] & 0xFF;
+                ac[2 * j + 1] = (unsigned char) (aus[j] >> 8);
+            }
+
+            if (fseek(pfRaw, 40 + (long) nId * nRecord, SEEK_SET) < 0 || fwrite(ac, 1, nRecord, pfRaw) != nRecord) {
+                perror("temporary file");
+                exit(3);
+            }
+        }
+
+        nDone += pa->len;
+
+        if (fTTY && pa->len) {
+            double r = g_timer_elapsed(pt, NULL) - rLevel;
+
+            g_printerr(_("pips %3u: %9u positions, %10.0f positions/s, %u/%u done     \r"), nPips, pa->len,
+                       r > 0.0 ? pa->len / r : 0.0, nDone, n);
+        }
+    }
+
+    g_assert(nDone == n);
+
+    rElapsed = g_timer_elapsed(pt, NULL);
+    putc('\n', stderr);
+    g_printerr(_("Generated %u positions in %.0f seconds (%.0f positions/s)\n"), n, rElapsed,
+               rElapsed > 0.0 ? n / rElapsed : 0.0);
+    XhashStatus(&h);
+    XhashDestroy(&h);
+
+    /* write the database in position order */
+
+    if (fHeader) {
+        char sz[41];
+        sprintf(sz, "gnubg-OS-%02d-15-%1d-%1d-0xxxxxxxxxxxxxxxxxxx\n", nOS, fGammon, fCompress);
+        fputs(sz, output);
+    }
+
+    if (fCompress) {
+        pfTmp = GetTemporaryFile(NULL, &tmpfile);
+        if (pfTmp == NULL) {
+            g_printerr(_("Error creating temporary file\n"));
+            exit(2);
+        }
+    }
+
+    if (fseek(pfRaw, 40L, SEEK_SET) < 0) {
+        perror("temporary file");
+        exit(3);
+    }
+
+    for (i = 0; i < n; ++i) {
+        unsigned int j;
+
+        if (fread(ac, 1, nRecord, pfRaw) != nRecord) {
+            g_printerr(_("Error reading temporary file\n"));
+            exit(3);
+        }
+
+        memset(aus, 0, sizeof(aus));
+        for (j = 0; j < nRecord / 2; ++j)
+            aus[j] = (unsigned short int) (ac[2 * j] | ac[2 * j + 1] << 8);
+
+        WriteOS(aus, fCompress, fCompress ? pfTmp : output);
+        if (fGammon)
+            WriteOS(aus + 32, fCompress, fCompress ? pfTmp : output);
+
+        if (fCompress)
+            WriteIndex(&npos, aus, fGammon, output);
+    }
+
+    fclose(pfRaw);
+    g_unlink(szRaw);
+    g_free(szRaw);
+
+    if (fCompress) {
+        size_t u;
+
+        /* write contents of pfTmp to output */
+
+        rewind(pfTmp);
+
+        while (!feof(pfTmp) && (u = fread(ac, 1, sizeof(ac), pfTmp))) {
+            if (fwrite(ac, 1, u, output) != u) {
+                g_printerr(_("Error writing to '%s'\n"), tmpfile);
+                exit(3);
+            }
+        }
+
+        if (ferror(pfTmp))
+            exit(3);
+
+        fclose(pfTmp);
+
+        g_unlink(tmpfile);
+        g_free(tmpfile);
+    }
+
+    g_array_free(pa, TRUE);
+    g_timer_destroy(pt);
+
+    return 0;
+}
+
+
 static void
 NDBearoff(const int iPos, const unsigned int nPoints, float ar[4], xhash * ph, bearoffcontext * pbc)
 {
@@ -928,43 +1132,64 @@ CalcPosition(const int i, const int j, const int n)
 
 
 
+/*
+ * Read from the temporary file of a two-sided database while other
+ * threads may be doing the same. Positional reads leave the file offset
+ * alone; without them the reads are serialised.
+ */
+
 static void
-TSLookup(const int nUs, const int nThem,
-         const int UNUSED(nTSP), const int UNUSED(nTSC),
-         short int arEquity[4], const int n, const int fCubeful, FILE * pfTmp)
+ReadTemporary(FILE * pfTmp, long iOffset, unsigned char *ac, size_t nBytes)
 {
+#ifndef WIN32
+    size_t n = 0;
 
-    int iPos = CalcPosition(nUs, nThem, n);
-    unsigned char ac[8];
-    int i;
-
-    /* seek to position */
+    errno = 0;
+    while (n < nBytes) {
+        ssize_t r = pread(fileno(pfTmp), ac + n, nBytes - n, (off_t) iOffset + (off_t) n);
 
-    if (fseek(pfTmp, iPos * (fCubeful ? 8 : 2), SEEK_SET) < 0) {
-        perror("temporary file");
-        exit(-1);
+        if (r > 0)
+            n += (size_t) r;
+        else if (r < 0 && errno == EINTR)
+            continue;
+        else
+            break;
     }
 
-    if (fread(ac, 1, 8, pfTmp) < 8) {
+    if (n < nBytes) {
+#else
+    int fOK;
+
+    MT_Exclusive();
+    fOK = fseek(pfTmp, iOffset, SEEK_SET) == 0 && fread(ac, 1, nBytes, pfTmp) == nBytes
+        && fseek(pfTmp, 0L, SEEK_END) == 0;
+    MT_Release();
+
+    if (!fOK) {
+#endif
         if (errno)
             perror("temporary file");
         else
             g_printerr(_("Error reading temporary file\n"));
         exit(-1);
     }
+}
 
-    /* re-position at EOF */
+static void
+TSLookup(const int nUs, const int nThem,
+         const int UNUSED(nTSP), const int UNUSED(nTSC),
+         short int arEquity[4], const int n, const int fCubeful, FILE * pfTmp)
+{
 
-    if (fseek(pfTmp, 0L, SEEK_END) < 0) {
-        perror("temporary file");
-        exit(-1);
-    }
+    int iPos = CalcPosition(nUs, nThem, n);
+    unsigned char ac[8];
+    int i;
+
+    ReadTemporary(pfTmp, (long) iPos * (fCubeful ? 8 : 2), ac, fCubeful ? 8 : 2);
 
     for (i = 0; i < (fCubeful ? 4 : 1); ++i)
         arEquity[i] = (unsigned short) ((ac[2 * i] | ac[2 * i + 1] << 8) - 0x8000);
 
-    ++cLookup;
-
 }
 
 
@@ -1147,15 +1372,177 @@ WriteEquity(FILE * pf, const short int si)
 
 }
 
+/*
+ * Two-sided generation in levels.
+ *
+ * Position (nUs, nThem) only depends on positions (nThem, j) with
+ * j < nUs, so all positions with the same nUs + nThem form a level that
+ * depends only on earlier levels. The positions of a level are shared
+ * out among the threads, each with its own xhash, and the main thread
+ * appends the level to the temporary file in the same order as a
+ * single thread would.
+ */
+
+typedef struct {
+    int nTSP, nTSC, n, fCubeful;
+    bearoffcontext *pbc;
+    FILE *pfTmp;
+    int iLevel;                 /* nUs + nThem for this level */
+    int jFirst;                 /* nThem of the first position in the level */
+    int cPositions;             /* number of positions in the level */
+    int iNext;                  /* next position to claim */
+    short int *asiLevel;        /* equities for the level, 4 per position */
+#if defined(USE_MULTITHREAD)
+    unsigned int nThreads;
+    int nDone;
+    int fQuit;
+    ManualEvent aevStart[2];    /* alternate between levels */
+    ManualEvent evDone;
+#endif
+} tsgenerator;
+
+typedef struct {
+    tsgenerator *ptg;
+    int id;
+    xhash h;
+    GThread *pt;
+} tsworker;
+
+static void
+TSGenerateLevel(tsgenerator * ptg, xhash * ph)
+{
+    int i, j;
+
+    while ((i = MT_SafeIncValue(&ptg->iNext) - 1) < ptg->cPositions) {
+        short int *asi = ptg->asiLevel + 4 * i;
+
+        j = ptg->jFirst + i;
+        BearOff2(ptg->iLevel - j, j, ptg->nTSP, ptg->nTSC, asi, ptg->n, ptg->fCubeful, ph, ptg->pbc, ptg->pfTmp);
+        XhashAdd(ph, (ptg->iLevel - j) * ptg->n + j, asi, ptg->fCubeful ? 8 : 2);
+    }
+}
+
+#if defined(USE_MULTITHREAD)
+static gpointer
+TSWorkerThread(gpointer p)
+{
+    tsworker *ptw = (tsworker *) p;
+    tsgenerator *ptg = ptw->ptg;
+    ThreadLocalData *pTLD = MT_CreateThreadLocalData(ptw->id);
+    unsigned int iLevel;
+    int i;
+
+    TLSSetValue(td.tlsItem, (size_t) pTLD);
+
+    for (iLevel = 0;; ++iLevel) {
+        WaitForManualEvent(ptg->aevStart[iLevel & 1]);
+        if (ptg->fQuit)
+            break;
+
+        TSGenerateLevel(ptg, &ptw->h);
+
+        if (MT_SafeIncValue(&ptg->nDone) == (int) ptg->nThreads)
+            SetManualEvent(ptg->evDone);
+    }
+
+    g_free(pTLD->aMoves);
+    for (i = 0; i < 3; i++) {
+        g_free(pTLD->pnnState[i].savedBase);
+        g_free(pTLD->pnnState[i].savedIBase);
+    }
+    g_free(pTLD->pnnState);
+    g_free(pTLD);
+
+    return NULL;
+}
+#endif
+
+static void
+WriteLittleEndian64(guint64 u, FILE * pf)
+{
+    int i;
+
+    for (i = 0; i < 8; ++i, u >>= 8)
+        putc((int) (u & 0xFF), pf);
+}
+
+/*
+ * Write the sorted equities of a two-sided database in compressed
+ * blocks of nBlockSize positions, followed by the block index in the
+ * space reserved for it after the header.
+ */
+
+static void
+WriteBlocked(FILE * pfTmp, const int n, const int fCubeful, const unsigned int nBlockSize, FILE * output)
+{
+    unsigned int k = fCubeful ? 4 : 1;
+    guint64 nTotal = (guint64) n * n;
+    unsigned int nBlocks = (unsigned int) ((nTotal + nBlockSize - 1) / nBlockSize);
+    guint64 *aiOffset = g_new(guint64, nBlocks + 1);
+    unsigned short int *aus = g_new(unsigned short int, nBlockSize * k);
+    unsigned char *puch = g_malloc(BEAROFF_BLOCK_BYTES(nBlockSize * k));
+    unsigned int iBlock = 0, nPositions = 0;
+    unsigned char ac[8];
+    int i, j;
+    size_t cb;
+    long iIndex = ftell(output);
+
+    /* reserve space for the index */
+
+    for (i = 0; i <= (int) nBlocks; ++i)
+        WriteLittleEndian64(0, output);
+
+    aiOffset[0] = 0;
+
+    for (i = 0; i < n; ++i)
+        for (j = 0; j < n; ++j) {
+            unsigned int u;
+
+            ReadTemporary(pfTmp, (long) CalcPosition(i, j, n) * k * 2, ac, k * 2);
+            for (u = 0; u < k; ++u)
+                aus[nPositions * k + u] = (unsigned short int) (ac[2 * u] | ac[2 * u + 1] << 8);
+
+            if (++nPositions == nBlockSize || (i == n - 1 && j == n - 1)) {
+                cb = BearoffEncodeBlock(aus, nPositions, k, puch);
+                if (fwrite(puch, 1, cb, output) != cb) {
+                    g_printerr(_("failed to read from or write to database file\n"));
+                    exit(3);
+                }
+                aiOffset[iBlock + 1] = aiOffset[iBlock] + cb;
+                ++iBlock;
+                nPositions = 0;
+            }
+        }
+
+    g_assert(iBlock == nBlocks);
+
+    if (fseek(output, iIndex, SEEK_SET) < 0) {
+        perror("output file");
+        exit(3);
+    }
+    for (iBlock = 0; iBlock <= nBlocks; ++iBlock)
+        WriteLittleEndian64(aiOffset[iBlock], output);
+
+    g_printerr("%-37s: %.0f (%.1f MB)\n", _("Size of compressed blocks"), (double) aiOffset[nBlocks],
+               (double) aiOffset[nBlocks] / 1048576.0);
+
+    g_free(puch);
+    g_free(aus);
+    g_free(aiOffset);
+}
+
 static void
 generate_ts(const int nTSP, const int nTSC,
-            const int fHeader, const int fCubeful, const int nHashSize, bearoffcontext * pbc, FILE * output)
+            const int fHeader, const int fCubeful, const int nHashSize, const unsigned int nThreads,
+            const unsigned int nBlockSize, bearoffcontext * pbc, FILE * output)
 {
 
     int i, j, k;
     int iPos;
     int n;
-    short int asiEquity[4];
+    unsigned int iThread;
+    tsgenerator tg;
+    tsworker *atw;
     xhash h;
     FILE *pfTmp;
     unsigned char ac[8];
@@ -1168,18 +1555,29 @@ generate_ts(const int nTSP, const int nTSC,
         exit(2);
     }
 
-    /* initialise xhash */
+    /* initialise an xhash per thread */
 
-    if (XhashCreate(&h, nHashSize / (fCubeful ? 8 : 2))) {
-        g_printerr(_("Error creating xhash with %d elements\n"), nHashSize / (fCubeful ? 8 : 2));
-        exit(2);
+    atw = g_new0(tsworker, nThreads);
+    for (iThread = 0; iThread < nThreads; ++iThread) {
+        int nElements = nHashSize / (fCubeful ? 8 : 2) / (int) nThreads;
+
+        if (XhashCreate(&atw[iThread].h, nElements)) {
+            g_printerr(_("Error creating xhash with %d elements\n"), nElements);
+            exit(2);
+        }
+        atw[iThread].ptg = &tg;
+        atw[iThread].id = (int) iThread;
     }
 
-    XhashStatus(&h);
+    XhashStatus(&atw[0].h);
 
     /* write header information */
 
-    if (fHeader) {
+    if (nBlockSize) {
+        char sz[41];
+        sprintf(sz, "gnubg-TB-%02d-%02d-%1d-%04u-1xxxxxxxxxxxxxxxx\n", nTSP, nTSC, fCubeful, nBlockSize);
+        fputs(sz, output);
+    } else if (fHeader) {
         char sz[41];
         sprintf(sz, "gnubg-TS-%02d-%02d-%1dxxxxxxxxxxxxxxxxxxxxxxx\n", nTSP, nTSC, fCubeful);
         fputs(sz, output);
@@ -1191,45 +1589,103 @@ generate_ts(const int nTSP, const int nTSC,
     n = Combination(nTSP + nTSC, nTSC);
     iPos = 0;
 
+    tg.nTSP = nTSP;
+    tg.nTSC = nTSC;
+    tg.n = n;
+    tg.fCubeful = fCubeful;
+    tg.pbc = pbc;
+    tg.pfTmp = pfTmp;
+    tg.asiLevel = g_new(short int, 4 * n);
+
+#if defined(USE_MULTITHREAD)
+    tg.nThreads = nThreads;
+    tg.fQuit = FALSE;
+    InitManualEvent(&tg.aevStart[0]);
+    InitManualEvent(&tg.aevStart[1]);
+    InitManualEvent(&tg.evDone);
+
+    if (nThreads > 1)
+        for (iThread = 0; iThread < nThreads; ++iThread)
+#if GLIB_CHECK_VERSION (2,32,0)
+            if (!(atw[iThread].pt = g_thread_try_new(NULL, TSWorkerThread, &atw[iThread], NULL)))
+#else
+            if (!(atw[iThread].pt = g_thread_create(TSWorkerThread, &atw[iThread], TRUE, NULL)))
+#endif
+            {
+                g_printerr(_("Failed to create thread\n"));
+                exit(2);
+            }
+#endif
 
-    /* positions above diagonal */
-
-    for (i = 0; i < n; i++) {
-        for (j = 0; j <= i; j++, ++iPos) {
-
-            BearOff2(i - j, j, nTSP, nTSC, asiEquity, n, fCubeful, &h, pbc, pfTmp);
+    /* Level i holds the positions with nUs + nThem = i, ordered by nThem,
+     * which is also their order in the temporary file */
+
+    for (i = 0; i < 2 * n - 1; ++i) {
+
+        tg.iLevel = i;
+        tg.jFirst = (i < n) ? 0 : i - n + 1;
+        tg.cPositions = ((i < n) ? i : n - 1) - tg.jFirst + 1;
+        tg.iNext = 0;
+
+#if defined(USE_MULTITHREAD)
+        if (nThreads > 1) {
+            tg.nDone = 0;
+            ResetManualEvent(tg.evDone);
+            /* every worker is past the start event of the previous level */
+            ResetManualEvent(tg.aevStart[(i + 1) & 1]);
+            SetManualEvent(tg.aevStart[i & 1]);
+            WaitForManualEvent(tg.evDone);
+        } else
+#endif
+            TSGenerateLevel(&tg, &atw[0].h);
 
+        for (j = 0; j < tg.cPositions; ++j, ++iPos)
             for (k = 0; k < (fCubeful ? 4 : 1); ++k)
-                WriteEquity(pfTmp, asiEquity[k]);
-
-            XhashAdd(&h, (i - j) * n + j, asiEquity, fCubeful ? 8 : 2);
+                WriteEquity(pfTmp, tg.asiLevel[4 * j + k]);
 
+        /* make the level visible to the readers of the next one */
+        if (fflush(pfTmp)) {
+            perror("temporary file");
+            exit(3);
         }
+
         if (fTTY)
             g_printerr("%d/%d     \r", iPos, n * n);
     }
 
-    /* positions below diagonal */
-
-    for (i = 0; i < n; i++) {
-        for (j = i + 1; j < n; j++, ++iPos) {
+#if defined(USE_MULTITHREAD)
+    if (nThreads > 1) {
+        tg.fQuit = TRUE;
+        SetManualEvent(tg.aevStart[i & 1]);
+        for (iThread = 0; iThread < nThreads; ++iThread)
+            g_thread_join(atw[iThread].pt);
+    }
 
-            BearOff2(i + n - j, j, nTSP, nTSC, asiEquity, n, fCubeful, &h, pbc, pfTmp);
+    FreeManualEvent(tg.aevStart[0]);
+    FreeManualEvent(tg.aevStart[1]);
+    FreeManualEvent(tg.evDone);
+#endif
 
-            for (k = 0; k < (fCubeful ? 4 : 1); ++k)
-                WriteEquity(pfTmp, asiEquity[k]);
+    putc('\n', stderr);
 
-            XhashAdd(&h, (i + n - j) * n + j, asiEquity, fCubeful ? 8 : 2);
+    /* report the xhashes as one */
 
-        }
-        if (fTTY)
-            g_printerr("%d/%d     \r", iPos, n * n);
+    memset(&h, 0, sizeof(h));
+    for (iThread = 0; iThread < nThreads; ++iThread) {
+        h.nHashSize += atw[iThread].h.nHashSize;
+        h.nQueries += atw[iThread].h.nQueries;
+        h.nHits += atw[iThread].h.nHits;
+        h.nEntries += atw[iThread].h.nEntries;
+        h.nOverwrites += atw[iThread].h.nOverwrites;
+        XhashDestroy(&atw[iThread].h);
     }
-
-    putc('\n', stderr);
     XhashStatus(&h);
 
-    XhashDestroy(&h);
+    /* every xhash miss was a re-read */
+    cLookup += (long) (h.nQueries - h.nHits);
+
+    g_free(tg.asiLevel);
+    g_free(atw);
 
     /* sort file from ordering:
      * 
@@ -1239,20 +1695,23 @@ generate_ts(const int nTSP, const int nTSC,
      * 
      */
 
-    for (i = 0; i < n; ++i) {
-        for (j = 0; j < n; ++j) {
-            unsigned int count = fCubeful ? 8 : 2;
+    if (nBlockSize)
+        WriteBlocked(pfTmp, n, fCubeful, nBlockSize, output);
+    else
+        for (i = 0; i < n; ++i) {
+            for (j = 0; j < n; ++j) {
+                unsigned int count = fCubeful ? 8 : 2;
 
-            k = CalcPosition(i, j, n);
+                k = CalcPosition(i, j, n);
 
-            fseek(pfTmp, count * k, SEEK_SET);
-            if (fread(ac, 1, count, pfTmp) != count || fwrite(ac, 1, count, output) != count) {
-                g_printerr(_("failed to read from or write to database file\n"));
-                exit(3);
+                fseek(pfTmp, count * k, SEEK_SET);
+                if (fread(ac, 1, count, pfTmp) != count || fwrite(ac, 1, count, output) != count) {
+                    g_printerr(_("failed to read from or write to database file\n"));
+                    exit(3);
+                }
             }
-        }
 
-    }
+        }
 
     fclose(pfTmp);
 
@@ -1276,6 +1735,9 @@ main(int argc, char **argv)
     static int fND = FALSE;
     static char *szOutput = NULL;
     static char *szTwoSided = NULL;
+    static int nThreads = 1;
+    static int nBlockSize = 0;
+    static int fOutOfCore = FALSE;
 
     bearoffcontext *pbc = NULL;
     FILE *outfile;
@@ -1303,6 +1765,12 @@ main(int argc, char **argv)
          N_("Approximate one-sided bearoff database with normal distributions"), NULL},
         {"outfile", 'f', 0, G_OPTION_ARG_STRING, &szOutput,
          N_("Required output filename"), "filename"},
+        {"threads", 'T', 0, G_OPTION_ARG_INT, &nThreads,
+         N_("Use N threads for two-sided databases"), "N"},
+        {"out-of-core", 'X', 0, G_OPTION_ARG_NONE, &fOutOfCore,
+         N_("Generate one-sided databases a pip count at a time through a temporary file"), NULL},
+        {"block-size", 'b', 0, G_OPTION_ARG_INT, &nBlockSize,
+         N_("Compress two-sided databases in blocks of N positions"), "N"},
         {NULL, 0, 0, (GOptionArg) 0, NULL, NULL, NULL}
     };
 
@@ -1336,6 +1804,15 @@ main(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
 
+#if defined(USE_MULTITHREAD)
+    if (nThreads < 1 || nThreads > (int) MT_GetMaxThreads()) {
+        g_printerr(_("Number of threads must be between 1 and %u\n"), MT_GetMaxThreads());
+        exit(EXIT_FAILURE);
+    }
+#else
+    nThreads = 1;
+#endif
+
     if (!(outfile = g_fopen(szOutput, "w+b"))) {
         perror(szOutput);
         return EXIT_FAILURE;
@@ -1345,8 +1822,8 @@ main(int argc, char **argv)
 
     if (nOS) {
 
-        if (nOS > 13) {
-            g_printerr(_("Size of one-sided bearoff database should be at most 13 points\n"));
+        if (nOS > 15) {
+            g_printerr(_("Size of one-sided bearoff database should be at most 15 points\n"));
             exit(2);
         }
         g_printerr("%-37s\n", _("One-sided database"));
@@ -1357,6 +1834,7 @@ main(int argc, char **argv)
         g_printerr("%-37s: %12s\n", _("Include gammon distributions"), fGammon ? _("yes") : _("no"));
         g_printerr("%-37s: %12s\n", _("Use compression scheme"), fCompress ? _("yes") : _("no"));
         g_printerr("%-37s: %12s\n", _("Write header"), fHeader ? _("yes") : _("no"));
+        g_printerr("%-37s: %12s\n", _("Generate out of core"), fOutOfCore ? _("yes") : _("no"));
         g_printerr("%-37s: %12d\n", _("Size of cache"), nHashSize);
         g_printerr("%-37s: %12s %s\n", _("Reuse old bearoff database"), szOldBearoff ? _("yes") : _("no"),
                 szOldBearoff ? szOldBearoff : "");
@@ -1388,6 +1866,8 @@ main(int argc, char **argv)
 
         if (fND) {
             generate_nd(nOS, nHashSize, fHeader, pbc, outfile);
+        } else if (fOutOfCore) {
+            generate_os_levels(nOS, fHeader, fCompress, fGammon, nHashSize, pbc, outfile);
         } else {
             generate_os(nOS, fHeader, fCompress, fGammon, nHashSize, pbc, outfile);
         }
@@ -1410,6 +1890,11 @@ main(int argc, char **argv)
             exit(2);
         }
 
+        if (nBlockSize < 0 || nBlockSize > BEAROFF_MAX_BLOCK_SIZE) {
+            g_printerr(_("Block size must be between 1 and %d positions\n"), BEAROFF_MAX_BLOCK_SIZE);
+            exit(2);
+        }
+
         r = n;
         r = r * r * (fCubeful ? 8.0 : 2.0);
         g_printerr("%-37s\n", _("Two-sided database:\n"));
@@ -1422,6 +1907,9 @@ main(int argc, char **argv)
         g_printerr("%-37s: %12d\n", _("Total number of positions"), n * n);
         g_printerr("%-37s: %.0f %s (%.1f MB)\n", _("Size of resulting file"), r, _("bytes"), r / 1048576.0);
         g_printerr("%-37s: %12d\n", _("Size of xhash"), nHashSize);
+        g_printerr("%-37s: %12d\n", _("Number of threads"), nThreads);
+        if (nBlockSize)
+            g_printerr("%-37s: %12d\n", _("Positions per compressed block"), nBlockSize);
         g_printerr("%-37s: %12s %s\n", _("Reuse old bearoff database"), szOldBearoff ? _("yes") : _("no"),
                 szOldBearoff ? szOldBearoff : "");
         /* initialise old bearoff database */
@@ -1438,7 +1926,8 @@ main(int argc, char **argv)
             exit(2);
         }
 
-        generate_ts(nTSP, nTSC, fHeader, fCubeful, nHashSize, pbc, outfile);
+        generate_ts(nTSP, nTSC, fHeader, fCubeful, nHashSize, (unsigned int) nThreads, (unsigned int) nBlockSize,
+                    pbc, outfile);
 
         /* close old bearoff database */
 
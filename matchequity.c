@@ -88,6 +88,9 @@ float aaaafGammonPricesPostCrawford[MAXCUBELEVEL]
 
 metinfo miCurrent;
 
+/* changes whenever InitMatchEquity() loads a table */
+unsigned int nMETGeneration;
+
 
 /*
  * Calculate area under normal distribution curve (with mean rMu and 
@@ -1507,6 +1510,8 @@ InitMatchEquity(const char *szFileName)
     int i, j;
     metdata md;
 
+    nMETGeneration++;
+
     /* Read match equity table from XML file */
     if (readMET(&md, szFileName) != 0) {        /* load failed - make default as must have a met */
         getDefaultMET(&md);
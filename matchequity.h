@@ -54,6 +54,7 @@ extern float aaaafGammonPricesPostCrawford[MAXCUBELEVEL]
     [MAXSCORE][2][4];
 
 extern metinfo miCurrent;
+extern unsigned int nMETGeneration;
 
 extern float
 getME(const int nScore0, const int nScore1, const int nMatchTo,
@@ -40,6 +40,9 @@ MT_CreateThreadLocalData(int id)
 {
     ThreadLocalData *tld = (ThreadLocalData *) g_malloc(sizeof(ThreadLocalData));
     tld->id = id;
+    tld->pGroup = NULL;
+    memset(&tld->ms, 0, sizeof(tld->ms));
+    tld->pStats = &tld->ms;
     tld->pnnState = (NNState *) g_malloc(sizeof(NNState) * 3);
     memset(tld->pnnState, 0, sizeof(NNState) * 3);
     // cppcheck-suppress duplicateExpression
@@ -61,6 +64,15 @@ MT_CreateThreadLocalData(int id)
 
     tld->aMoves = (move *) g_malloc(sizeof(move) * MAX_INCOMPLETE_MOVES);
     memset(tld->aMoves, 0, sizeof(move) * MAX_INCOMPLETE_MOVES);
+
+    /* the workers (id >= 0) count into the pool; the others are listed
+     * for MT_GetStats() and keep their data until the program ends */
+    tld->pNextOther = NULL;
+    if (id < 0)
+        do
+            tld->pNextOther = g_atomic_pointer_get(&td.ptldOther);
+        while (!g_atomic_pointer_compare_and_exchange(&td.ptldOther, tld->pNextOther, tld));
+
     return tld;
 }
 
@@ -70,6 +82,25 @@ MT_CreateThreadLocalData(int id)
 unsigned int mainThreadID;
 #endif
 
+#if !defined(MAX_NUMTHREADS)
+extern unsigned int
+MT_GetMaxThreads(void)
+{
+    static unsigned int nMax = 0;
+
+    if (!nMax) {
+        unsigned int n = 0;
+
+#if GLIB_CHECK_VERSION (2,36,0)
+        n = 2 * g_get_num_processors();
+#endif
+        nMax = MAX(n, MT_DEFAULT_MAX_THREADS);
+    }
+
+    return nMax;
+}
+#endif
+
 #if GLIB_CHECK_VERSION (2,32,0)
 static GMutex condMutex;        /* Extra mutex needed for waiting */
 #else
@@ -261,10 +292,6 @@ MT_InitThreads(void)
     g_assert(g_thread_supported());
 #endif
     td.tasks = NULL;
-    MT_SafeSet(&td.doneTasks, 0);
-    td.addedTasks = 0;
-    td.totalTasks = -1;
-    InitManualEvent(&td.activity);
     TLSCreate(&td.tlsItem);
     TLSSetValue(td.tlsItem, (size_t) MT_CreateThreadLocalData(-1));
 
@@ -272,7 +299,6 @@ MT_InitThreads(void)
     mainThreadID = GetCurrentThreadId();
 #endif
     InitMutex(&td.multiLock);
-    InitMutex(&td.queueLock);
     InitManualEvent(&td.syncStart);
     InitManualEvent(&td.syncEnd);
 #if !GLIB_CHECK_VERSION (2,32,0)
@@ -302,18 +328,16 @@ CloseThread(void *UNUSED(unused))
 
     g_free(pnnState);
     g_free(pTLD);
-
-    MT_SafeInc(&td.result);
 }
 
 extern void
 MT_Close(void)
 {
-    MT_CloseThreads();
+    /* none after MT_StopThreads() */
+    if (td.numThreads)
+        MT_CloseThreads();
 
-    FreeManualEvent(td.activity);
     FreeMutex(&td.multiLock);
-    FreeMutex(&td.queueLock);
 
     FreeManualEvent(td.syncStart);
     FreeManualEvent(td.syncEnd);
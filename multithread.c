@@ -25,6 +25,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <glib.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
 #if defined(USE_GTK)
 #include "gtkgame.h"
 #endif
@@ -37,7 +40,500 @@
 
 #if defined(USE_MULTITHREAD)
 
-static GThread* thread[MAX_NUMTHREADS];
+static GThread **thread;
+
+/*
+ * Work-stealing scheduler.
+ *
+ * Each worker owns a Chase-Lev deque (D. Chase and Y. Lev, "Dynamic
+ * Circular Work-Stealing Deque", SPAA 2005) per priority class: the
+ * owner pushes and pops at the bottom without locking, the other
+ * workers steal from the top with a compare-and-swap.  Tasks added by
+ * other threads (normally the main thread) go onto a lock-free stack
+ * of their class; the first idle worker to see it takes all of it onto
+ * its own deque, and the rest of the workers steal from there.  A
+ * worker looking for a task goes through the classes from the most
+ * urgent down.  Workers that find nothing to do park on their own
+ * event and are woken one at a time as work arrives.
+ *
+ * Subtasks of MT_Spawn() go onto a deque of their own, which comes
+ * before all the others: their parent holds a worker until they are
+ * done.  A worker waiting in MT_Sync() runs subtasks from there,
+ * its own first, and nothing else, so that it does not start another
+ * top-level task (and go on to wait in that) on top of its stack.
+ *
+ * The deque indices only ever grow and are compared through their
+ * difference, so they may wrap around.
+ */
+
+#define WORKER_DEQUE_SIZE 256   /* initial size, a power of two */
+#define WORKER_SPINS 16         /* attempts to find work before parking */
+#define SPAWN_DEQUE MT_NUM_PRIORITIES   /* the deque for subtasks */
+#define WORKER_DEQUES (MT_NUM_PRIORITIES + 1)
+
+typedef struct {
+    guint nSize;
+    Task *apTask[1];
+} TaskArray;
+
+typedef struct {
+    gint iTop;                  /* next task to be stolen */
+    char achPad[MT_CACHE_LINE - sizeof(gint)];
+    gint iBottom;               /* next free slot; written by the owner only */
+    TaskArray *pta;
+    GSList *plRetired;          /* arrays that stealers may still be reading */
+    char achPadEnd[MT_CACHE_LINE];
+} Deque;
+
+typedef struct {
+    Deque aDeque[WORKER_DEQUES];
+    ManualEvent evPark;
+    gint fParked;
+    char achPad[MT_CACHE_LINE];
+    mtstats ms;                 /* written by the worker only */
+    char achPadEnd[MT_CACHE_LINE];
+} Worker;
+
+static Worker *aWorker;
+static unsigned int nWorkers;   /* the size of aWorker */
+static Task *aptInjected[MT_NUM_PRIORITIES];    /* tasks added from outside the workers, newest first */
+static gint nParked;
+static gint nEpoch;             /* counts the calls of MT_AbortTasks() */
+static mtgroup *pgDefault;      /* the group of MT_AddTask() and friends */
+
+static TaskArray *
+TaskArrayNew(guint nSize)
+{
+    TaskArray *pta = g_malloc(sizeof(TaskArray) + (nSize - 1) * sizeof(Task *));
+
+    pta->nSize = nSize;
+    return pta;
+}
+
+static int
+DequeSize(Deque * pd)
+{
+    guint t = (guint) g_atomic_int_get(&pd->iTop);
+    guint b = (guint) g_atomic_int_get(&pd->iBottom);
+
+    return (gint) (b - t) > 0 ? (int) (b - t) : 0;
+}
+
+static void
+DequePush(Deque * pd, Task * pt)
+{
+    guint b = (guint) g_atomic_int_get(&pd->iBottom);
+    guint t = (guint) g_atomic_int_get(&pd->iTop);
+    TaskArray *pta = pd->pta;
+
+    if (b - t >= pta->nSize) {
+        TaskArray *ptaNew = TaskArrayNew(2 * pta->nSize);
+        guint i;
+
+        for (i = t; i != b; ++i)
+            ptaNew->apTask[i & (ptaNew->nSize - 1)] = pta->apTask[i & (pta->nSize - 1)];
+        g_atomic_pointer_set(&pd->pta, ptaNew);
+        pd->plRetired = g_slist_prepend(pd->plRetired, pta);
+        pta = ptaNew;
+    }
+
+    g_atomic_pointer_set(&pta->apTask[b & (pta->nSize - 1)], pt);
+    g_atomic_int_set(&pd->iBottom, (gint) (b + 1));
+}
+
+static Task *
+DequePop(Deque * pd)
+{
+    guint b = (guint) g_atomic_int_get(&pd->iBottom) - 1;
+    TaskArray *pta = pd->pta;
+    guint t;
+    Task *pt;
+
+    g_atomic_int_set(&pd->iBottom, (gint) b);
+    t = (guint) g_atomic_int_get(&pd->iTop);
+
+    if ((gint) (b - t) < 0) {
+        /* empty */
+        g_atomic_int_set(&pd->iBottom, (gint) t);
+        return NULL;
+    }
+
+    pt = g_atomic_pointer_get(&pta->apTask[b & (pta->nSize - 1)]);
+    if (b != t)
+        return pt;
+
+    /* the last task: race the thieves for it */
+    if (!g_atomic_int_compare_and_exchange(&pd->iTop, (gint) t, (gint) (t + 1)))
+        pt = NULL;
+    g_atomic_int_set(&pd->iBottom, (gint) (t + 1));
+    return pt;
+}
+
+static Task *
+DequeSteal(Deque * pd)
+{
+    guint t = (guint) g_atomic_int_get(&pd->iTop);
+    guint b = (guint) g_atomic_int_get(&pd->iBottom);
+    TaskArray *pta;
+    Task *pt;
+
+    if ((gint) (b - t) <= 0)
+        return NULL;
+
+    pta = g_atomic_pointer_get(&pd->pta);
+    pt = g_atomic_pointer_get(&pta->apTask[t & (pta->nSize - 1)]);
+    if (!g_atomic_int_compare_and_exchange(&pd->iTop, (gint) t, (gint) (t + 1)))
+        return NULL;            /* somebody else got it */
+
+    return pt;
+}
+
+static void
+InjectTask(Task * pt)
+{
+    Task **pptInjected = &aptInjected[pt->pGroup->priority];
+    Task *ptHead;
+
+    do {
+        ptHead = g_atomic_pointer_get(pptInjected);
+        pt->pNext = ptHead;
+    } while (!g_atomic_pointer_compare_and_exchange(pptInjected, ptHead, pt));
+}
+
+/* Take every injected task of a class; the list is newest first. */
+
+static Task *
+TakeInjected(int p)
+{
+    Task *pt;
+
+    do {
+        pt = g_atomic_pointer_get(&aptInjected[p]);
+    } while (pt && !g_atomic_pointer_compare_and_exchange(&aptInjected[p], pt, NULL));
+
+    return pt;
+}
+
+static int
+WorkerQueued(Worker * pw)
+{
+    int p, n = 0;
+
+    for (p = 0; p < WORKER_DEQUES; ++p)
+        n += DequeSize(&pw->aDeque[p]);
+
+    return n;
+}
+
+static gboolean
+WorkAvailable(void)
+{
+    unsigned int i;
+    int p;
+
+    for (p = 0; p < MT_NUM_PRIORITIES; ++p)
+        if (g_atomic_pointer_get(&aptInjected[p]))
+            return TRUE;
+
+    for (i = 0; i < nWorkers; ++i)
+        if (WorkerQueued(&aWorker[i]) > 0)
+            return TRUE;
+
+    return FALSE;
+}
+
+static void
+WakeWorkers(int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < nWorkers && n > 0 && MT_SafeGet(&nParked) > 0; ++i)
+        if (g_atomic_int_compare_and_exchange(&aWorker[i].fParked, TRUE, FALSE)) {
+            MT_SafeDec(&nParked);
+            SetManualEvent(aWorker[i].evPark);
+            --n;
+        }
+}
+
+static void
+ParkWorker(Worker * pw)
+{
+    ResetManualEvent(pw->evPark);
+    g_atomic_int_set(&pw->fParked, TRUE);
+    MT_SafeInc(&nParked);
+
+    /* work added before we were counted as parked would not wake us */
+    if (!WorkAvailable())
+        WaitForManualEvent(pw->evPark);
+
+    if (g_atomic_int_compare_and_exchange(&pw->fParked, TRUE, FALSE))
+        MT_SafeDec(&nParked);
+}
+
+static Task *
+FindSubtask(unsigned int id)
+{
+    Task *pt;
+    unsigned int i;
+
+    if ((pt = DequePop(&aWorker[id].aDeque[SPAWN_DEQUE])) != NULL)
+        return pt;
+
+    for (i = 1; i < nWorkers; ++i)
+        if ((pt = DequeSteal(&aWorker[(id + i) % nWorkers].aDeque[SPAWN_DEQUE])) != NULL)
+            return pt;
+
+    return NULL;
+}
+
+static Task *
+FindTask(unsigned int id)
+{
+    Task *pt, *ptNext;
+    unsigned int i;
+    int p, n;
+
+    if ((pt = FindSubtask(id)) != NULL)
+        return pt;
+
+    for (p = 0; p < MT_NUM_PRIORITIES; ++p) {
+        Deque *pd = &aWorker[id].aDeque[p];
+
+        if ((pt = DequePop(pd)) != NULL)
+            return pt;
+
+        /* Move the injected tasks to our deque, oldest at the bottom so
+         * that we run them in the order they were added and the thieves
+         * take the newest. */
+        for (n = 0, pt = TakeInjected(p); pt; pt = ptNext, ++n) {
+            ptNext = pt->pNext;
+            DequePush(pd, pt);
+        }
+        if (n) {
+            WakeWorkers(n - 1);
+            if ((pt = DequePop(pd)) != NULL)
+                return pt;
+        }
+
+        for (i = 1; i < nWorkers; ++i)
+            if ((pt = DequeSteal(&aWorker[(id + i) % nWorkers].aDeque[p])) != NULL)
+                return pt;
+    }
+
+    return NULL;
+}
+
+/*
+ * Thread placement.
+ *
+ * With "compact" affinity consecutive workers share a core (when SMT
+ * is on), then a package, then a NUMA node; with "scatter" they go
+ * round the nodes first and fill the second hardware thread of each
+ * core last.  With SMT off only the first hardware thread of each core
+ * is used.  A worker allocates its own ThreadLocalData after it has
+ * been placed, so the kernel's first-touch policy puts its move
+ * buffers and neural net state on the worker's node.
+ */
+
+static void MT_CreateThreads(void);
+
+threadaffinity taThreads = AFFINITY_NONE;
+const char *aszThreadAffinity[] = { "none", "compact", "scatter" };
+
+int fThreadsSMT = TRUE;
+
+#if defined(__linux__)
+typedef struct {
+    int iCPU;
+    int iNode;
+    int iPackage;
+    int iCore;
+    int iSibling;               /* 0 for the first hardware thread of a core */
+    int iRank;                  /* the core's position within its node */
+} cpuplace;
+
+static cpuplace *acpPlace;      /* where worker i goes: acpPlace[i % nPlaces] */
+static unsigned int nPlaces;
+
+static int
+ReadTopology(int iCPU, const char *szItem)
+{
+    char *szFile = g_strdup_printf("/sys/devices/system/cpu/cpu%d/topology/%s", iCPU, szItem);
+    char *pch = NULL;
+    int n = 0;
+
+    if (g_file_get_contents(szFile, &pch, NULL, NULL))
+        n = atoi(pch);
+
+    g_free(pch);
+    g_free(szFile);
+    return n;
+}
+
+static int
+ReadNode(int iCPU)
+{
+    char *szDir = g_strdup_printf("/sys/devices/system/cpu/cpu%d", iCPU);
+    GDir *pd = g_dir_open(szDir, 0, NULL);
+    const char *szName;
+    int n = 0;
+
+    if (pd) {
+        while ((szName = g_dir_read_name(pd)) != NULL)
+            if (!strncmp(szName, "node", 4) && g_ascii_isdigit(szName[4])) {
+                n = atoi(szName + 4);
+                break;
+            }
+        g_dir_close(pd);
+    }
+
+    g_free(szDir);
+    return n;
+}
+
+static int
+CompareCompact(const void *p1, const void *p2)
+{
+    const cpuplace *pcp1 = (const cpuplace *) p1;
+    const cpuplace *pcp2 = (const cpuplace *) p2;
+
+    if (pcp1->iNode != pcp2->iNode)
+        return pcp1->iNode - pcp2->iNode;
+    if (pcp1->iPackage != pcp2->iPackage)
+        return pcp1->iPackage - pcp2->iPackage;
+    if (pcp1->iCore != pcp2->iCore)
+        return pcp1->iCore - pcp2->iCore;
+    return pcp1->iSibling - pcp2->iSibling;
+}
+
+static int
+CompareScatter(const void *p1, const void *p2)
+{
+    const cpuplace *pcp1 = (const cpuplace *) p1;
+    const cpuplace *pcp2 = (const cpuplace *) p2;
+
+    if (pcp1->iSibling != pcp2->iSibling)
+        return pcp1->iSibling - pcp2->iSibling;
+    if (pcp1->iRank != pcp2->iRank)
+        return pcp1->iRank - pcp2->iRank;
+    return pcp1->iNode - pcp2->iNode;
+}
+
+/* Work out where the workers go, from the processors this process may
+ * run on.  Leaves nPlaces at 0 if the workers are not to be pinned. */
+
+static void
+PlanPlacement(void)
+{
+    cpu_set_t set;
+    int i, j, nNodes = 0;
+    int *anCores;
+
+    g_free(acpPlace);
+    acpPlace = NULL;
+    nPlaces = 0;
+
+    if ((taThreads == AFFINITY_NONE && fThreadsSMT) || sched_getaffinity(0, sizeof(set), &set) < 0)
+        return;
+
+    acpPlace = g_new0(cpuplace, CPU_COUNT(&set));
+
+    for (i = 0; i < CPU_SETSIZE; ++i) {
+        cpuplace *pcp;
+
+        if (!CPU_ISSET(i, &set))
+            continue;
+
+        pcp = &acpPlace[nPlaces];
+        pcp->iCPU = i;
+        pcp->iNode = ReadNode(i);
+        pcp->iPackage = ReadTopology(i, "physical_package_id");
+        pcp->iCore = ReadTopology(i, "core_id");
+        for (j = 0; j < (int) nPlaces; ++j)
+            if (acpPlace[j].iPackage == pcp->iPackage && acpPlace[j].iCore == pcp->iCore)
+                pcp->iSibling++;
+
+        if (pcp->iNode >= nNodes)
+            nNodes = pcp->iNode + 1;
+        ++nPlaces;
+    }
+
+    if (!fThreadsSMT) {
+        for (i = j = 0; i < (int) nPlaces; ++i)
+            if (!acpPlace[i].iSibling)
+                acpPlace[j++] = acpPlace[i];
+        nPlaces = (unsigned int) j;
+    }
+
+    qsort(acpPlace, nPlaces, sizeof(cpuplace), CompareCompact);
+
+    /* number the cores of each node; siblings follow their core */
+    anCores = g_new0(int, nNodes);
+    for (i = 0; i < (int) nPlaces; ++i)
+        acpPlace[i].iRank = acpPlace[i].iSibling ? acpPlace[i - 1].iRank : anCores[acpPlace[i].iNode]++;
+    g_free(anCores);
+
+    if (taThreads == AFFINITY_SCATTER)
+        qsort(acpPlace, nPlaces, sizeof(cpuplace), CompareScatter);
+}
+
+static void
+PlaceThread(unsigned int id)
+{
+    cpu_set_t set;
+    unsigned int i;
+
+    if (!nPlaces)
+        return;
+
+    CPU_ZERO(&set);
+    if (taThreads == AFFINITY_NONE) {
+        /* SMT off: free to move between the first hardware threads */
+        for (i = 0; i < nPlaces; ++i)
+            CPU_SET(acpPlace[i].iCPU, &set);
+    } else
+        CPU_SET(acpPlace[id % nPlaces].iCPU, &set);
+
+    if (sched_setaffinity(0, sizeof(set), &set) < 0)
+        multi_debug("sched_setaffinity failed");
+}
+#else
+static void
+PlanPlacement(void)
+{
+}
+
+static void
+PlaceThread(unsigned int UNUSED(id))
+{
+}
+#endif
+
+extern int
+MT_PlacementSupported(void)
+{
+#if defined(__linux__)
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+extern void
+MT_SetPlacement(threadaffinity ta, int fSMT)
+{
+    if (ta == taThreads && fSMT == fThreadsSMT)
+        return;
+
+    taThreads = ta;
+    fThreadsSMT = fSMT;
+
+    /* restart the workers where they now belong */
+    if (td.numThreads) {
+        MT_CloseThreads();
+        MT_CreateThreads();
+    }
+}
 
 extern unsigned int
 MT_GetNumThreads(void)
@@ -56,55 +552,197 @@ MT_CloseThreads(void)
         g_print(_("Error closing threads!\n"));
     for (i = 0; i < td.numThreads; i++)
         g_thread_join(thread[i]);
+
+    for (i = 0; i < td.numThreads; i++) {
+        int p;
+
+        for (p = 0; p < WORKER_DEQUES; ++p) {
+            g_slist_foreach(aWorker[i].aDeque[p].plRetired, (GFunc) g_free, NULL);
+            g_slist_free(aWorker[i].aDeque[p].plRetired);
+            g_free(aWorker[i].aDeque[p].pta);
+        }
+        FreeManualEvent(aWorker[i].evPark);
+    }
+    nWorkers = 0;
+    g_free(aWorker);
+    aWorker = NULL;
+    g_free(thread);
+    thread = NULL;
+    MT_GroupFree(pgDefault);
+    pgDefault = NULL;
 }
 
-static void
-MT_TaskDone(Task * pt)
+extern mtgroup *
+MT_GroupNew(mtpriority priority)
+{
+    mtgroup *pg = g_new0(mtgroup, 1);
+
+    pg->priority = priority;
+    pg->anDone = g_new0(mtcounter, MT_GetMaxThreads() + 1);
+    return pg;
+}
+
+extern void
+MT_GroupFree(mtgroup * pg)
+{
+    if (pg) {
+        g_free(pg->anDone);
+        g_free(pg);
+    }
+}
+
+static mtgroup *
+DefaultGroup(void)
 {
-    MT_SafeInc(&td.doneTasks);
+    if (!pgDefault)
+        pgDefault = MT_GroupNew(MT_PRIORITY_INTERACTIVE);
+
+    return pgDefault;
+}
+
+/* The group of the task the calling thread is running, if any */
 
+static mtgroup *
+CurrentGroup(void)
+{
+    ThreadLocalData *pTLD = MT_GetTLD();
+
+    return pTLD->pGroup ? pTLD->pGroup : DefaultGroup();
+}
+
+/* Tasks are counted on the counter of the thread that finished them
+ * (the main thread and any other non-worker use the first one);
+ * MT_GroupDoneTasks() adds them up.  This must be the last access to
+ * the group: the thread waiting for it may free it at once. */
+
+static void
+MT_TaskDone(mtgroup * pg, Task * pt, int id)
+{
     if (pt) {
         free(pt->pLinkedTask);
         g_free(pt);
     }
+
+    MT_SafeInc(&pg->anDone[id + 1].n);
 }
 
-static Task *
-MT_GetTask(void)
+/* Tasks of a cancelled group that have not started are dropped as the
+ * workers come to them; the ones already running finish normally. */
+
+extern void
+MT_GroupCancel(mtgroup * pg)
+{
+    MT_SafeSet(&pg->result, -1);
+    MT_SafeSet(&pg->fCancelled, TRUE);
+}
+
+/* Drop every task that has not started yet, whatever its group, and
+ * fail the group of the calling task (or the default group when called
+ * from outside a task).  The deques belong to their workers, so rather
+ * than being emptied here the tasks are dropped as the workers come to
+ * them; tasks added afterwards run as usual.  MT_GroupCancel() stops a
+ * single group. */
+
+extern void
+MT_AbortTasks(void)
 {
-    Task *task = NULL;
+    MT_SafeInc(&nEpoch);
+    MT_SafeSet(&CurrentGroup()->result, -1);
+}
 
-    multi_debug("get task asks lock (queueLock)");
-    Mutex_Lock(&td.queueLock);
-    multi_debug("get task gets lock (queueLock)");
+/* Run a task other than CloseThread on worker id */
 
-    if (g_list_length(td.tasks) > 0) {
-        task = (Task *) g_list_first(td.tasks)->data;
-        td.tasks = g_list_delete_link(td.tasks, g_list_first(td.tasks));
-        if (g_list_length(td.tasks) == 0) {
-            ResetManualEvent(td.activity);
+static void
+RunTask(ThreadLocalData * pTLD, Task * pt, int id)
+{
+    mtgroup *pg = pt->pGroup;
+    mtgroup *pgOuter = pTLD->pGroup;    /* set when helping in MT_Sync() */
+    mtsync *ps = pt->pSync;
+
+    /* a subtask always runs: its parent depends on it */
+    if (ps || (!MT_SafeGet(&pg->fCancelled) && pt->nEpoch == MT_SafeGet(&nEpoch))) {
+        pTLD->pGroup = pg;
+        pt->fun(pt->data);
+        pTLD->pGroup = pgOuter;
+        pTLD->pStats->cTasks++;
+    } else
+        MT_SafeSet(&pg->result, -1);
+
+    if (ps) {
+        g_free(pt);
+        MT_SafeDec(&ps->nPending);      /* the parent may return at once */
+    } else
+        MT_TaskDone(pg, pt, id);
+}
+
+/* Copy the statistics of the threads outside the pool, added up, then
+ * those of each worker, into ams; returns how many were copied */
+
+extern unsigned int
+MT_GetStats(mtstats * ams, unsigned int cMax)
+{
+    unsigned int i, c = 0;
+    const ThreadLocalData *ptld;
+
+    if (c < cMax) {
+        memset(&ams[c], 0, sizeof(mtstats));
+        for (ptld = g_atomic_pointer_get(&td.ptldOther); ptld; ptld = ptld->pNextOther) {
+            ams[c].cTasks += ptld->ms.cTasks;
+            ams[c].cEvaluations += ptld->ms.cEvaluations;
+            ams[c].usBusy += ptld->ms.usBusy;
         }
+        c++;
     }
+    for (i = 0; i < nWorkers && c < cMax; ++i)
+        ams[c++] = aWorker[i].ms;
 
-    Mutex_Release(&td.queueLock);
-    multi_debug("get task unlocks (queueLock)");
-
-    return task;
+    return c;
 }
 
+/* Run fun(data) as a subtask of the calling task.  Outside the workers,
+ * or with a single one, it is simply called. */
+
 extern void
-MT_AbortTasks(void)
+MT_Spawn(mtsync * ps, AsyncFun fun, void *data)
 {
-    Task *task;
-    /* Remove tasks from list */
-    while ((task = MT_GetTask()) != NULL)
-        MT_TaskDone(task);
+    ThreadLocalData *pTLD = MT_GetTLD();
+    Task *pt;
+
+    if (pTLD->id < 0 || nWorkers < 2) {
+        fun(data);
+        return;
+    }
+
+    pt = (Task *) g_malloc(sizeof(Task));
+    pt->fun = fun;
+    pt->data = data;
+    pt->pLinkedTask = NULL;
+    pt->pGroup = pTLD->pGroup ? pTLD->pGroup : pgDefault;
+    pt->pSync = ps;
 
-    MT_SafeSet(&td.result, -1);
+    MT_SafeInc(&ps->nPending);
+    DequePush(&aWorker[pTLD->id].aDeque[SPAWN_DEQUE], pt);
+    WakeWorkers(1);
+}
+
+/* Wait for the subtasks spawned on ps, running them (or other tasks'
+ * subtasks) meanwhile */
+
+extern void
+MT_Sync(mtsync * ps)
+{
+    ThreadLocalData *pTLD = MT_GetTLD();
+    Task *pt;
+
+    while (MT_SafeGet(&ps->nPending) > 0)
+        if ((pt = FindSubtask((unsigned int) pTLD->id)) != NULL)
+            RunTask(pTLD, pt, pTLD->id);
+        else
+            g_thread_yield();
 }
 
 static SIMD_STACKALIGN gpointer
-MT_WorkerThreadFunction(void *tld)
+MT_WorkerThreadFunction(void *pid)
 {
 #if 0
     /* why do we need this align ? - because of a gcc bug */
@@ -122,20 +760,48 @@ MT_WorkerThreadFunction(void *tld)
 
 #endif
     {
-        ThreadLocalData *pTLD = (ThreadLocalData *) tld;
+        unsigned int id = (unsigned int) GPOINTER_TO_INT(pid);
+        ThreadLocalData *pTLD;
+        gboolean fClose = FALSE;
+
+        /* place the thread before it allocates anything */
+        PlaceThread(id);
+        pTLD = MT_CreateThreadLocalData((int) id);
+        pTLD->pStats = &aWorker[id].ms;
         TLSSetValue(td.tlsItem, (size_t) pTLD);
 
-        MT_SafeInc(&td.result);
-        MT_TaskDone(NULL);      /* Thread created */
+        MT_SafeInc(&pgDefault->result);
+        MT_TaskDone(pgDefault, NULL, (int) id); /* Thread created */
         do {
-            Task *task;
-            WaitForManualEvent(td.activity);
-            task = MT_GetTask();
+            Task *task = NULL;
+            int i;
+
+            for (i = 0; i < WORKER_SPINS && !(task = FindTask(id)); ++i)
+                g_thread_yield();
+
             if (task) {
-                task->fun(task->data);
-                MT_TaskDone(task);
-            }
-        } while (MT_SafeCompare(&td.closingThreads, FALSE));
+                /* CloseThread frees our thread local data; stop after it */
+                fClose = task->fun == CloseThread;
+                if (fClose) {
+                    mtgroup *pg = task->pGroup;
+
+                    task->fun(task->data);
+                    MT_SafeInc(&pg->result);
+                    MT_TaskDone(pg, task, (int) id);
+                } else {
+                    /* timed here, as the subtasks run inside MT_Sync()
+                     * would otherwise be counted twice */
+                    gint64 t = g_get_monotonic_time();
+
+                    RunTask(pTLD, task, (int) id);
+                    pTLD->pStats->usBusy += g_get_monotonic_time() - t;
+                }
+            } else
+                ParkWorker(&aWorker[id]);
+        } while (!fClose);
+
+        /* leave anything still on our deques to the other workers */
+        WakeWorkers(WorkerQueued(&aWorker[id]));
 
 #if 0
 #if __GNUC__ && defined(WIN32)
@@ -165,15 +831,27 @@ MT_CreateThreads(void)
     multi_debug(buf);
     g_free(buf);
 #endif
-    MT_SafeSet(&td.result, 0);
     MT_SafeSet(&td.closingThreads, FALSE);
+    MT_SafeSet(&nParked, 0);
+    PlanPlacement();
+    thread = g_new0(GThread *, td.numThreads);
+    aWorker = g_new0(Worker, td.numThreads);
+    nWorkers = td.numThreads;
     for (i = 0; i < td.numThreads; i++) {
-        ThreadLocalData *pTLD = MT_CreateThreadLocalData(i);
+        int p;
 
+        for (p = 0; p < WORKER_DEQUES; ++p)
+            aWorker[i].aDeque[p].pta = TaskArrayNew(WORKER_DEQUE_SIZE);
+        InitManualEvent(&aWorker[i].evPark);
+    }
+    /* each worker counts itself in the default group as it starts */
+    MT_SafeSet(&DefaultGroup()->result, 0);
+    MT_SafeSet(&pgDefault->addedTasks, (int) td.numThreads);
+    for (i = 0; i < td.numThreads; i++) {
 #if GLIB_CHECK_VERSION (2,32,0)
-        if (!(thread[i] = g_thread_try_new(NULL, MT_WorkerThreadFunction, pTLD, NULL)))
+        if (!(thread[i] = g_thread_try_new(NULL, MT_WorkerThreadFunction, GINT_TO_POINTER(i), NULL)))
 #else
-        if (!(thread[i] = g_thread_create(MT_WorkerThreadFunction, pTLD, TRUE, NULL)))
+        if (!(thread[i] = g_thread_create(MT_WorkerThreadFunction, GINT_TO_POINTER(i), TRUE, NULL)))
 #endif
             printf(_("Failed to create thread\n"));
 #if defined(DEBUG_MULTITHREADED)
@@ -184,7 +862,6 @@ MT_CreateThreads(void)
         }
 #endif
     }
-    td.addedTasks = td.numThreads;
     /* Wait for all the threads to be created (timeout after 1 second) */
     if (MT_WaitForTasks(WaitingForThreads, 1000, FALSE) != (int) td.numThreads)
         g_print(_("Error creating threads!\n"));
@@ -218,6 +895,8 @@ MT_SetNumThreads(unsigned int num)
     }
 }
 
+static unsigned int nStoppedThreads;    /* by MT_StopThreads() */
+
 extern void
 MT_StartThreads(void)
 {
@@ -226,63 +905,100 @@ MT_StartThreads(void)
          * fraction of that ?) but it is probably not a good idea to hog
          * a lot of resources by default.
          */
-        td.numThreads = 1;
+        td.numThreads = nStoppedThreads ? nStoppedThreads : 1;
 
         MT_CreateThreads();
     }
 }
 
+/* Close the threads until MT_StartThreads() creates as many again, so
+ * that the process may fork(): the child would only have the calling
+ * thread, and the locks held by the others at the time */
+
+extern void
+MT_StopThreads(void)
+{
+    if (td.numThreads == 0)
+        return;
+
+    MT_CloseThreads();
+    nStoppedThreads = td.numThreads;
+    td.numThreads = 0;
+}
+
+static void
+AddTask(mtgroup * pg, Task * pt)
+{
+    int id = MT_GetThreadID();
+
+    pt->pGroup = pg;
+    pt->pSync = NULL;
+    pt->nEpoch = MT_SafeGet(&nEpoch);
+    if (MT_SafeIncCheck(&pg->addedTasks) == 0)
+        MT_SafeSet(&pg->result, 0);     /* Reset result for new tasks */
+
+    if (id >= 0 && (unsigned int) id < nWorkers)
+        DequePush(&aWorker[id].aDeque[pg->priority], pt);       /* added by a task */
+    else
+        InjectTask(pt);
+}
+
+extern void
+MT_GroupAddTask(mtgroup * pg, Task * pt)
+{
+    multi_debug("add task");
+    AddTask(pg, pt);
+    WakeWorkers(1);
+}
+
+/* The queue no longer has a lock, so lock is ignored */
+
 void
-MT_AddTask(Task * pt, gboolean lock)
+MT_AddTask(Task * pt, gboolean UNUSED(lock))
 {
-    if (lock) {
-        multi_debug("add task asks lock (queueLock)");
-        Mutex_Lock(&td.queueLock);
-        multi_debug("add task gets lock (queueLock)");
-    }
-    if (td.addedTasks == 0)
-        MT_SafeSet(&td.result, 0);          /* Reset result for new tasks */
-    td.addedTasks++;
-    td.tasks = g_list_append(td.tasks, pt);
-    if (g_list_length(td.tasks) == 1) { /* New tasks */
-        SetManualEvent(td.activity);
-    }
-    if (lock) {
-        Mutex_Release(&td.queueLock);
-        multi_debug("add task unlocks");
-    }
+    MT_GroupAddTask(DefaultGroup(), pt);
 }
 
 extern void
-mt_add_tasks(unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer linked)
+mt_group_add_tasks(mtgroup * pg, unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer linked)
 {
     unsigned int i;
-    {
-#if defined(DEBUG_MULTITHREADED)
-        multi_debug("add %u task%s asks lock (queueLock)", num_tasks, (num_tasks > 1 ? "s" : ""));
-        Mutex_Lock(&td.queueLock);
-        multi_debug("add tasks gets lock (queueLock)");
-#else
-        Mutex_Lock(&td.queueLock);
-#endif
-    }
+
+    multi_debug("add tasks");
     for (i = 0; i < num_tasks; i++) {
         Task *pt = (Task *) g_malloc(sizeof(Task));
         pt->fun = pFun;
         pt->data = taskData;
         pt->pLinkedTask = linked;
-        MT_AddTask(pt, FALSE);
+        AddTask(pg, pt);
     }
-    Mutex_Release(&td.queueLock);
-    multi_debug("add tasks unlocks (queueLock)");
+    WakeWorkers((int) num_tasks);
+}
+
+extern void
+mt_add_tasks(unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer linked)
+{
+    mt_group_add_tasks(DefaultGroup(), num_tasks, pFun, taskData, linked);
+}
+
+/* A task may add more tasks to its own group before it finishes, so
+ * all of them are done once the finished count, read first, has
+ * caught up with the added count. */
+
+static gboolean
+GroupFinished(const mtgroup * pg)
+{
+    int nDone = MT_GroupDoneTasks(pg);
+
+    return nDone == MT_SafeGet(&pg->addedTasks);
 }
 
 static gboolean
-WaitForAllTasks(int time)
+WaitForAllTasks(const mtgroup * pg, int time)
 {
     int j = 0;
 
-    while (!MT_SafeCompare(&td.doneTasks, td.totalTasks)) {
+    while (!GroupFinished(pg)) {
         
         // if (pmrCurAnn != NULL) {
         //     g_message("in the loop: pmrCurAnn exists");
@@ -299,7 +1015,7 @@ WaitForAllTasks(int time)
 }
 
 int
-MT_WaitForTasks(gboolean(*pCallback) (gpointer), int callbackTime, int autosave)
+MT_GroupWait(mtgroup * pg, gboolean(*pCallback) (gpointer), int callbackTime, int autosave)
 {
     int callbackLoops = callbackTime / UI_UPDATETIME;
     int waits = 0;
@@ -315,9 +1031,9 @@ MT_WaitForTasks(gboolean(*pCallback) (gpointer), int callbackTime, int autosave)
     int start2 = 1;
     //int myPage;
     int i=0;
+    unsigned int iCounter;
+    int result;
 
-    /* Set total tasks to wait for */
-    td.totalTasks = td.addedTasks;
 #if defined(USE_GTK)
         // g_message("MT_WaitForTasks\n");
     GTKSuspendInput();
@@ -327,7 +1043,7 @@ MT_WaitForTasks(gboolean(*pCallback) (gpointer), int callbackTime, int autosave)
     if (autosave)
         as_source = g_timeout_add(nAutoSaveTime * 60000, save_autosave, NULL);
     multi_debug("waiting for all tasks");
-    while (!WaitForAllTasks(polltime)) {
+    while (!WaitForAllTasks(pg, polltime)) {
         waits++;
         if (pCallback && waits >= callbackLoops) {
             waits = 0;
@@ -430,26 +1146,47 @@ MT_WaitForTasks(gboolean(*pCallback) (gpointer), int callbackTime, int autosave)
     }
     multi_debug("done waiting for all tasks");
 
-    MT_SafeSet(&td.doneTasks, 0);
-    td.addedTasks = 0;
-    td.totalTasks = -1;
+    /* nothing of the group is left running, so it can be reused */
+    result = MT_SafeGet(&pg->result);
+    for (iCounter = 0; iCounter <= MT_GetMaxThreads(); iCounter++)
+        MT_SafeSet(&pg->anDone[iCounter].n, 0);
+    MT_SafeSet(&pg->addedTasks, 0);
+    MT_SafeSet(&pg->fCancelled, FALSE);
 
 #if defined(USE_GTK)
     GTKResumeInput();
 #endif
-    return MT_SafeGet(&td.result);
+    return result;
+}
+
+int
+MT_WaitForTasks(gboolean(*pCallback) (gpointer), int callbackTime, int autosave)
+{
+    return MT_GroupWait(DefaultGroup(), pCallback, callbackTime, autosave);
 }
 
 extern void
 MT_SetResultFailed(void)
 {
-    MT_SafeSet(&td.result, -1);
+    MT_SafeSet(&CurrentGroup()->result, -1);
+}
+
+extern int
+MT_GroupDoneTasks(const mtgroup * pg)
+{
+    int n = 0;
+    unsigned int i;
+
+    for (i = 0; i <= MT_GetMaxThreads(); i++)
+        n += MT_SafeGet(&pg->anDone[i].n);
+
+    return n;
 }
 
 extern int
 MT_GetDoneTasks(void)
 {
-    return MT_SafeGet(&td.doneTasks);
+    return MT_GroupDoneTasks(DefaultGroup());
 }
 
 /* Code below used in calibrate to try and get a resonable figure for multiple threads */
@@ -583,4 +1320,76 @@ MT_AbortTasks(void)
     td.result = -1;
 }
 
+/* Without threads the tasks run in the order they were added, whatever
+ * their group */
+
+extern mtgroup *
+MT_GroupNew(mtpriority priority)
+{
+    mtgroup *pg = g_new0(mtgroup, 1);
+
+    pg->priority = priority;
+    return pg;
+}
+
+extern void
+MT_GroupFree(mtgroup * pg)
+{
+    g_free(pg);
+}
+
+extern void
+MT_GroupAddTask(mtgroup * UNUSED(pg), Task * pt)
+{
+    MT_AddTask(pt, FALSE);
+}
+
+extern void
+mt_group_add_tasks(mtgroup * UNUSED(pg), unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer linked)
+{
+    mt_add_tasks(num_tasks, pFun, taskData, linked);
+}
+
+extern int
+MT_GroupWait(mtgroup * UNUSED(pg), gboolean(*pCallback) (gpointer), int callbackTime, int autosave)
+{
+    return MT_WaitForTasks(pCallback, callbackTime, autosave);
+}
+
+extern void
+MT_GroupCancel(mtgroup * UNUSED(pg))
+{
+    MT_AbortTasks();
+}
+
+extern int
+MT_GroupDoneTasks(const mtgroup * UNUSED(pg))
+{
+    return MT_GetDoneTasks();
+}
+
+extern void
+MT_Spawn(mtsync * UNUSED(ps), AsyncFun fun, void *data)
+{
+    fun(data);
+}
+
+extern void
+MT_Sync(mtsync * UNUSED(ps))
+{
+}
+
+extern unsigned int
+MT_GetStats(mtstats * ams, unsigned int cMax)
+{
+    if (!cMax)
+        return 0;
+
+    if (td.tld)
+        ams[0] = td.tld->ms;
+    else
+        memset(&ams[0], 0, sizeof(mtstats));
+    return 1;
+}
+
 #endif
@@ -45,10 +45,60 @@ void multi_debug(const char *str, ...);
 #define multi_debug(x)
 #endif
 
+/* Counters written by many threads are kept a cache line apart so
+ * that they do not slow down each other or the data next to them. */
+
+#define MT_CACHE_LINE 64
+
+typedef union {
+    int n;
+    char ach[MT_CACHE_LINE];
+} mtcounter;
+
+/*
+ * Job groups.  Every task belongs to a group, which counts its tasks,
+ * holds their result and can be cancelled as a whole; MT_GroupWait()
+ * waits for the tasks of one group only.  Workers always take a task
+ * of the most urgent priority class available, so work the user is
+ * waiting for overtakes queued bulk work as soon as a task finishes.
+ * The MT_AddTask() family uses a default group of interactive priority.
+ */
+
+typedef enum {
+    MT_PRIORITY_INTERACTIVE,    /* hints, evaluations and moves */
+    MT_PRIORITY_ROLLOUT,
+    MT_PRIORITY_BATCH,          /* analysis */
+    MT_NUM_PRIORITIES
+} mtpriority;
+
+typedef struct mtgroup {
+    mtpriority priority;
+    int fCancelled;             /* tasks not yet started are dropped */
+    int result;
+    int addedTasks;
+    mtcounter *anDone;          /* finished tasks, per worker and one for the others */
+} mtgroup;
+
+/*
+ * Fork/join inside a task: MT_Spawn() queues fun(data) as a subtask and
+ * MT_Sync() waits for all the subtasks spawned on the same mtsync,
+ * which must start zeroed.  The waiting worker runs pending subtasks
+ * meanwhile, so the thread local data (move buffers, neural net state)
+ * may change across MT_Sync().
+ */
+
+typedef struct {
+    int nPending;
+} mtsync;
+
 typedef struct Task {
     AsyncFun fun;
     void *data;
     struct Task *pLinkedTask;
+    struct Task *pNext;         /* used by the scheduler */
+    mtgroup *pGroup;
+    mtsync *pSync;              /* set for the subtasks of MT_Spawn() */
+    int nEpoch;                 /* MT_AbortTasks() drops the tasks added before it */
 } Task;
 
 typedef struct {
@@ -59,10 +109,29 @@ typedef struct {
     matchstate ms;
 } AnalyseMoveTask;
 
+/*
+ * Statistics of a thread, updated by that thread without atomics so
+ * that counting costs nothing measurable; readers such as the metrics
+ * of the external interface may see slightly stale values.  Each worker
+ * has its own, which start again from zero when the workers are
+ * recreated; each thread outside the pool has one in its thread local
+ * data, and MT_GetStats() reports those added up.
+ */
+
 typedef struct {
+    guint64 cTasks;             /* tasks and subtasks run */
+    guint64 cEvaluations;       /* static evaluations at the leaves */
+    gint64 usBusy;              /* time spent running tasks */
+} mtstats;
+
+typedef struct ThreadLocalData {
     int id;
     move *aMoves;
     NNState *pnnState;
+    mtgroup *pGroup;            /* the group of the task being run */
+    mtstats *pStats;            /* never NULL */
+    mtstats ms;                 /* the statistics of a thread outside the pool */
+    struct ThreadLocalData *pNextOther; /* the thread outside the pool started before */
 } ThreadLocalData;
 
 typedef struct {
@@ -84,23 +153,20 @@ typedef GMutex *Mutex;
 
 typedef struct {
     GList *tasks;
-    int doneTasks;
-    int result;
     ThreadLocalData *tld;
+    ThreadLocalData *ptldOther; /* the threads outside the pool, latest first */
 
 #if defined(USE_MULTITHREAD)
-    ManualEvent activity;
     TLSItem tlsItem;
-    Mutex queueLock;
     Mutex multiLock;
     ManualEvent syncStart;
     ManualEvent syncEnd;
 
-    int addedTasks;
-    int totalTasks;
-
     int closingThreads;
     unsigned int numThreads;
+#else
+    int doneTasks;
+    int result;
 #endif
 } ThreadData;
 
@@ -109,11 +175,21 @@ extern void MT_AbortTasks(void);
 extern void MT_AddTask(Task * pt, gboolean lock);
 extern void mt_add_tasks(unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer linked);
 extern int MT_WaitForTasks(gboolean(*pCallback) (gpointer), int callbackTime, int autosave);
+extern mtgroup *MT_GroupNew(mtpriority priority);
+extern void MT_GroupFree(mtgroup * pg);
+extern void MT_GroupAddTask(mtgroup * pg, Task * pt);
+extern void mt_group_add_tasks(mtgroup * pg, unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer linked);
+extern int MT_GroupWait(mtgroup * pg, gboolean(*pCallback) (gpointer), int callbackTime, int autosave);
+extern void MT_GroupCancel(mtgroup * pg);
+extern int MT_GroupDoneTasks(const mtgroup * pg);
+extern void MT_Spawn(mtsync * ps, AsyncFun fun, void *data);
+extern void MT_Sync(mtsync * ps);
 extern void MT_InitThreads(void);
 extern void MT_Close(void);
 extern void MT_CloseThreads(void);
 extern void CloseThread(void *unused);
 extern ThreadLocalData *MT_CreateThreadLocalData(int id);
+extern unsigned int MT_GetStats(mtstats * ams, unsigned int cMax);
 
 extern ThreadData td;
 
@@ -132,13 +208,33 @@ extern void FreeMutex(Mutex * mutex);
 
 #define TLSGet(item) *((size_t*)g_private_get(item))
 
-#if !defined(MAX_NUMTHREADS)
-#define MAX_NUMTHREADS 48
+/* Unless the limit is fixed at configure time (--with-eval-max-threads)
+ * it is twice the number of processors, but at least
+ * MT_DEFAULT_MAX_THREADS. */
+
+#define MT_DEFAULT_MAX_THREADS 48
+
+#if defined(MAX_NUMTHREADS)
+#define MT_GetMaxThreads() ((unsigned int) MAX_NUMTHREADS)
+#else
+extern unsigned int MT_GetMaxThreads(void);
 #endif
 
+typedef enum {
+    AFFINITY_NONE, AFFINITY_COMPACT, AFFINITY_SCATTER
+} threadaffinity;
+
+extern threadaffinity taThreads;
+extern const char *aszThreadAffinity[];
+extern int fThreadsSMT;
+
+extern int MT_PlacementSupported(void);
+extern void MT_SetPlacement(threadaffinity ta, int fSMT);
+
 extern void MT_Release(void);
 extern void MT_Exclusive(void);
 extern void MT_StartThreads(void);
+extern void MT_StopThreads(void);
 extern void MT_SetNumThreads(unsigned int num);
 extern void MT_SyncInit(void);
 extern void MT_SyncStart(void);
@@ -170,11 +266,10 @@ extern unsigned int MT_GetNumThreads(void);
 #define MT_SafeGet(x) g_atomic_int_get(x)
 #define MT_SafeSet(x, y) g_atomic_int_set(x, y)
 #define MT_SafeCompare(x, y) g_atomic_int_compare_and_exchange(x, y, y)
+#define MT_SafeCompareAndSet(x, y, z) g_atomic_int_compare_and_exchange(x, y, z)
 
 #else                           /*USE_MULTITHREAD */
-#if !defined(MAX_NUMTHREADS)
-#define MAX_NUMTHREADS 1
-#endif
+#define MT_GetMaxThreads() 1U
 extern int asyncRet;
 #define MT_Exclusive() {}
 #define MT_Release() {}
@@ -189,6 +284,7 @@ extern int asyncRet;
 #define MT_SafeGet(x) (*x)
 #define MT_SafeSet(x, y) ((*x) = y)
 #define MT_SafeCompare(x, y) ((*x) == y)
+#define MT_SafeCompareAndSet(x, y, z) ((*x) == (y) ? ((*x) = (z), TRUE) : FALSE)
 #define MT_GetThreadID() 0
 #define MT_Get_nnState() td.tld->pnnState
 #define MT_Get_aMoves() td.tld->aMoves
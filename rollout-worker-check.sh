@@ -0,0 +1,98 @@
+#!/bin/sh
+
+# Copyright (C) 2022 the AUTHORS
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#
+# $Id$
+#
+
+#
+# Play the same seeded rollout locally and on a rollout worker listening
+# on 127.0.0.1, and check that both give exactly the same result.
+#
+# GNUBG names the program to test (default ./gnubg) and
+# ROLLOUT_WORKER_PORT the port the worker listens on (default 24242).
+#
+
+GNUBG=${GNUBG:-./gnubg}
+PORT=${ROLLOUT_WORKER_PORT:-24242}
+GNUBG_FLAGS="-t -q -r -P ${srcdir:-.}"
+
+# the results are found by their English label
+LC_ALL=C
+export LC_ALL
+
+tmp=${TMPDIR:-/tmp}/rollout-worker-check.$$
+mkdir "$tmp" || exit 99
+worker=
+
+cleanup() {
+    test -n "$worker" && kill "$worker" 2>/dev/null
+    rm -rf "$tmp"
+}
+trap cleanup EXIT
+trap 'exit 99' HUP INT TERM
+
+# the rollout; $1 is inserted before it is played
+rollout() {
+    cat <<EOF
+set player 0 human
+set player 1 human
+new game
+set board 4HPwATDgc/ABMA
+set rollout trials 144
+set rollout seed 20221018
+set threads 3
+$1
+rollout
+EOF
+}
+
+# the last progress line has the result after all trials
+result() {
+    tr -d '\r' < "$1" | grep 'Current Position' | tail -n 1
+}
+
+echo "rollout worker 127.0.0.1:$PORT" > "$tmp/worker"
+$GNUBG $GNUBG_FLAGS -c "$tmp/worker" > "$tmp/worker.out" 2>&1 &
+worker=$!
+
+rollout "" > "$tmp/local"
+$GNUBG $GNUBG_FLAGS -c "$tmp/local" > "$tmp/local.out" 2>&1 || exit 1
+
+# give the worker time to start listening
+sleep 2
+
+rollout "set rollout workers 127.0.0.1:$PORT" > "$tmp/distributed"
+$GNUBG $GNUBG_FLAGS -c "$tmp/distributed" > "$tmp/distributed.out" 2>&1 || exit 1
+
+if ! grep -q 'Accepted rollout coordinator' "$tmp/worker.out"; then
+    echo "the rollout worker was never used:"
+    cat "$tmp/worker.out" "$tmp/distributed.out"
+    exit 1
+fi
+
+local_result=$(result "$tmp/local.out")
+distributed_result=$(result "$tmp/distributed.out")
+
+if test -z "$local_result" || test "$local_result" != "$distributed_result"; then
+    echo "local:       $local_result"
+    echo "distributed: $distributed_result"
+    exit 1
+fi
+
+echo "$local_result"
+exit 0
@@ -38,6 +38,8 @@
 #include "positionid.h"
 #include "format.h"
 #include "multithread.h"
+#include "progress.h"
+#include "rolloutnet.h"
 #include "rollout.h"
 #include "lib/simd.h"
 
@@ -916,10 +918,37 @@ static int cGames;
 static cubeinfo *aciLocal;
 static int show_jsds;
 
+/* Running mean and sum of squared deviations (Welford) of the trials
+ * of one alternative. araAcc holds the merged results; trials are
+ * folded into it one at a time and in trial order, whoever played them,
+ * so the results of a given number of trials do not depend on the
+ * number of threads or on the rollout workers. */
+typedef struct {
+    unsigned int n;
+    double arMean[NUM_ROLLOUT_OUTPUTS];
+    double arM2[NUM_ROLLOUT_OUTPUTS];
+} rolloutacc;
+
+/* Trials are handed out and merged in blocks of ROLLOUT_BLOCK_TRIALS
+ * consecutive trials of one alternative, counted from where the
+ * alternative starts.  A block is accumulated on its own, in trial
+ * order, and blocks are combined into araAcc in order, by the rollout
+ * threads and the distributed rollouts alike. */
+#define ROLLOUT_BLOCK_TRIALS 8
+
+/* a block played by a rollout thread, not yet merged */
+typedef struct {
+    int alt;
+    int first;
+    rolloutacc ra;
+} rolloutblock;
+
+unsigned int nRolloutMergeInterval = 1;
+
 static float (*aarMu)[NUM_ROLLOUT_OUTPUTS];
 static float (*aarSigma)[NUM_ROLLOUT_OUTPUTS];
-static float (*aarResult)[NUM_ROLLOUT_OUTPUTS];
-static float (*aarVariance)[NUM_ROLLOUT_OUTPUTS];
+static rolloutacc *araAcc;
+static GHashTable **aphPendingBlocks;   /* by first trial: those that cannot be folded yet */
 static int *fNoMore;
 static jsdinfo *ajiJSD;
 
@@ -931,45 +960,53 @@ static int **ro_apCubeDecTop;
 static rolloutstat(*ro_aarsStatistics)[2];
 static int ro_fCubeRollout;
 static int ro_fInvert;
-static int ro_NextTrial;
+static mtcounter ro_NextTrial;
 static unsigned int *altGameCount;
-static int *altTrialCount;
+static mtcounter *altTrialCount;        /* one cache line each: every thread bumps them all */
+static int *afAllocate;          /* written under roLock; the rollout threads play from copies */
 
+/* the cubeful (or cubeless if that's what we're doing) equity of an
+ * alternative and its standard error */
 static void
-check_jsds(int *active)
+AltEquity(int alt, float *pv, float *ps)
 {
-    int alt;
-    float v, s, denominator;
+    rolloutcontext *prc = &ro_apes[alt]->rc;
+    float v, s;
+
+    if (prc->fCubeful) {
+        v = aarMu[alt][OUTPUT_CUBEFUL_EQUITY];
+        s = aarSigma[alt][OUTPUT_CUBEFUL_EQUITY];
+
+        /* if we're doing a cube rollout, we need aciLocal[0] for generating the
+         * equity. If we're doing moves, we use the cubeinfo that goes with this move. */
+        if (aciLocal[0].nMatchTo && !fOutputMWC) {
+            v = mwc2eq(v, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
+            s = se_mwc2eq(s, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
+        }
+    } else {
+        v = aarMu[alt][OUTPUT_EQUITY];
+        s = aarSigma[alt][OUTPUT_EQUITY];
 
-    for (alt = 0; alt < ro_alternatives; ++alt) {
+        if (aciLocal[0].nMatchTo && fOutputMWC) {
+            v = eq2mwc(v, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
+            s = se_eq2mwc(s, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
 
-        /* 1) For each move, calculate the cubeful (or cubeless if that's what we're doing)
-         * equity */
-        rolloutcontext *prc = &ro_apes[alt]->rc;
+        }
+    }
 
-        if (prc->fCubeful) {
-            v = aarMu[alt][OUTPUT_CUBEFUL_EQUITY];
-            s = aarSigma[alt][OUTPUT_CUBEFUL_EQUITY];
-
-            /* if we're doing a cube rollout, we need aciLocal[0] for generating the
-             * equity. If we're doing moves, we use the cubeinfo that goes with this move. */
-            if (ms.nMatchTo && !fOutputMWC) {
-                v = mwc2eq(v, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
-                s = se_mwc2eq(s, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
-            }
-        } else {
-            v = aarMu[alt][OUTPUT_EQUITY];
-            s = aarSigma[alt][OUTPUT_EQUITY];
+    *pv = v;
+    *ps = s;
+}
 
-            if (ms.nMatchTo && fOutputMWC) {
-                v = eq2mwc(v, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
-                s = se_eq2mwc(s, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
+static void
+check_jsds(int *active)
+{
+    int alt;
+    float v, s, denominator;
 
-            }
-        }
-        ajiJSD[alt].rEquity = v;
-        ajiJSD[alt].rJSD = s;
-    }
+    /* 1) For each move, calculate the equity */
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        AltEquity(alt, &ajiJSD[alt].rEquity, &ajiJSD[alt].rJSD);
 
     if (!ro_fCubeRollout) {
         /* 2 sort the list in order of decreasing equity (best move first) */
@@ -1075,7 +1112,7 @@ check_sds(int *active)
         prc = &ro_apes[alt]->rc;
         for (ioutput = OUTPUT_EQUITY; ioutput < NUM_ROLLOUT_OUTPUTS; ioutput++) {
             if (ioutput == OUTPUT_EQUITY) {     /* cubeless */
-                if (!ms.nMatchTo) {     /* money game */
+                if (!aciLocal[0].nMatchTo) {    /* money game */
                     s = fabsf(aarSigma[alt][ioutput]);
                     if (ro_fCubeRollout) {
                         s *= (float) (aciLocal[alt].nCube / aciLocal[0].nCube);
@@ -1088,7 +1125,7 @@ check_sds(int *active)
                 if (!prc->fCubeful)
                     continue;
                 /* cubeful */
-                if (!ms.nMatchTo) {     /* money game */
+                if (!aciLocal[0].nMatchTo) {    /* money game */
                     s = fabsf(aarSigma[alt][ioutput]);
                 } else {
                     s = fabsf(se_mwc2eq(aarSigma[alt][ioutput], &aciLocal[(ro_fCubeRollout ? 0 : alt)]));
@@ -1116,153 +1153,432 @@ check_sds(int *active)
 
 }
 
-extern void
-RolloutLoopMT(void *UNUSED(unused))
+/* Trial allocation. By default every active alternative gets a trial
+ * in each cycle. With "set rollout allocation lucb", once every active
+ * move has had its minimum number of games, a cycle only plays the move
+ * with the best equity and the other move with the highest upper
+ * confidence bound (LUCB): they are the pair that decides whether the
+ * best move is known yet. Moves that are clearly worse are still dropped
+ * by the J.S.D. rule; they are simply not played while they wait. */
+int fRolloutLUCB = FALSE;
+
+/* The shared results of a rollout have a lock of their own, so that
+ * merging them does not wait for unrelated users of MT_Exclusive(). */
+
+#if defined(USE_MULTITHREAD)
+static Mutex roLock;
+
+static void
+RolloutLockInit(void)
+{
+    static int fInit = FALSE;
+
+    if (!fInit) {
+        InitMutex(&roLock);
+        fInit = TRUE;
+    }
+}
+
+#define RolloutLock() Mutex_Lock(&roLock)
+#define RolloutRelease() Mutex_Release(&roLock)
+#else
+#define RolloutLockInit()
+#define RolloutLock()
+#define RolloutRelease()
+#endif
+
+/* must be called with roLock held */
+static void
+AllocateTrials(void)
+{
+    int alt, altBest = -1, altChallenger = -1;
+    unsigned int nMinimum = (unsigned int) rcRollout.nMinimumGames;
+    float rBeta = rcRollout.rJsdLimit > 0.0f ? rcRollout.rJsdLimit : 2.0f;
+    float *arEquity, *arBound;
+
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        afAllocate[alt] = TRUE;
+
+    /* cube decisions need equal trials, and standard deviation stops
+     * need every alternative to converge */
+    if (!fRolloutLUCB || ro_fCubeRollout || ro_alternatives < 3 || (rcRollout.fStopOnSTD && !rcRollout.fStopOnJsd))
+        return;
+
+    if (rcRollout.fStopOnJsd && rcRollout.nMinimumJsdGames > nMinimum)
+        nMinimum = (unsigned int) rcRollout.nMinimumJsdGames;
+
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        if (!fNoMore[alt] && altGameCount[alt] < nMinimum)
+            return;
+
+    arEquity = g_alloca(ro_alternatives * sizeof(float));
+    arBound = g_alloca(ro_alternatives * sizeof(float));
+
+    for (alt = 0; alt < ro_alternatives; ++alt) {
+        float s;
+
+        AltEquity(alt, &arEquity[alt], &s);
+        arBound[alt] = arEquity[alt] + rBeta * s;
+
+        if (!fNoMore[alt] && (altBest < 0 || arEquity[alt] > arEquity[altBest]))
+            altBest = alt;
+    }
+
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        if (!fNoMore[alt] && alt != altBest && (altChallenger < 0 || arBound[alt] > arBound[altChallenger]))
+            altChallenger = alt;
+
+    if (altChallenger < 0)
+        return;
+
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        afAllocate[alt] = (alt == altBest || alt == altChallenger);
+}
+
+static void
+AccumulateTrial(rolloutacc * pra, const float ar[NUM_ROLLOUT_OUTPUTS])
 {
-    TanBoard anBoardEval;
-    float aar[NUM_ROLLOUT_OUTPUTS];
-    int active_alternatives;
     unsigned int j;
+
+    pra->n++;
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        double rDelta = ar[j] - pra->arMean[j];
+
+        pra->arMean[j] += rDelta / pra->n;
+        pra->arM2[j] += rDelta * (ar[j] - pra->arMean[j]);
+    }
+}
+
+static void
+CombineAccumulators(rolloutacc * praDest, const rolloutacc * praSrc)
+{
+    unsigned int j;
+    unsigned int n;
+
+    if (praSrc->n == 0)
+        return;
+
+    if (praDest->n == 0) {
+        memcpy(praDest, praSrc, sizeof(rolloutacc));
+        return;
+    }
+
+    n = praDest->n + praSrc->n;
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        double rDelta = praSrc->arMean[j] - praDest->arMean[j];
+
+        praDest->arMean[j] += rDelta * praSrc->n / n;
+        praDest->arM2[j] += praSrc->arM2[j] + rDelta * rDelta * praDest->n * praSrc->n / n;
+    }
+    praDest->n = n;
+}
+
+/* fold the next block of alternative alt into araAcc */
+static void
+FoldBlock(int alt, float (*aar)[NUM_ROLLOUT_OUTPUTS], int cTrials)
+{
+    rolloutacc raBlock;
+    int i;
+
+    memset(&raBlock, 0, sizeof(raBlock));
+    for (i = 0; i < cTrials; i++)
+        AccumulateTrial(&raBlock, aar[i]);
+    CombineAccumulators(&araAcc[alt], &raBlock);
+}
+
+/* copy the merged accumulator of an alternative to the arrays used
+ * for stopping rules, progress reports and the final results */
+static void
+PublishAccumulator(int alt)
+{
+    const rolloutacc *pra = &araAcc[alt];
+    unsigned int j;
+
+    altGameCount[alt] = pra->n;
+
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        float rVariance = pra->n > 1 ? (float) (pra->arM2[j] / (pra->n - 1)) : 0.0f;
+
+        aarMu[alt][j] = (float) pra->arMean[j];
+
+        if (j < OUTPUT_EQUITY) {
+            if (aarMu[alt][j] < 0.0f)
+                aarMu[alt][j] = 0.0f;
+            else if (aarMu[alt][j] > 1.0f)
+                aarMu[alt][j] = 1.0f;
+        }
+
+        aarSigma[alt][j] = pra->n ? sqrtf(rVariance / (float) pra->n) : 0.0f;
+    }
+}
+
+static gint
+ComparePendingBlocks(gconstpointer a, gconstpointer b)
+{
+    return GPOINTER_TO_INT(a) - GPOINTER_TO_INT(b);
+}
+
+/* Hand in the blocks a thread has played since its last merge, and
+ * fold those that now continue the merged results of their alternative
+ * without a gap.  Only blocks that arrive ahead of their turn are kept
+ * aside.  Must be called with roLock held. */
+static void
+MergeThreadResults(const rolloutblock * arb, unsigned int cBlocks)
+{
+    unsigned int *anBefore = g_alloca(ro_alternatives * sizeof(unsigned int));
+    unsigned int i;
     int alt;
-    FILE *logfp = NULL;
-    rolloutcontext *prc = NULL;
-    /* Each thread gets a copy of the rngctxRollout */
-    rngcontext *rngctxMTRollout = CopyRNGContext(rngctxRollout);
-    perArray dicePerms;
-    dicePerms.nPermutationSeed = -1;
 
-    /* ============ begin rollout loop ============= */
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        anBefore[alt] = araAcc[alt].n;
 
-    while (MT_SafeIncValue(&ro_NextTrial) <= cGames) {
-        active_alternatives = ro_alternatives;
+    for (i = 0; i < cBlocks; i++) {
+        alt = arb[i].alt;
 
-        for (alt = 0; alt < ro_alternatives; ++alt) {
-            int trial = MT_SafeIncValue(&altTrialCount[alt]) - 1;
-            /* skip this one if it's already finished */
-            if (fNoMore[alt] || (trial > cGames)) {
-                MT_SafeDec(&altTrialCount[alt]);
-                continue;
-            }
+        if (arb[i].first == (int) araAcc[alt].n)
+            CombineAccumulators(&araAcc[alt], &arb[i].ra);
+        else {
+            rolloutblock *prb = g_new(rolloutblock, 1);
 
+            memcpy(prb, &arb[i], sizeof(rolloutblock));
+            g_hash_table_insert(aphPendingBlocks[alt], GINT_TO_POINTER(prb->first), prb);
+        }
+    }
 
-            prc = &ro_apes[alt]->rc;
+    for (alt = 0; alt < ro_alternatives; ++alt) {
+        rolloutcontext *prc = &ro_apes[alt]->rc;
+        const rolloutblock *prb;
 
-            /* get the dice generator set up... */
-            if (prc->fRotate)
-                QuasiRandomSeed(&dicePerms, (int) prc->nSeed);
+        while ((prb = g_hash_table_lookup(aphPendingBlocks[alt], GINT_TO_POINTER(araAcc[alt].n))) != NULL) {
+            int first = prb->first;
 
-            MT_SafeSet(&nSkip, 0);      /* not multi-thread safe do quasi random dice for initial positions */
+            CombineAccumulators(&araAcc[alt], &prb->ra);
+            g_hash_table_remove(aphPendingBlocks[alt], GINT_TO_POINTER(first));
+        }
 
-            /* ... and the RNG */
-            if (prc->rngRollout != RNG_MANUAL)
-                InitRNGSeed((unsigned int) (prc->nSeed + (trial << 8)), prc->rngRollout, rngctxMTRollout);
+        if (araAcc[alt].n == anBefore[alt])
+            continue;
 
-            memcpy(&anBoardEval, ro_apBoard[alt], sizeof(anBoardEval));
+        PublishAccumulator(alt);
 
-            /* roll something out */
-            if (log_rollouts && log_file_name) {
-                char *log_name = g_strdup_printf("%s-%7.7d-%c.sgf", log_file_name, trial, alt + 'a');
-                logfp = log_game_start(log_name, ro_apci[alt], prc->fCubeful, anBoardEval);
-                g_free(log_name);
-            }
-            BasicCubefulRollout(&anBoardEval, &aar, 0, trial, ro_apci[alt],
-                                ro_apCubeDecTop[alt], 1, prc,
-                                ro_aarsStatistics ? ro_aarsStatistics + alt : NULL,
-                                aciLocal[ro_fCubeRollout ? 0 : alt].nCube, &dicePerms, rngctxMTRollout, logfp);
+        /* For normal alternatives nGamesDone and altGameCount will be equal. For cube decisions,
+         * however, the two may differ by the number of threads minus 1. So we cheat a little bit, but
+         * it would be better if the double and nodouble alternatives weren't linked */
+        if (prc->nGamesDone < altGameCount[alt])
+            prc->nGamesDone = altGameCount[alt];
+    }
+}
 
-            if (logfp) {
-                log_game_over(logfp);
-            }
+/* Play one trial of one alternative. The local rollout threads and the
+ * rollout workers (rolloutnet.c) both come through here, so a given
+ * trial has the same outcome wherever it is played. */
+extern int
+RolloutTrial(float aar[NUM_ROLLOUT_OUTPUTS], ConstTanBoard anBoard, const cubeinfo * pci, int *pfCubeDecTop,
+             rolloutcontext * prc, int trial, int nBasisCube, int fInvert, rolloutstat(*paarsStatistics)[2],
+             perArray * dicePerms, rngcontext * rngctx, FILE * logfp)
+{
+    TanBoard anBoardEval;
 
-            if (fInterrupt)
-                break;
+    /* get the dice generator set up... */
+    if (prc->fRotate)
+        QuasiRandomSeed(dicePerms, (int) prc->nSeed);
 
-            multi_debug("exclusive lock: update result for alternative");
-            MT_Exclusive();
-            altGameCount[alt]++;
+    MT_SafeSet(&nSkip, 0);      /* not multi-thread safe do quasi random dice for initial positions */
 
-            if (ro_fInvert)
-                InvertEvaluationR(aar, ro_apci[alt]);
+    /* ... and the RNG */
+    if (prc->rngRollout != RNG_MANUAL)
+        InitRNGSeed((unsigned int) (prc->nSeed + (trial << 8)), prc->rngRollout, rngctx);
 
-            /* apply the results */
-            for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
-                float rMuNew;
+    memcpy(&anBoardEval, anBoard, sizeof(anBoardEval));
 
-                aarResult[alt][j] += aar[j];
-                rMuNew = aarResult[alt][j] / (float) altGameCount[alt];
+    /* roll something out */
+    BasicCubefulRollout(&anBoardEval, (float (*)[NUM_ROLLOUT_OUTPUTS]) aar, 0, trial, pci, pfCubeDecTop, 1, prc,
+                        paarsStatistics, nBasisCube, dicePerms, rngctx, logfp);
 
-                if (altGameCount[alt] > 1) {    /* for i == 0 aarVariance is not defined */
-                    float rDelta = rMuNew - aarMu[alt][j];
+    if (fInterrupt)
+        return -1;
 
-                    aarVariance[alt][j] =
-                        aarVariance[alt][j] * (1.0f - 1.0f / (float) (altGameCount[alt] - 1)) +
-                        (float) (altGameCount[alt]) * rDelta * rDelta;
-                }
+    if (fInvert)
+        InvertEvaluationR(aar, pci);
 
-                aarMu[alt][j] = rMuNew;
+    return 0;
+}
 
-                if (j < OUTPUT_EQUITY) {
-                    if (aarMu[alt][j] < 0.0f)
-                        aarMu[alt][j] = 0.0f;
-                    else if (aarMu[alt][j] > 1.0f)
-                        aarMu[alt][j] = 1.0f;
+/* Take the next block of up to ROLLOUT_BLOCK_TRIALS indices below
+ * cGames from the counter *pn.  Returns the first and sets *pc to the
+ * number taken, or returns -1 when all have been taken.  Indices are
+ * never handed back: the threads' copies of afAllocate differ between
+ * merges, and an index handed back after another thread has taken the
+ * next one would be played twice while leaving a gap. */
+static int
+TakeTrials(int *pn, int *pc)
+{
+    int first;
+
+    do {
+        if ((first = MT_SafeGet(pn)) >= cGames)
+            return -1;
+        *pc = MIN(ROLLOUT_BLOCK_TRIALS, cGames - first);
+    } while (!MT_SafeCompareAndSet(pn, first, first + *pc));
+
+    return first;
+}
+
+extern void
+RolloutLoopMT(void *UNUSED(unused))
+{
+    float aar[NUM_ROLLOUT_OUTPUTS];
+    int active_alternatives;
+    int alt, cRound;
+    unsigned int cPending = 0;
+    FILE *logfp = NULL;
+    /* Each thread gets a copy of the rngctxRollout */
+    rngcontext *rngctxMTRollout = CopyRNGContext(rngctxRollout);
+    /* ... and keeps its blocks, merged every nRolloutMergeInterval cycles */
+    rolloutblock *arb = g_new(rolloutblock, MAX(nRolloutMergeInterval, 1) * (unsigned int) ro_alternatives);
+    unsigned int cBlocks = 0;
+    /* ... and a copy of afAllocate, taken under the lock where it is written */
+    int *afAllocated = g_new(int, ro_alternatives);
+    perArray dicePerms;
+    dicePerms.nPermutationSeed = -1;
+
+    RolloutLock();
+    memcpy(afAllocated, afAllocate, ro_alternatives * sizeof(int));
+    RolloutRelease();
+
+    /* ============ begin rollout loop ============= */
+
+    while (TakeTrials(&ro_NextTrial.n, &cRound) >= 0) {
+        active_alternatives = ro_alternatives;
+
+        for (alt = 0; alt < ro_alternatives; ++alt) {
+            rolloutcontext *prc = &ro_apes[alt]->rc;
+            rolloutblock *prb = &arb[cBlocks];
+            int trial, cTrials, n = 0;
+
+            /* skip this one if it's already finished or not allocated a trial */
+            if (fNoMore[alt] || !afAllocated[alt] || (prb->first = TakeTrials(&altTrialCount[alt].n, &cTrials)) < 0)
+                continue;
+
+            prb->alt = alt;
+            memset(&prb->ra, 0, sizeof(rolloutacc));
+            cBlocks++;
+
+            for (trial = prb->first; trial < prb->first + cTrials; trial++) {
+                if (log_rollouts && log_file_name) {
+                    char *log_name = g_strdup_printf("%s-%7.7d-%c.sgf", log_file_name, trial, alt + 'a');
+                    TanBoard anBoardLog;
+
+                    memcpy(&anBoardLog, ro_apBoard[alt], sizeof(anBoardLog));
+                    logfp = log_game_start(log_name, ro_apci[alt], prc->fCubeful, anBoardLog);
+                    g_free(log_name);
                 }
 
-                aarSigma[alt][j] = sqrtf(aarVariance[alt][j] / (float) altGameCount[alt]);
-            }                   /* for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++ ) */
+                n = RolloutTrial(aar, ro_apBoard[alt], ro_apci[alt], ro_apCubeDecTop[alt], prc, trial,
+                                 aciLocal[ro_fCubeRollout ? 0 : alt].nCube, ro_fInvert,
+                                 ro_aarsStatistics ? ro_aarsStatistics + alt : NULL, &dicePerms, rngctxMTRollout, logfp);
 
-            /* For normal alternatives nGamesDone and altGameCount will be equal. For cube decisions,
-             * however, the two may differ by the number of threads minus 1. So we cheat a little bit, but
-             * it would be better if the double and nodouble alternatives weren't linked */
-            if (prc->nGamesDone < altGameCount[alt])
-                prc->nGamesDone = altGameCount[alt];
+                if (logfp) {
+                    log_game_over(logfp);
+                }
 
-            MT_Release();
-            multi_debug("exclusive release: update result for alternative");
+                if (n < 0)
+                    break;
+
+                AccumulateTrial(&prb->ra, aar);
+            }
 
+            if (n < 0)
+                break;
         }                       /* for (alt = 0; alt < ro_alternatives; ++alt) */
 
         if (fInterrupt)
             break;
 
-        /* we've rolled everything out for this trial, check stopping conditions */
-        /* Stop rolling out moves whose Equity is more than a user selected multiple of the joint standard
-         * deviation of the equity difference with the best move in the list. */
-
 #if !defined(USE_MULTITHREAD)
         ProcessEvents();
 #endif
 
-        multi_debug("exclusive lock: rollout cycle update");
-        MT_Exclusive();
+        if (++cPending < nRolloutMergeInterval)
+            continue;
+        cPending = 0;
+
+        /* fold this thread's trials into the shared results, then check stopping conditions
+         * on the merged figures */
+        /* Stop rolling out moves whose Equity is more than a user selected multiple of the joint standard
+         * deviation of the equity difference with the best move in the list. */
+
+        multi_debug("rollout lock: rollout cycle update");
+        RolloutLock();
+        MergeThreadResults(arb, cBlocks);
+        cBlocks = 0;
         if (show_jsds) {
             check_jsds(&active_alternatives);
         }
         if (rcRollout.fStopOnSTD) {
             check_sds(&active_alternatives);
         }
+        AllocateTrials();
+        memcpy(afAllocated, afAllocate, ro_alternatives * sizeof(int));
         if ((active_alternatives < 2 && rcRollout.fStopOnJsd) || active_alternatives < 1) {
-            multi_debug("exclusive release: rollout done early");
-            MT_Release();
+            multi_debug("rollout release: rollout done early");
+            RolloutRelease();
             break;
         }
-        multi_debug("exclusive release: rollout cycle update");
-        MT_Release();
+        multi_debug("rollout release: rollout cycle update");
+        RolloutRelease();
     }
+
+    /* trials finished since the last merge */
+    multi_debug("rollout lock: rollout final merge");
+    RolloutLock();
+    MergeThreadResults(arb, cBlocks);
+    RolloutRelease();
+    multi_debug("rollout release: rollout final merge");
+
+    g_free(afAllocated);
+    g_free(arb);
     g_free(rngctxMTRollout);
 }
 
+/* Once the rollout threads are done, fold what is left in trial order.
+ * Only an interrupted rollout leaves gaps; the blocks after them are
+ * kept rather than lost. */
+static void
+MergePendingBlocks(void)
+{
+    int alt;
+
+    for (alt = 0; alt < ro_alternatives; ++alt) {
+        rolloutcontext *prc = &ro_apes[alt]->rc;
+        GList *plBlocks = g_list_sort(g_hash_table_get_keys(aphPendingBlocks[alt]), ComparePendingBlocks);
+        GList *pl;
+
+        for (pl = plBlocks; pl; pl = pl->next) {
+            const rolloutblock *prb = g_hash_table_lookup(aphPendingBlocks[alt], pl->data);
+
+            CombineAccumulators(&araAcc[alt], &prb->ra);
+        }
+        g_list_free(plBlocks);
+        g_hash_table_remove_all(aphPendingBlocks[alt]);
+
+        PublishAccumulator(alt);
+        if (prc->nGamesDone < altGameCount[alt])
+            prc->nGamesDone = altGameCount[alt];
+    }
+}
+
 static rolloutprogressfunc *ro_pfProgress;
 static void *ro_pUserData;
 
 static gboolean
 UpdateProgress(gpointer UNUSED(unused))
 {
-    if (fShowProgress && ro_alternatives > 0) {
+    if (fShowProgress && ro_pfProgress && ro_alternatives > 0) {
         int alt;
 
-        multi_debug("exclusive lock: update progress");
-        MT_Exclusive();
+        multi_debug("rollout lock: update progress");
+        RolloutLock();
 
         for (alt = 0; alt < ro_alternatives; ++alt) {
             rolloutcontext *prc = &ro_apes[alt]->rc;
@@ -1272,12 +1588,351 @@ UpdateProgress(gpointer UNUSED(unused))
                               ro_pUserData);
         }
 
-        MT_Release();
-        multi_debug("exclusive release: update progress");
+        RolloutRelease();
+        multi_debug("rollout release: update progress");
     }
     return TRUE;
 }
 
+/* Distributed and checkpointed rollouts: rollouts are cut into batches
+ * of consecutive trials of one alternative, which rolloutnet.c plays on
+ * the rollout workers or the local threads. Completed batches come back
+ * here and are folded into araAcc strictly in trial order, so the
+ * outcome does not depend on who played which trials, and the merged
+ * state can be saved and resumed at any point. */
+static GList *plPendingBatches;
+static double rLastProgress;
+
+char *szRolloutCheckpoint = NULL;
+unsigned int nRolloutCheckpointInterval = 300;
+
+#define CHECKPOINT_MAGIC "GNU Backgammon rollout checkpoint"
+
+typedef struct {
+    char szMagic[40];
+    char szWeights[16];
+    int anSize[4];
+    int alternatives;
+    int fInvert;
+    int fCubeRollout;
+    int fStatistics;
+    int fOutputMWC;
+    rolloutcontext rc;          /* rcRollout when the rollout was started */
+} checkpointheader;
+
+typedef struct {
+    TanBoard anBoard;
+    cubeinfo ci;
+    evalsetup es;
+    int fCubeDecTop;
+    int fNoMore;
+    rolloutacc ra;
+    jsdinfo ji;
+    rolloutstat ars[2];
+} checkpointalt;
+
+static rolloutcontext rcCheckpoint;
+static const char *ro_szCheckpoint;
+static const char *szCheckpointResume;
+static const checkpointalt *ro_pcaResume;
+static double rLastCheckpoint;
+
+/* a rollout played in slices stops again after ro_nSlice trials */
+static unsigned int ro_nSlice;
+static unsigned int ro_nPlayed;
+static int ro_fSuspended;
+
+static void
+CheckpointHeader(checkpointheader * pch)
+{
+    memset(pch, 0, sizeof(checkpointheader));
+    g_strlcpy(pch->szMagic, CHECKPOINT_MAGIC, sizeof(pch->szMagic));
+    g_strlcpy(pch->szWeights, WEIGHTS_VERSION, sizeof(pch->szWeights));
+    pch->anSize[0] = (int) sizeof(checkpointheader);
+    pch->anSize[1] = (int) sizeof(checkpointalt);
+    pch->anSize[2] = (int) sizeof(rolloutcontext);
+    pch->anSize[3] = (int) sizeof(evalsetup);
+}
+
+static int
+WriteCheckpointFile(const char *szFile, const checkpointheader * pch, const checkpointalt * aca)
+{
+    char *szTemp = g_strconcat(szFile, ".tmp", NULL);
+    FILE *pf;
+    int f;
+
+    if (!(pf = g_fopen(szTemp, "wb"))) {
+        outputerr(szTemp);
+        g_free(szTemp);
+        return -1;
+    }
+
+    f = (fwrite(pch, sizeof(checkpointheader), 1, pf) == 1)
+        && (fwrite(aca, sizeof(checkpointalt), pch->alternatives, pf) == (size_t) pch->alternatives);
+
+    if (fclose(pf) || !f || g_rename(szTemp, szFile)) {
+        outputerr(szFile);
+        g_unlink(szTemp);
+        f = FALSE;
+    }
+
+    g_free(szTemp);
+
+    return f ? 0 : -1;
+}
+
+/* save the merged state; trials still being played are not included
+ * and will be played again after a resume */
+static void
+WriteCheckpoint(void)
+{
+    checkpointheader ch;
+    checkpointalt *aca = g_new0(checkpointalt, ro_alternatives);
+    int alt;
+
+    CheckpointHeader(&ch);
+    ch.alternatives = ro_alternatives;
+    ch.fInvert = ro_fInvert;
+    ch.fCubeRollout = ro_fCubeRollout;
+    ch.fStatistics = (ro_aarsStatistics != NULL);
+    ch.fOutputMWC = fOutputMWC;
+    memcpy(&ch.rc, &rcCheckpoint, sizeof(rolloutcontext));
+
+    for (alt = 0; alt < ro_alternatives; ++alt) {
+        checkpointalt *pca = &aca[alt];
+
+        memcpy(pca->anBoard, ro_apBoard[alt], sizeof(TanBoard));
+        memcpy(&pca->ci, ro_apci[alt], sizeof(cubeinfo));
+        memcpy(&pca->es, ro_apes[alt], sizeof(evalsetup));
+        pca->fCubeDecTop = ro_apCubeDecTop[alt][0];
+        pca->fNoMore = fNoMore[alt];
+        memcpy(&pca->ra, &araAcc[alt], sizeof(rolloutacc));
+        memcpy(&pca->ji, &ajiJSD[alt], sizeof(jsdinfo));
+        if (ro_aarsStatistics)
+            memcpy(pca->ars, ro_aarsStatistics[alt], sizeof(pca->ars));
+    }
+
+    WriteCheckpointFile(ro_szCheckpoint, &ch, aca);
+
+    g_free(aca);
+}
+
+/* write the checkpoint of a rollout that has not been started yet, so
+ * that it can be played later with RolloutResume() */
+extern int
+RolloutCheckpointNew(const char *szFile, ConstTanBoard * apBoard, const cubeinfo aci[], const int afCubeDecTop[],
+                     int alternatives, int fInvert, int fCubeRollout, const rolloutcontext * prc)
+{
+    checkpointheader ch;
+    checkpointalt *aca = g_new0(checkpointalt, alternatives);
+    int alt, n;
+
+    CheckpointHeader(&ch);
+    ch.alternatives = alternatives;
+    ch.fInvert = fInvert;
+    ch.fCubeRollout = fCubeRollout;
+    ch.fStatistics = fCubeRollout;
+    ch.fOutputMWC = fOutputMWC && aci[0].nMatchTo;
+    memcpy(&ch.rc, prc, sizeof(rolloutcontext));
+
+    for (alt = 0; alt < alternatives; ++alt) {
+        memcpy(aca[alt].anBoard, apBoard[alt], sizeof(TanBoard));
+        memcpy(&aca[alt].ci, &aci[alt], sizeof(cubeinfo));
+        aca[alt].es.et = EVAL_NONE;
+        memcpy(&aca[alt].es.rc, prc, sizeof(rolloutcontext));
+        aca[alt].es.rc.nGamesDone = 0;
+        aca[alt].fCubeDecTop = afCubeDecTop[alt];
+        aca[alt].ji.nOrder = alt;
+    }
+
+    n = WriteCheckpointFile(szFile, &ch, aca);
+
+    g_free(aca);
+
+    return n;
+}
+
+static rolloutbatch *
+NextBatch(int nMaxTrials)
+{
+    int alt, altNext = -1;
+    rolloutbatch *prb;
+
+    /* the alternative that is furthest behind goes first */
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        if (!fNoMore[alt] && afAllocate[alt] && altTrialCount[alt].n < cGames
+            && (altNext < 0 || altTrialCount[alt].n < altTrialCount[altNext].n))
+            altNext = alt;
+
+    if (altNext < 0)
+        return NULL;
+
+    /* whole blocks, so that they are merged as the rollout threads do */
+    nMaxTrials = MAX(nMaxTrials - nMaxTrials % ROLLOUT_BLOCK_TRIALS, ROLLOUT_BLOCK_TRIALS);
+    prb = RolloutBatchNew(altNext, altTrialCount[altNext].n, MIN(nMaxTrials, cGames - altTrialCount[altNext].n));
+    altTrialCount[altNext].n += prb->count;
+
+    return prb;
+}
+
+static gint
+CompareBatches(gconstpointer a, gconstpointer b)
+{
+    const rolloutbatch *prbA = a;
+    const rolloutbatch *prbB = b;
+
+    if (prbA->alt != prbB->alt)
+        return prbA->alt - prbB->alt;
+
+    return prbA->first - prbB->first;
+}
+
+static void
+AddRolloutstat(rolloutstat * prsDest, const rolloutstat * prsSrc)
+{
+    /* rolloutstat is nothing but int counters */
+    int *pnDest = (int *) prsDest;
+    const int *pnSrc = (const int *) prsSrc;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(rolloutstat) / sizeof(int); i++)
+        pnDest[i] += pnSrc[i];
+}
+
+static int
+BatchDone(rolloutbatch * prb)
+{
+    int active_alternatives = ro_alternatives;
+    int alt = prb->alt;
+    rolloutcontext *prc = &ro_apes[alt]->rc;
+    GList *pl, *plNext;
+
+    ro_nPlayed += (unsigned int) prb->count;
+    plPendingBatches = g_list_insert_sorted(plPendingBatches, prb, CompareBatches);
+
+    for (pl = plPendingBatches; pl; pl = plNext) {
+        rolloutbatch *prbMerge = pl->data;
+        int i;
+
+        plNext = pl->next;
+
+        if (prbMerge->alt != alt || prbMerge->first != (int) araAcc[alt].n)
+            continue;
+
+        /* the same arithmetic as the local threads */
+        for (i = 0; i < prbMerge->count; i += ROLLOUT_BLOCK_TRIALS)
+            FoldBlock(alt, prbMerge->aarOutput + i, MIN(ROLLOUT_BLOCK_TRIALS, prbMerge->count - i));
+
+        if (ro_aarsStatistics) {
+            AddRolloutstat(&ro_aarsStatistics[alt][0], &prbMerge->aarsStatistics[0]);
+            AddRolloutstat(&ro_aarsStatistics[alt][1], &prbMerge->aarsStatistics[1]);
+        }
+
+        plPendingBatches = g_list_delete_link(plPendingBatches, pl);
+        RolloutBatchFree(prbMerge);
+    }
+
+    PublishAccumulator(alt);
+    if (prc->nGamesDone < altGameCount[alt])
+        prc->nGamesDone = altGameCount[alt];
+
+    if (show_jsds) {
+        check_jsds(&active_alternatives);
+    }
+    if (rcRollout.fStopOnSTD) {
+        check_sds(&active_alternatives);
+    }
+    AllocateTrials();
+
+    if (get_time() - rLastProgress >= 2000.0) {
+        UpdateProgress(NULL);
+        rLastProgress = get_time();
+    }
+
+    if (ro_szCheckpoint && get_time() - rLastCheckpoint >= nRolloutCheckpointInterval * 1000.0) {
+        WriteCheckpoint();
+        rLastCheckpoint = get_time();
+    }
+
+    if ((active_alternatives < 2 && rcRollout.fStopOnJsd) || active_alternatives < 1)
+        return FALSE;
+
+    /* not finished, but this slice is used up */
+    if (ro_nSlice && ro_nPlayed >= ro_nSlice) {
+        ro_fSuspended = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* returns -1 if the rollout has to be played by RolloutLoopMT instead */
+static int
+RolloutBatched(void)
+{
+    rolloutjob rj;
+    int alt;
+    int n = -1;
+
+    if (log_rollouts || (!szRolloutWorkers && !ro_szCheckpoint))
+        return -1;
+
+    /* trials can only be replayed elsewhere or later from a seeded generator */
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        switch (ro_apes[alt]->rc.rngRollout) {
+        case RNG_MANUAL:
+        case RNG_RANDOM_DOT_ORG:
+        case RNG_FILE:
+            if (ro_szCheckpoint)
+                outputl(_("Rollouts with this random number generator cannot be checkpointed."));
+            return -1;
+        default:
+            break;
+        }
+
+    rj.alternatives = ro_alternatives;
+    rj.fInvert = ro_fInvert;
+    rj.fStatistics = (ro_aarsStatistics != NULL);
+    rj.aanBoard = g_new(TanBoard, ro_alternatives);
+    rj.aci = g_new(cubeinfo, ro_alternatives);
+    rj.afCubeDecTop = g_new(int, ro_alternatives);
+    rj.anBasisCube = g_new(int, ro_alternatives);
+    rj.arc = g_new(rolloutcontext, ro_alternatives);
+
+    for (alt = 0; alt < ro_alternatives; ++alt) {
+        memcpy(rj.aanBoard[alt], ro_apBoard[alt], sizeof(TanBoard));
+        memcpy(&rj.aci[alt], ro_apci[alt], sizeof(cubeinfo));
+        rj.afCubeDecTop[alt] = ro_apCubeDecTop[alt][0];
+        rj.anBasisCube[alt] = aciLocal[ro_fCubeRollout ? 0 : alt].nCube;
+        memcpy(&rj.arc[alt], &ro_apes[alt]->rc, sizeof(rolloutcontext));
+    }
+
+    rLastProgress = rLastCheckpoint = get_time();
+
+    if (szRolloutWorkers)
+        n = RolloutCoordinate(&rj, NextBatch, BatchDone);
+
+    if (n < 0 && ro_szCheckpoint) {
+        RolloutPlayLocal(&rj, NextBatch, BatchDone);
+        n = 0;
+    }
+
+    /* whether finished or interrupted */
+    if (n == 0 && ro_szCheckpoint)
+        WriteCheckpoint();
+
+    g_list_free_full(plPendingBatches, (GDestroyNotify) RolloutBatchFree);
+    plPendingBatches = NULL;
+
+    g_free(rj.aanBoard);
+    g_free(rj.aci);
+    g_free(rj.afCubeDecTop);
+    g_free(rj.anBasisCube);
+    g_free(rj.arc);
+
+    return n;
+}
+
 extern int
 RolloutGeneral(ConstTanBoard * apBoard,
                float (*apOutput[])[NUM_ROLLOUT_OUTPUTS],
@@ -1302,24 +1957,29 @@ RolloutGeneral(ConstTanBoard * apBoard,
     int previous_rollouts = 0;
 
     show_jsds = 1;
+    RolloutLockInit();
 
     if (alternatives < 1) {
         errno = EINVAL;
         return -1;
     }
 
+    memcpy(&rcCheckpoint, &rcRollout, sizeof(rcRollout));
+    ro_szCheckpoint = szCheckpointResume ? szCheckpointResume : szRolloutCheckpoint;
+
     ajiJSD = g_alloca(alternatives * sizeof(jsdinfo));
     fNoMore = g_alloca(alternatives * sizeof(int));
     aciLocal = g_alloca(alternatives * sizeof(cubeinfo));
     altGameCount = g_alloca(alternatives * sizeof(int));
-    altTrialCount = g_alloca(alternatives * sizeof(int));
+    altTrialCount = g_alloca(alternatives * sizeof(mtcounter));
 
     aarMu = g_alloca(alternatives * NUM_ROLLOUT_OUTPUTS * sizeof(float));
     aarSigma = g_alloca(alternatives * NUM_ROLLOUT_OUTPUTS * sizeof(float));
-    aarResult = g_alloca(alternatives * NUM_ROLLOUT_OUTPUTS * sizeof(float));
-    aarVariance = g_alloca(alternatives * NUM_ROLLOUT_OUTPUTS * sizeof(float));
+    araAcc = g_alloca(alternatives * sizeof(rolloutacc));
+    aphPendingBlocks = g_alloca(alternatives * sizeof(GHashTable *));
+    afAllocate = g_alloca(alternatives * sizeof(int));
 
-    if (ms.nMatchTo == 0)
+    if (apci[0]->nMatchTo == 0)
         fOutputMWC = 0;
 
     memcpy(&rcRolloutSave, &rcRollout, sizeof(rcRollout));
@@ -1375,7 +2035,7 @@ RolloutGeneral(ConstTanBoard * apBoard,
             prc->nGamesDone = 0;
             prc->nSkip = 0;
             nFirstTrial = 0;
-            altTrialCount[alt] = altGameCount[alt] = 0;
+            altTrialCount[alt].n = altGameCount[alt] = 0;
 
             if (aarsStatistics) {
                 initRolloutstat(&aarsStatistics[alt][0]);
@@ -1383,8 +2043,9 @@ RolloutGeneral(ConstTanBoard * apBoard,
             }
 
             /* initialise internal variables */
+            memset(&araAcc[alt], 0, sizeof(rolloutacc));
             for (j = 0; j < NUM_ROLLOUT_OUTPUTS; ++j) {
-                aarResult[alt][j] = aarVariance[alt][j] = aarMu[alt][j] = aarSigma[alt][j] = 0.0f;
+                aarMu[alt][j] = aarSigma[alt][j] = 0.0f;
             }
         } else {
             int nGames = prc->nGamesDone;
@@ -1398,18 +2059,19 @@ RolloutGeneral(ConstTanBoard * apBoard,
                 prc->aecCube[i].fCubeful = prc->aecChequer[i].fCubeful =
                     prc->aecCubeLate[i].fCubeful = prc->aecChequerLate[i].fCubeful = (prc->fCubeful || fCubeRollout);
 
-            altTrialCount[alt] = altGameCount[alt] = nGames;
+            altTrialCount[alt].n = altGameCount[alt] = nGames;
             initial_game_count += nGames;
             if (nGames < nFirstTrial)
                 nFirstTrial = nGames;
             /* restore internal variables from input values */
+            araAcc[alt].n = nGames;
             for (j = 0; j < NUM_ROLLOUT_OUTPUTS; ++j) {
-                float r;
+                double r;
 
                 r = aarMu[alt][j] = (*apOutput[alt])[j];
-                aarResult[alt][j] = r * (float) nGames;
+                araAcc[alt].arMean[j] = r;
                 r = aarSigma[alt][j] = (*apStdDev[alt])[j];
-                aarVariance[alt][j] = r * r * (float) nGames;
+                araAcc[alt].arM2[j] = r * r * nGames * (nGames > 0 ? nGames - 1 : 0);
             }
         }
 
@@ -1448,12 +2110,29 @@ RolloutGeneral(ConstTanBoard * apBoard,
     ro_aarsStatistics = aarsStatistics;
     ro_fCubeRollout = fCubeRollout;
     ro_fInvert = fInvert;
-    ro_NextTrial = nFirstTrial;
+    ro_NextTrial.n = nFirstTrial;
     ro_pfProgress = pfProgress;
     ro_pUserData = pUserData;
 
+    for (alt = 0; alt < alternatives; ++alt)
+        afAllocate[alt] = TRUE;
+
     active_alternatives = ro_alternatives;
 
+    if (ro_pcaResume) {
+        /* carry on exactly where the checkpoint left off */
+        for (alt = 0; alt < alternatives; ++alt) {
+            memcpy(&araAcc[alt], &ro_pcaResume[alt].ra, sizeof(rolloutacc));
+            altTrialCount[alt].n = (int) araAcc[alt].n;
+            fNoMore[alt] = ro_pcaResume[alt].fNoMore;
+            memcpy(&ajiJSD[alt], &ro_pcaResume[alt].ji, sizeof(jsdinfo));
+            if (aarsStatistics)
+                memcpy(aarsStatistics[alt], ro_pcaResume[alt].ars, sizeof(ro_pcaResume[alt].ars));
+            PublishAccumulator(alt);
+        }
+        previous_rollouts = 0;
+    }
+
     /* check if rollout alternatives are done, but only when extending
      * all candidates */
     if (previous_rollouts == active_alternatives) {
@@ -1468,24 +2147,51 @@ RolloutGeneral(ConstTanBoard * apBoard,
     UpdateProgress(NULL);
 
     if (active_alternatives > 1 || (!rcRollout.fStopOnJsd && active_alternatives > 0)) {
-        multi_debug("rollout adding tasks");
-        mt_add_tasks(MT_GetNumThreads(), RolloutLoopMT, NULL, NULL);
+        if (RolloutBatched() < 0) {
+            mtgroup *pg = MT_GroupNew(MT_PRIORITY_ROLLOUT);
+
+            for (alt = 0; alt < alternatives; ++alt)
+                aphPendingBlocks[alt] = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+            multi_debug("rollout adding tasks");
+            mt_group_add_tasks(pg, MT_GetNumThreads(), RolloutLoopMT, NULL, NULL);
+
+            multi_debug("rollout waiting for tasks to complete");
+            MT_GroupWait(pg, UpdateProgress, 2000, fAutoSaveRollout);
+            multi_debug("rollout finished waiting for tasks to complete");
+            MT_GroupFree(pg);
 
-        multi_debug("rollout waiting for tasks to complete");
-        MT_WaitForTasks(UpdateProgress, 2000, fAutoSaveRollout);
-        multi_debug("rollout finished waiting for tasks to complete");
+            MergePendingBlocks();
+            for (alt = 0; alt < alternatives; ++alt)
+                g_hash_table_destroy(aphPendingBlocks[alt]);
+        }
     }
 
     /* Make sure final output is up to date */
 #if defined(USE_GTK)
     if (!fX)
 #endif
-        if (!fInterrupt)
+        if (!fInterrupt && !ro_nSlice)
             outputf(_("\nRollout done. Printing final results.\n"));
 
     if (!fInterrupt)
         UpdateProgress(NULL);
 
+    /* show where the trials went */
+#if defined(USE_GTK)
+    if (!fX)
+#endif
+        if (fRolloutLUCB && !fInterrupt && !ro_nSlice && !fCubeRollout && alternatives > 2) {
+            unsigned int nTotal = 0;
+
+            outputf("%s", _("Trials per alternative:"));
+            for (alt = 0; alt < alternatives; ++alt) {
+                outputf(" %u", altGameCount[alt]);
+                nTotal += altGameCount[alt];
+            }
+            outputf(_(" (%u in total)\n"), nTotal);
+        }
+
     /* Signal to UpdateProgress() called from pending events that no
      * more progress should be displayed.
      */
@@ -1529,6 +2235,188 @@ RolloutGeneral(ConstTanBoard * apBoard,
     return trialsDone;
 }
 
+/* Carry on with the rollout checkpointed in szFile, for at most about
+ * nSlice more trials if nSlice is not 0. The alternatives are labelled
+ * with aszLabel, or their position IDs if it is NULL, in the results
+ * returned in *pszResult. Returns -1 on error, 1 if the rollout was
+ * suspended or interrupted and 0 when it is complete. */
+extern int
+RolloutResume(const char *szFile, unsigned int nSlice, const char **aszLabel, char **pszResult,
+              unsigned int *pnPlayed)
+{
+    checkpointheader ch, chExpected;
+    checkpointalt *aca;
+    FILE *pf;
+    int alternatives, alt;
+    int f, n;
+    rolloutcontext rcSave;
+    int fOutputMWCSave = fOutputMWC;
+    void *p = NULL;
+    ConstTanBoard *apBoard;
+    float (*aarOutput)[NUM_ROLLOUT_OUTPUTS];
+    float (*aarStdDev)[NUM_ROLLOUT_OUTPUTS];
+    float (**apOutput)[NUM_ROLLOUT_OUTPUTS];
+    float (**apStdDev)[NUM_ROLLOUT_OUTPUTS];
+    rolloutstat(*aarsStatistics)[2] = NULL;
+    evalsetup **apes;
+    cubeinfo *aci;
+    const cubeinfo **apci;
+    int *afCubeDecTop;
+    int **apCubeDecTop;
+    char (*asz)[FORMATEDMOVESIZE];
+
+    if (pszResult)
+        *pszResult = NULL;
+    if (pnPlayed)
+        *pnPlayed = 0;
+
+    if (!(pf = g_fopen(szFile, "rb"))) {
+        outputerr(szFile);
+        return -1;
+    }
+
+    CheckpointHeader(&chExpected);
+    f = (fread(&ch, sizeof(ch), 1, pf) == 1)
+        && !memcmp(ch.szMagic, chExpected.szMagic, sizeof(ch.szMagic))
+        && !memcmp(ch.szWeights, chExpected.szWeights, sizeof(ch.szWeights))
+        && !memcmp(ch.anSize, chExpected.anSize, sizeof(ch.anSize))
+        && ch.alternatives > 0 && ch.alternatives <= MAX_MOVES;
+
+    if (!f) {
+        outputerrf(_("%s is not a rollout checkpoint written by this version of GNU Backgammon.\n"), szFile);
+        fclose(pf);
+        return -1;
+    }
+
+    alternatives = ch.alternatives;
+    aca = g_new(checkpointalt, alternatives);
+
+    f = (fread(aca, sizeof(checkpointalt), alternatives, pf) == (size_t) alternatives);
+    fclose(pf);
+
+    if (!f) {
+        outputerrf(_("%s: the rollout checkpoint is truncated.\n"), szFile);
+        g_free(aca);
+        return -1;
+    }
+
+    apBoard = g_new(ConstTanBoard, alternatives);
+    aarOutput = g_malloc0(alternatives * sizeof(*aarOutput));
+    aarStdDev = g_malloc0(alternatives * sizeof(*aarStdDev));
+    apOutput = g_malloc(alternatives * sizeof(*apOutput));
+    apStdDev = g_malloc(alternatives * sizeof(*apStdDev));
+    apes = g_new(evalsetup *, alternatives);
+    aci = g_new(cubeinfo, alternatives);
+    apci = g_new(const cubeinfo *, alternatives);
+    afCubeDecTop = g_new(int, alternatives);
+    apCubeDecTop = g_new(int *, alternatives);
+    asz = g_malloc(alternatives * sizeof(*asz));
+    if (ch.fStatistics)
+        aarsStatistics = g_malloc0(alternatives * sizeof(*aarsStatistics));
+
+    for (alt = 0; alt < alternatives; ++alt) {
+        apBoard[alt] = (ConstTanBoard) aca[alt].anBoard;
+        apOutput[alt] = &aarOutput[alt];
+        apStdDev[alt] = &aarStdDev[alt];
+        apes[alt] = &aca[alt].es;
+        memcpy(&aci[alt], &aca[alt].ci, sizeof(cubeinfo));
+        apci[alt] = &aci[alt];
+        afCubeDecTop[alt] = aca[alt].fCubeDecTop;
+        apCubeDecTop[alt] = &afCubeDecTop[alt];
+
+        if (aszLabel)
+            g_strlcpy(asz[alt], aszLabel[alt], FORMATEDMOVESIZE);
+        else if (ch.fCubeRollout)
+            g_strlcpy(asz[alt], alt ? _("Double, take") : _("No double"), FORMATEDMOVESIZE);
+        else
+            g_strlcpy(asz[alt], PositionID(apBoard[alt]), FORMATEDMOVESIZE);
+    }
+
+    /* roll out with the settings and into the file of the interrupted rollout */
+    memcpy(&rcSave, &rcRollout, sizeof(rcRollout));
+    memcpy(&rcRollout, &ch.rc, sizeof(rcRollout));
+    fOutputMWC = ch.fOutputMWC;
+    ro_pcaResume = aca;
+    szCheckpointResume = szFile;
+    ro_nSlice = nSlice;
+    ro_nPlayed = 0;
+    ro_fSuspended = FALSE;
+
+    /* slices are played quietly */
+    if (!nSlice)
+        RolloutProgressStart(&aci[0], alternatives, aarsStatistics, &rcRollout, asz, FALSE, &p);
+    n = RolloutGeneral(apBoard, apOutput, apStdDev, aarsStatistics, apes, apci, apCubeDecTop, alternatives,
+                       ch.fInvert, ch.fCubeRollout, nSlice ? NULL : RolloutProgress, p);
+    if (!nSlice)
+        RolloutProgressEnd(&p, FALSE);
+
+    if (pnPlayed)
+        *pnPlayed = ro_nPlayed;
+
+    ro_pcaResume = NULL;
+    szCheckpointResume = NULL;
+    ro_nSlice = 0;
+    memcpy(&rcRollout, &rcSave, sizeof(rcRollout));
+    fOutputMWC = fOutputMWCSave;
+
+    if (n > 0 && pszResult) {
+        GString *gsz = g_string_new(NULL);
+
+        for (alt = 0; alt < alternatives; ++alt) {
+            /* the results of moves are for the player who moved */
+            if (ch.fInvert)
+                aci[alt].fMove = !aci[alt].fMove;
+
+            g_string_append(gsz, OutputRolloutResult(NULL, asz + alt, aarOutput + alt, aarStdDev + alt, aci, alt, 1,
+                                                     aca[alt].es.rc.fCubeful));
+        }
+
+        *pszResult = g_string_free(gsz, FALSE);
+    }
+
+    if (fInterrupt || ro_fSuspended)
+        n = 1;
+    else if (n > 0)
+        n = 0;
+
+    g_free(asz);
+    g_free(aarsStatistics);
+    g_free(apCubeDecTop);
+    g_free(afCubeDecTop);
+    g_free(apci);
+    g_free(aci);
+    g_free(apes);
+    g_free(apStdDev);
+    g_free(apOutput);
+    g_free(aarStdDev);
+    g_free(aarOutput);
+    g_free(apBoard);
+    g_free(aca);
+
+    return n;
+}
+
+extern void
+CommandRolloutResume(char *sz)
+{
+    char *szFile = NextToken(&sz);
+    char *szResult;
+
+    if (!szFile || !*szFile) {
+        outputl(_("You must specify the checkpoint file to resume (see `help rollout resume')."));
+        return;
+    }
+
+    outputf(_("Resuming the rollout checkpointed in %s.\n"), szFile);
+
+    RolloutResume(szFile, 0, NULL, &szResult, NULL);
+
+    if (szResult) {
+        output(szResult);
+        g_free(szResult);
+    }
+}
+
 /*
  * General evaluation functions.
  */
@@ -145,6 +145,16 @@ EXP_LOCK_FUN(int, BasicCubefulRollout, unsigned int aanBoard[][2][25], float aar
              FILE * logfp);
 
 
+extern int RolloutTrial(float aar[NUM_ROLLOUT_OUTPUTS], ConstTanBoard anBoard, const cubeinfo * pci, int *pfCubeDecTop,
+                        rolloutcontext * prc, int trial, int nBasisCube, int fInvert,
+                        rolloutstat(*paarsStatistics)[2], perArray * dicePerms, rngcontext * rngctx, FILE * logfp);
+
+extern int RolloutCheckpointNew(const char *szFile, ConstTanBoard * apBoard, const cubeinfo aci[],
+                                const int afCubeDecTop[], int alternatives, int fInvert, int fCubeRollout,
+                                const rolloutcontext * prc);
+extern int RolloutResume(const char *szFile, unsigned int nSlice, const char **aszLabel, char **pszResult,
+                         unsigned int *pnPlayed);
+
 extern void log_cube(FILE * logfp, const char *action, int side);
 extern void log_move(FILE * logfp, const int *anMove, int side, int die0, int die1);
 extern int RolloutDice(int iTurn, int iGame, int fInitial, unsigned int anDice[2], rng * rngx, void *rngctx,
@@ -0,0 +1,1116 @@
+/*
+ * Copyright (C) 2022 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+/*
+ * Distributed rollouts.
+ *
+ * A gnubg started with "rollout worker [host]:port" waits for a
+ * coordinator; without a host it listens on the loopback interface only. A coordinator ("set rollout workers host:port ...")
+ * connects to its workers, sends them the rollout (boards, cubeinfos
+ * and rollout contexts) once, and then hands out batches of consecutive
+ * trials of one alternative. Each trial is seeded from its index exactly
+ * as in a local rollout, so the workers return precisely the trials the
+ * coordinator would have played itself. A worker that is lost, or that
+ * takes far too long over a batch, is dropped and its batch handed to
+ * another.
+ *
+ * The protocol is line based:
+ *
+ *   coordinator                        worker
+ *   hello <id>                         ok <threads> | error <text>
+ *   job <alternatives> <invert> <stats>
+ *   alt <n> <basis cube> <cube decision top> <board> <cubeinfo> <context>
+ *   ...
+ *   batch <alt> <first> <count>        result <alt> <first> <count> <outputs> <statistics>
+ *
+ * where <id> identifies the protocol, program and weights versions. The
+ * board is sent as a position ID and the cubeinfo and rollout context
+ * field by field as decimal numbers; the worker checks every field
+ * before it uses any of them. Results are sent as hex.
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "backgammon.h"
+#include "matchequity.h"
+#include "matchid.h"
+#include "multithread.h"
+#include "positionid.h"
+#include "rolloutnet.h"
+
+#if HAVE_SOCKETS
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/select.h>
+#if HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+#endif
+
+#include "external.h"
+
+#endif
+
+/* trials per batch for each thread of the worker */
+#define ROLLOUT_NET_TRIALS_PER_THREAD 16
+
+/* upper limit for the number of trials a worker accepts in one batch */
+#define ROLLOUT_NET_MAX_BATCH 65536
+
+/* a batch is given to another worker if it takes longer than this many
+ * seconds and this many times the slowest batch so far */
+#define ROLLOUT_NET_TIMEOUT 600
+#define ROLLOUT_NET_TIMEOUT_FACTOR 10
+
+char *szRolloutWorkers = NULL;
+
+extern rolloutbatch *
+RolloutBatchNew(int alt, int first, int count)
+{
+    rolloutbatch *prb = g_new0(rolloutbatch, 1);
+
+    prb->alt = alt;
+    prb->first = first;
+    prb->count = count;
+    prb->aarOutput = g_malloc0(count * sizeof(*prb->aarOutput));
+
+    return prb;
+}
+
+extern void
+RolloutBatchFree(rolloutbatch * prb)
+{
+    g_free(prb->aarOutput);
+    g_free(prb);
+}
+
+typedef struct {
+    const rolloutjob *prj;
+    rolloutbatch *prb;
+    int iNext;
+} batchtask;
+
+static void
+RunBatchMT(void *p)
+{
+    batchtask *pbt = (batchtask *) p;
+    const rolloutjob *prj = pbt->prj;
+    rolloutbatch *prb = pbt->prb;
+    int alt = prb->alt;
+    int i;
+    rngcontext *rngctx = CopyRNGContext(rngctxRollout);
+    perArray dicePerms;
+
+    dicePerms.nPermutationSeed = -1;
+
+    while ((i = MT_SafeIncValue(&pbt->iNext) - 1) < prb->count)
+        if (RolloutTrial(prb->aarOutput[i], (ConstTanBoard) prj->aanBoard[alt], &prj->aci[alt],
+                         &prj->afCubeDecTop[alt], &prj->arc[alt], prb->first + i, prj->anBasisCube[alt],
+                         prj->fInvert, prj->fStatistics ? &prb->aarsStatistics : NULL, &dicePerms, rngctx,
+                         NULL) < 0) {
+            MT_SetResultFailed();
+            break;
+        }
+
+    g_free(rngctx);
+}
+
+/* play all trials of a batch on the local threads */
+extern int
+RolloutRunBatch(const rolloutjob * prj, rolloutbatch * prb)
+{
+    batchtask bt;
+    mtgroup *pg;
+    int result;
+
+    bt.prj = prj;
+    bt.prb = prb;
+    bt.iNext = 0;
+
+    memset(prb->aarsStatistics, 0, sizeof(prb->aarsStatistics));
+
+    pg = MT_GroupNew(MT_PRIORITY_ROLLOUT);
+    mt_group_add_tasks(pg, MIN(MT_GetNumThreads(), (unsigned int) prb->count), RunBatchMT, &bt, NULL);
+    result = MT_GroupWait(pg, NULL, UI_UPDATETIME, FALSE);
+    MT_GroupFree(pg);
+
+    if (result < 0 || fInterrupt)
+        return -1;
+
+    return 0;
+}
+
+/* play batches on the local threads until pfNext runs dry or pfDone
+ * says stop */
+extern int
+RolloutPlayLocal(const rolloutjob * prj, rolloutnextfunc * pfNext, rolloutdonefunc * pfDone)
+{
+    rolloutbatch *prb;
+
+    while ((prb = pfNext(ROLLOUT_LOCAL_BATCH))) {
+        if (RolloutRunBatch(prj, prb) < 0) {
+            RolloutBatchFree(prb);
+            return -1;
+        }
+        if (!pfDone(prb))
+            break;
+    }
+
+    return 0;
+}
+
+#if HAVE_SOCKETS
+
+typedef struct {
+    int h;
+    GString *pgsIn;             /* received, but not yet split into lines */
+} netconn;
+
+static char *
+HexEncode(const void *pv, size_t cb)
+{
+    static const char achHex[] = "0123456789abcdef";
+    const unsigned char *pch = pv;
+    char *sz = g_malloc(2 * cb + 1);
+    char *pchOut = sz;
+
+    while (cb--) {
+        *pchOut++ = achHex[*pch >> 4];
+        *pchOut++ = achHex[*pch++ & 0x0f];
+    }
+    *pchOut = 0;
+
+    return sz;
+}
+
+static int
+HexDecode(const char *sz, void *pv, size_t cb)
+{
+    unsigned char *pch = pv;
+
+    if (!sz || strlen(sz) != 2 * cb)
+        return -1;
+
+    for (; cb; cb--, sz += 2) {
+        int nHigh = g_ascii_xdigit_value(sz[0]);
+        int nLow = g_ascii_xdigit_value(sz[1]);
+
+        if (nHigh < 0 || nLow < 0)
+            return -1;
+
+        *pch++ = (unsigned char) ((nHigh << 4) | nLow);
+    }
+
+    return 0;
+}
+
+/* everything that has to agree between a coordinator and its workers */
+static char *
+ProtocolID(void)
+{
+    return g_strdup_printf("%d %s %s %d %d", ROLLOUT_NET_PROTOCOL, VERSION, WEIGHTS_VERSION, G_BYTE_ORDER,
+                           (int) sizeof(rolloutstat));
+}
+
+static int
+NetPrintf(int h, const char *szFormat, ...)
+{
+    va_list val;
+    char *sz;
+    int n;
+
+    va_start(val, szFormat);
+    sz = g_strdup_vprintf(szFormat, val);
+    va_end(val);
+
+    n = ExternalWrite(h, sz, strlen(sz));
+    g_free(sz);
+
+    return n;
+}
+
+/* wait up to msTimeout milliseconds for h to become readable */
+static int
+NetWait(int h, int msTimeout)
+{
+    fd_set fds;
+    struct timeval tv;
+
+    FD_ZERO(&fds);
+    FD_SET(h, &fds);
+    tv.tv_sec = msTimeout / 1000;
+    tv.tv_usec = (msTimeout % 1000) * 1000;
+
+    return select(h + 1, &fds, NULL, NULL, &tv);
+}
+
+/* returns the number of bytes received, 0 if the peer closed the connection */
+static int
+NetReceive(netconn * pnc)
+{
+    char ach[4096];
+    int n;
+
+    do
+        n = (int) recv(pnc->h, ach, sizeof(ach), 0);
+    while (n < 0 && errno == EINTR);
+
+    if (n > 0)
+        g_string_append_len(pnc->pgsIn, ach, n);
+
+    return n;
+}
+
+/* the next complete line received, if any */
+static char *
+NetLine(netconn * pnc)
+{
+    char *pch = memchr(pnc->pgsIn->str, '\n', pnc->pgsIn->len);
+    size_t cch;
+    char *sz;
+
+    if (!pch)
+        return NULL;
+
+    cch = (size_t) (pch - pnc->pgsIn->str);
+    sz = g_strndup(pnc->pgsIn->str, cch);
+    g_string_erase(pnc->pgsIn, 0, (gssize) cch + 1);
+    g_strchomp(sz);
+
+    return sz;
+}
+
+/* wait for the next line; NULL if the peer went away or we were interrupted */
+static char *
+NetReadLine(netconn * pnc)
+{
+    char *sz;
+
+    while (!(sz = NetLine(pnc))) {
+        int n = NetWait(pnc->h, UI_UPDATETIME);
+
+        ProcessEvents();
+
+        if (fInterrupt || (n < 0 && errno != EINTR))
+            return NULL;
+
+        if (n > 0 && NetReceive(pnc) <= 0)
+            return NULL;
+    }
+
+    return sz;
+}
+
+static void
+AppendFloat(GString * pgs, float r)
+{
+    char ach[G_ASCII_DTOSTR_BUF_SIZE];
+
+    /* nine significant digits bring back exactly the same float */
+    g_string_append_c(pgs, ' ');
+    g_string_append(pgs, g_ascii_formatd(ach, sizeof(ach), "%.9g", r));
+}
+
+static void
+AppendCubeInfo(GString * pgs, const cubeinfo * pci)
+{
+    int i;
+
+    g_string_append_printf(pgs, " %d %d %d %d %d %d %d %d %d %d", pci->nCube, pci->fCubeOwner, pci->fMove,
+                           pci->nMatchTo, pci->anScore[0], pci->anScore[1], pci->fCrawford, pci->fJacoby,
+                           pci->fBeavers, (int) pci->bgv);
+
+    for (i = 0; i < 4; i++)
+        AppendFloat(pgs, pci->arGammonPrice[i]);
+}
+
+static void
+AppendEvalContext(GString * pgs, const evalcontext * pec)
+{
+    g_string_append_printf(pgs, " %u %u %u %u", pec->fCubeful, pec->nPlies, pec->fUsePrune, pec->fDeterministic);
+    AppendFloat(pgs, pec->rNoise);
+}
+
+static void
+AppendMoveFilters(GString * pgs, movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES])
+{
+    int i, j;
+
+    for (i = 0; i < MAX_FILTER_PLIES; i++)
+        for (j = 0; j < MAX_FILTER_PLIES; j++) {
+            g_string_append_printf(pgs, " %d %d", aamf[i][j].Accept, aamf[i][j].Extra);
+            AppendFloat(pgs, aamf[i][j].Threshold);
+        }
+}
+
+static void
+AppendRolloutContext(GString * pgs, rolloutcontext * prc)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        AppendEvalContext(pgs, &prc->aecCube[i]);
+        AppendEvalContext(pgs, &prc->aecChequer[i]);
+        AppendEvalContext(pgs, &prc->aecCubeLate[i]);
+        AppendEvalContext(pgs, &prc->aecChequerLate[i]);
+        AppendMoveFilters(pgs, prc->aaamfChequer[i]);
+        AppendMoveFilters(pgs, prc->aaamfLate[i]);
+    }
+    AppendEvalContext(pgs, &prc->aecCubeTrunc);
+    AppendEvalContext(pgs, &prc->aecChequerTrunc);
+
+    g_string_append_printf(pgs, " %u %u %u %u %u %u %u %u %u %u %u", prc->fCubeful, prc->fVarRedn, prc->fInitial,
+                           prc->fRotate, prc->fTruncBearoff2, prc->fTruncBearoffOS, prc->fLateEvals,
+                           prc->fDoTruncate, prc->fStopOnSTD, prc->fStopOnJsd, prc->fStopMoveOnJsd);
+    g_string_append_printf(pgs, " %u %u %u %d %lu %u", prc->nTruncate, prc->nTrials, prc->nLate,
+                           (int) prc->rngRollout, prc->nSeed, prc->nMinimumGames);
+    AppendFloat(pgs, prc->rStdLimit);
+    g_string_append_printf(pgs, " %u", prc->nMinimumJsdGames);
+    AppendFloat(pgs, prc->rJsdLimit);
+    g_string_append_printf(pgs, " %u", prc->nGamesDone);
+    AppendFloat(pgs, prc->rStoppedOnJSD);
+    g_string_append_printf(pgs, " %d", prc->nSkip);
+}
+
+static int
+SendJob(int h, const rolloutjob * prj)
+{
+    int alt;
+
+    if (NetPrintf(h, "job %d %d %d\n", prj->alternatives, prj->fInvert, prj->fStatistics) < 0)
+        return -1;
+
+    for (alt = 0; alt < prj->alternatives; alt++) {
+        GString *pgs = g_string_new(NULL);
+        int n;
+
+        g_string_printf(pgs, "alt %d %d %d %s", alt, prj->anBasisCube[alt], prj->afCubeDecTop[alt],
+                        PositionID((ConstTanBoard) prj->aanBoard[alt]));
+        AppendCubeInfo(pgs, &prj->aci[alt]);
+        AppendRolloutContext(pgs, &prj->arc[alt]);
+        g_string_append_c(pgs, '\n');
+
+        n = ExternalWrite(h, pgs->str, pgs->len);
+        g_string_free(pgs, TRUE);
+
+        if (n < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static void
+FreeJob(rolloutjob * prj)
+{
+    g_free(prj->aanBoard);
+    g_free(prj->aci);
+    g_free(prj->afCubeDecTop);
+    g_free(prj->anBasisCube);
+    g_free(prj->arc);
+    memset(prj, 0, sizeof(rolloutjob));
+}
+
+/* The fields of a line from the coordinator. Every value is checked
+ * against the range the engine can cope with; the first field that is
+ * missing or out of range sets fError and makes the rest fail too. */
+typedef struct {
+    char **asz;
+    int fError;
+} netfields;
+
+static const char *
+NextField(netfields * pnf)
+{
+    if (pnf->fError || !*pnf->asz) {
+        pnf->fError = TRUE;
+        return NULL;
+    }
+
+    return *pnf->asz++;
+}
+
+static gint64
+FieldInt(netfields * pnf, gint64 nMin, gint64 nMax)
+{
+    const char *sz = NextField(pnf);
+    char *pchEnd;
+    gint64 n;
+
+    if (!sz)
+        return nMin;
+
+    errno = 0;
+    n = g_ascii_strtoll(sz, &pchEnd, 10);
+
+    if (errno || pchEnd == sz || *pchEnd || n < nMin || n > nMax) {
+        pnf->fError = TRUE;
+        return nMin;
+    }
+
+    return n;
+}
+
+static float
+FieldFloat(netfields * pnf, float rMin, float rMax)
+{
+    const char *sz = NextField(pnf);
+    char *pchEnd;
+    double r;
+
+    if (!sz)
+        return rMin;
+
+    r = g_ascii_strtod(sz, &pchEnd);
+
+    /* written this way round to refuse NaN as well */
+    if (pchEnd == sz || *pchEnd || !(r >= rMin && r <= rMax)) {
+        pnf->fError = TRUE;
+        return rMin;
+    }
+
+    return (float) r;
+}
+
+static unsigned long
+FieldSeed(netfields * pnf)
+{
+    const char *sz = NextField(pnf);
+    char *pchEnd;
+    guint64 n;
+
+    if (!sz)
+        return 0;
+
+    errno = 0;
+    n = g_ascii_strtoull(sz, &pchEnd, 10);
+
+    if (errno || pchEnd == sz || *pchEnd || *sz == '-' || n > G_MAXULONG) {
+        pnf->fError = TRUE;
+        return 0;
+    }
+
+    return (unsigned long) n;
+}
+
+static void
+FieldBoard(netfields * pnf, TanBoard anBoard)
+{
+    const char *sz = NextField(pnf);
+
+    /* PositionFromID() refuses more than 15 chequers a side */
+    if (!sz || strlen(sz) != L_POSITIONID
+        || strspn(sz, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/") != L_POSITIONID
+        || !PositionFromID(anBoard, sz))
+        pnf->fError = TRUE;
+}
+
+static void
+FieldCubeInfo(netfields * pnf, cubeinfo * pci)
+{
+    int i;
+
+    pci->nCube = (int) FieldInt(pnf, 1, MAX_CUBE);
+    pci->fCubeOwner = (int) FieldInt(pnf, -1, 1);
+    pci->fMove = (int) FieldInt(pnf, 0, 1);
+    pci->nMatchTo = (int) FieldInt(pnf, 0, MAXSCORE);
+    for (i = 0; i < 2; i++)
+        pci->anScore[i] = (int) FieldInt(pnf, 0, MAX(pci->nMatchTo - 1, 0));
+    pci->fCrawford = (int) FieldInt(pnf, 0, 1);
+    pci->fJacoby = (int) FieldInt(pnf, 0, 1);
+    pci->fBeavers = (int) FieldInt(pnf, 0, G_MAXINT);
+    pci->bgv = (bgvariation) FieldInt(pnf, 0, NUM_VARIATIONS - 1);
+    for (i = 0; i < 4; i++)
+        pci->arGammonPrice[i] = FieldFloat(pnf, 0.0f, G_MAXFLOAT);
+
+    /* the cube indexes the gammon price tables in match play */
+    if (pci->nCube & (pci->nCube - 1) || (pci->nMatchTo && LogCube(pci->nCube) >= MAXCUBELEVEL))
+        pnf->fError = TRUE;
+}
+
+static void
+FieldEvalContext(netfields * pnf, evalcontext * pec)
+{
+    pec->fCubeful = (unsigned int) FieldInt(pnf, 0, 1);
+    /* deeper evaluations would reuse the last row of the move filters */
+    pec->nPlies = (unsigned int) FieldInt(pnf, 0, MAX_FILTER_PLIES);
+    pec->fUsePrune = (unsigned int) FieldInt(pnf, 0, 1);
+    pec->fDeterministic = (unsigned int) FieldInt(pnf, 0, 1);
+    pec->rNoise = FieldFloat(pnf, 0.0f, G_MAXFLOAT);
+}
+
+static void
+FieldMoveFilters(netfields * pnf, movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES])
+{
+    int i, j;
+
+    for (i = 0; i < MAX_FILTER_PLIES; i++)
+        for (j = 0; j < MAX_FILTER_PLIES; j++) {
+            aamf[i][j].Accept = (int) FieldInt(pnf, -1, MAX_MOVES);
+            aamf[i][j].Extra = (int) FieldInt(pnf, 0, MAX_MOVES);
+            aamf[i][j].Threshold = FieldFloat(pnf, 0.0f, G_MAXFLOAT);
+        }
+}
+
+static void
+FieldRolloutContext(netfields * pnf, rolloutcontext * prc)
+{
+    int i;
+
+    memset(prc, 0, sizeof(rolloutcontext));
+
+    for (i = 0; i < 2; i++) {
+        FieldEvalContext(pnf, &prc->aecCube[i]);
+        FieldEvalContext(pnf, &prc->aecChequer[i]);
+        FieldEvalContext(pnf, &prc->aecCubeLate[i]);
+        FieldEvalContext(pnf, &prc->aecChequerLate[i]);
+        FieldMoveFilters(pnf, prc->aaamfChequer[i]);
+        FieldMoveFilters(pnf, prc->aaamfLate[i]);
+    }
+    FieldEvalContext(pnf, &prc->aecCubeTrunc);
+    FieldEvalContext(pnf, &prc->aecChequerTrunc);
+
+    prc->fCubeful = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fVarRedn = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fInitial = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fRotate = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fTruncBearoff2 = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fTruncBearoffOS = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fLateEvals = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fDoTruncate = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fStopOnSTD = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fStopOnJsd = (unsigned int) FieldInt(pnf, 0, 1);
+    prc->fStopMoveOnJsd = (unsigned int) FieldInt(pnf, 0, 1);
+
+    prc->nTruncate = (unsigned short) FieldInt(pnf, 0, G_MAXUSHORT);
+    prc->nTrials = (unsigned int) FieldInt(pnf, 0, G_MAXUINT);
+    prc->nLate = (unsigned short) FieldInt(pnf, 0, G_MAXUSHORT);
+    /* no dice the worker would have to ask for or fetch */
+    prc->rngRollout = (rng) FieldInt(pnf, RNG_BBS, RNG_MERSENNE);
+    prc->nSeed = FieldSeed(pnf);
+    prc->nMinimumGames = (unsigned int) FieldInt(pnf, 0, G_MAXUINT);
+    prc->rStdLimit = FieldFloat(pnf, 0.0f, G_MAXFLOAT);
+    prc->nMinimumJsdGames = (unsigned int) FieldInt(pnf, 0, G_MAXUINT);
+    prc->rJsdLimit = FieldFloat(pnf, 0.0f, G_MAXFLOAT);
+    prc->nGamesDone = (unsigned int) FieldInt(pnf, 0, G_MAXUINT);
+    prc->rStoppedOnJSD = FieldFloat(pnf, 0.0f, G_MAXFLOAT);
+    prc->nSkip = (int) FieldInt(pnf, 0, G_MAXINT);
+}
+
+static int
+ReceiveJob(netconn * pnc, const char *szJob, rolloutjob * prj)
+{
+    int alt;
+
+    FreeJob(prj);
+
+    if (sscanf(szJob, "job %d %d %d", &prj->alternatives, &prj->fInvert, &prj->fStatistics) != 3
+        || prj->alternatives < 1 || prj->alternatives > MAX_MOVES
+        || prj->fInvert < 0 || prj->fInvert > 1 || prj->fStatistics < 0 || prj->fStatistics > 1) {
+        prj->alternatives = 0;
+        return -1;
+    }
+
+    prj->aanBoard = g_new(TanBoard, prj->alternatives);
+    prj->aci = g_new(cubeinfo, prj->alternatives);
+    prj->afCubeDecTop = g_new(int, prj->alternatives);
+    prj->anBasisCube = g_new(int, prj->alternatives);
+    prj->arc = g_new(rolloutcontext, prj->alternatives);
+
+    for (alt = 0; alt < prj->alternatives; alt++) {
+        char *sz = NetReadLine(pnc);
+        char **asz;
+        const char *szField;
+        netfields nf;
+
+        if (!sz)
+            break;
+
+        asz = g_strsplit(sz, " ", 0);
+        nf.asz = asz;
+        nf.fError = FALSE;
+
+        if ((szField = NextField(&nf)) && strcmp(szField, "alt"))
+            nf.fError = TRUE;
+        FieldInt(&nf, alt, alt);
+        prj->anBasisCube[alt] = (int) FieldInt(&nf, 1, MAX_CUBE);
+        prj->afCubeDecTop[alt] = (int) FieldInt(&nf, 0, 1);
+        FieldBoard(&nf, prj->aanBoard[alt]);
+        FieldCubeInfo(&nf, &prj->aci[alt]);
+        FieldRolloutContext(&nf, &prj->arc[alt]);
+
+        if (!nf.fError && *nf.asz)
+            /* trailing garbage */
+            nf.fError = TRUE;
+
+        g_strfreev(asz);
+        g_free(sz);
+
+        if (nf.fError)
+            break;
+    }
+
+    if (alt < prj->alternatives) {
+        FreeJob(prj);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+SendResult(int h, const rolloutbatch * prb)
+{
+    char *szOutput = HexEncode(prb->aarOutput, prb->count * sizeof(*prb->aarOutput));
+    char *szStatistics = HexEncode(prb->aarsStatistics, sizeof(prb->aarsStatistics));
+    int n = NetPrintf(h, "result %d %d %d %s %s\n", prb->alt, prb->first, prb->count, szOutput, szStatistics);
+
+    g_free(szOutput);
+    g_free(szStatistics);
+
+    return n;
+}
+
+/* serve one coordinator until it disconnects */
+static void
+ServeCoordinator(int h)
+{
+    netconn nc;
+    rolloutjob rj;
+    char *sz;
+    char *szID = ProtocolID();
+    int fHello = FALSE;
+    int cTrials = 0;
+
+    nc.h = h;
+    nc.pgsIn = g_string_new(NULL);
+    memset(&rj, 0, sizeof(rj));
+
+    while ((sz = NetReadLine(&nc))) {
+        int alt, first, count;
+        int n;
+
+        if (!strncmp(sz, "hello ", 6)) {
+            if ((fHello = !strcmp(sz + 6, szID)))
+                n = NetPrintf(h, "ok %u\n", MT_GetNumThreads());
+            else
+                n = NetPrintf(h, "error incompatible worker (%s)\n", szID);
+        } else if (!fHello)
+            n = NetPrintf(h, "error expected hello\n");
+        else if (!strncmp(sz, "job ", 4)) {
+            if ((n = ReceiveJob(&nc, sz, &rj)) < 0)
+                NetPrintf(h, "error bad job\n");
+        } else if (sscanf(sz, "batch %d %d %d", &alt, &first, &count) == 3) {
+            if (alt < 0 || alt >= rj.alternatives || first < 0 || count < 1 || count > ROLLOUT_NET_MAX_BATCH)
+                n = NetPrintf(h, "error bad batch\n");
+            else {
+                rolloutbatch *prb = RolloutBatchNew(alt, first, count);
+
+                if ((n = RolloutRunBatch(&rj, prb)) == 0)
+                    n = SendResult(h, prb);
+
+                cTrials += count;
+                RolloutBatchFree(prb);
+            }
+        } else
+            n = NetPrintf(h, "error unknown command\n");
+
+        g_free(sz);
+
+        if (n < 0)
+            break;
+    }
+
+    outputf(_("Rollout coordinator disconnected after %d trials.\n"), cTrials);
+    outputx();
+
+    FreeJob(&rj);
+    g_string_free(nc.pgsIn, TRUE);
+    g_free(szID);
+    closesocket(h);
+}
+
+typedef struct {
+    char *szAddress;
+    netconn nc;                 /* nc.h is -1 once the worker is lost */
+    int nThreads;
+    rolloutbatch *prb;          /* the batch being played, if any */
+    gint64 tSent;               /* when it was sent, monotonic time */
+} rolloutworker;
+
+static int
+ConnectWorker(rolloutworker * prw, const rolloutjob * prj)
+{
+    struct sockaddr *psa;
+    socklen_t cb;
+    char *szID;
+    char *sz;
+    int h;
+    int f = TRUE;
+
+    if ((h = ExternalSocket(&psa, &cb, prw->szAddress)) < 0) {
+        SockErr(prw->szAddress);
+        return -1;
+    }
+
+    if (connect(h, psa, cb) < 0) {
+        SockErr(prw->szAddress);
+        closesocket(h);
+        g_free(psa);
+        return -1;
+    }
+
+    g_free(psa);
+
+    /* notice workers that disappear without closing the connection */
+#ifdef WIN32
+    setsockopt((SOCKET) h, SOL_SOCKET, SO_KEEPALIVE, (const char *) &f, sizeof f);
+#else
+    setsockopt(h, SOL_SOCKET, SO_KEEPALIVE, &f, sizeof f);
+#endif
+
+    prw->nc.h = h;
+
+    szID = ProtocolID();
+    f = NetPrintf(h, "hello %s\n", szID);
+    g_free(szID);
+
+    if (f < 0 || !(sz = NetReadLine(&prw->nc)))
+        return -1;
+
+    if (sscanf(sz, "ok %d", &prw->nThreads) != 1) {
+        outputerrf(_("Rollout worker %s refused the connection: %s\n"), prw->szAddress, sz);
+        g_free(sz);
+        return -1;
+    }
+
+    g_free(sz);
+
+    if (prw->nThreads < 1)
+        prw->nThreads = 1;
+
+    return SendJob(h, prj);
+}
+
+static void
+LoseWorker(rolloutworker * prw, GQueue * pqRetry)
+{
+    /* somebody else will have to play its trials */
+    if (prw->prb) {
+        g_queue_push_tail(pqRetry, prw->prb);
+        prw->prb = NULL;
+    }
+
+    if (prw->nc.h >= 0) {
+        closesocket(prw->nc.h);
+        prw->nc.h = -1;
+    }
+}
+
+static int
+ReadResult(rolloutworker * prw, const char *sz)
+{
+    rolloutbatch *prb = prw->prb;
+    char **asz = g_strsplit(sz, " ", 0);
+    int f;
+
+    f = g_strv_length(asz) == 6 && !strcmp(asz[0], "result")
+        && atoi(asz[1]) == prb->alt && atoi(asz[2]) == prb->first && atoi(asz[3]) == prb->count
+        && !HexDecode(asz[4], prb->aarOutput, prb->count * sizeof(*prb->aarOutput))
+        && !HexDecode(asz[5], prb->aarsStatistics, sizeof(prb->aarsStatistics));
+
+    g_strfreev(asz);
+
+    return f ? 0 : -1;
+}
+
+#endif                          /* HAVE_SOCKETS */
+
+/* Play a rollout on the workers in szRolloutWorkers. Batches of lost
+ * workers are handed to the others, and if all workers are lost the
+ * remaining trials are played locally. Returns -1 if no worker could
+ * be reached at all. */
+extern int
+RolloutCoordinate(const rolloutjob * prj, rolloutnextfunc * pfNext, rolloutdonefunc * pfDone)
+{
+#if !HAVE_SOCKETS
+    (void) prj;
+    (void) pfNext;
+    (void) pfDone;
+    return -1;
+#else
+    char **aszAddress;
+    rolloutworker *arw;
+    GQueue *pqRetry;
+    rolloutbatch *prb;
+    int cWorkers, cLive = 0;
+    int i;
+    int fDone = FALSE;
+    gint64 tSlowest = 0;
+
+    if (!szRolloutWorkers)
+        return -1;
+
+    aszAddress = g_strsplit(szRolloutWorkers, " ", 0);
+    cWorkers = (int) g_strv_length(aszAddress);
+    arw = g_new0(rolloutworker, cWorkers);
+
+    for (i = 0; i < cWorkers; i++) {
+        arw[i].szAddress = aszAddress[i];
+        arw[i].nc.h = -1;
+        arw[i].nc.pgsIn = g_string_new(NULL);
+
+        if (ConnectWorker(&arw[i], prj) == 0)
+            cLive++;
+        else
+            LoseWorker(&arw[i], NULL);
+    }
+
+    if (!cLive) {
+        outputl(_("No rollout worker could be reached; rolling out locally."));
+        for (i = 0; i < cWorkers; i++)
+            g_string_free(arw[i].nc.pgsIn, TRUE);
+        g_free(arw);
+        g_strfreev(aszAddress);
+        return -1;
+    }
+
+    pqRetry = g_queue_new();
+
+    while (!fDone && !fInterrupt) {
+        fd_set fds;
+        struct timeval tv;
+        int hMax = -1;
+        int cBusy = 0;
+        int n;
+
+        /* keep all live workers busy */
+        for (i = 0; i < cWorkers; i++) {
+            rolloutworker *prw = &arw[i];
+
+            if (prw->nc.h < 0 || prw->prb)
+                continue;
+
+            if (!(prb = g_queue_pop_head(pqRetry))
+                && !(prb = pfNext(prw->nThreads * ROLLOUT_NET_TRIALS_PER_THREAD)))
+                break;
+
+            prw->prb = prb;
+            prw->tSent = g_get_monotonic_time();
+            if (NetPrintf(prw->nc.h, "batch %d %d %d\n", prb->alt, prb->first, prb->count) < 0) {
+                outputf(_("Lost rollout worker %s.\n"), prw->szAddress);
+                LoseWorker(prw, pqRetry);
+                cLive--;
+            }
+        }
+
+        FD_ZERO(&fds);
+        for (i = 0; i < cWorkers; i++)
+            if (arw[i].prb) {
+                FD_SET(arw[i].nc.h, &fds);
+                hMax = MAX(hMax, arw[i].nc.h);
+                cBusy++;
+            }
+
+        if (!cBusy) {
+            if (cLive)
+                /* nothing in flight and nothing left to hand out */
+                break;
+
+            outputl(_("All rollout workers are lost; finishing the rollout locally."));
+            while (!fDone && (prb = g_queue_pop_head(pqRetry))) {
+                if (RolloutRunBatch(prj, prb) < 0) {
+                    RolloutBatchFree(prb);
+                    break;
+                }
+                fDone = !pfDone(prb);
+            }
+            if (!fDone && !fInterrupt)
+                RolloutPlayLocal(prj, pfNext, pfDone);
+            break;
+        }
+
+        tv.tv_sec = 0;
+        tv.tv_usec = UI_UPDATETIME * 1000;
+        n = select(hMax + 1, &fds, NULL, NULL, &tv);
+
+        ProcessEvents();
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            SockErr("select");
+            break;
+        }
+
+        for (i = 0; i < cWorkers && !fDone; i++) {
+            rolloutworker *prw = &arw[i];
+            char *sz;
+
+            if (!prw->prb || !FD_ISSET(prw->nc.h, &fds))
+                continue;
+
+            if (NetReceive(&prw->nc) <= 0) {
+                outputf(_("Lost rollout worker %s.\n"), prw->szAddress);
+                LoseWorker(prw, pqRetry);
+                cLive--;
+                continue;
+            }
+
+            while (!fDone && prw->prb && (sz = NetLine(&prw->nc))) {
+                if (ReadResult(prw, sz) < 0) {
+                    outputerrf(_("Rollout worker %s: %s\n"), prw->szAddress, sz);
+                    LoseWorker(prw, pqRetry);
+                    cLive--;
+                } else {
+                    prb = prw->prb;
+                    prw->prb = NULL;
+                    tSlowest = MAX(tSlowest, g_get_monotonic_time() - prw->tSent);
+                    fDone = !pfDone(prb);
+                }
+                g_free(sz);
+            }
+        }
+
+        /* a worker that hangs without closing the connection would hold
+         * up the rollout until SO_KEEPALIVE noticed, if ever */
+        for (i = 0; i < cWorkers && !fDone; i++) {
+            rolloutworker *prw = &arw[i];
+
+            if (prw->prb && g_get_monotonic_time() - prw->tSent
+                > MAX(ROLLOUT_NET_TIMEOUT * G_TIME_SPAN_SECOND, ROLLOUT_NET_TIMEOUT_FACTOR * tSlowest)) {
+                outputf(_("Rollout worker %s does not answer; giving its batch to another.\n"), prw->szAddress);
+                LoseWorker(prw, pqRetry);
+                cLive--;
+            }
+        }
+    }
+
+    for (i = 0; i < cWorkers; i++) {
+        if (arw[i].prb)
+            RolloutBatchFree(arw[i].prb);
+        if (arw[i].nc.h >= 0)
+            closesocket(arw[i].nc.h);
+        g_string_free(arw[i].nc.pgsIn, TRUE);
+    }
+    g_queue_free_full(pqRetry, (GDestroyNotify) RolloutBatchFree);
+    g_free(arw);
+    g_strfreev(aszAddress);
+
+    return 0;
+#endif
+}
+
+extern void
+CommandRolloutWorker(char *sz)
+{
+#if !HAVE_SOCKETS
+    (void) sz;                  /* silence compiler warning */
+    outputl(_("This installation of GNU Backgammon was compiled without\n"
+              "socket support, and cannot act as a rollout worker."));
+#else
+    int h, hPeer;
+    char *szAddress;
+    socklen_t cb;
+    struct sockaddr *psa;
+    struct sockaddr_in saRemote;
+    socklen_t saLen;
+
+    sz = NextToken(&sz);
+
+    if (!sz || !*sz) {
+        outputl(_("You must specify the address to listen on (e.g. `rollout worker :4242')."));
+        return;
+    }
+
+    /* the jobs come unauthenticated, so only serve other hosts on request */
+    szAddress = *sz == ':' ? g_strconcat("127.0.0.1", sz, NULL) : g_strdup(sz);
+
+    if ((h = ExternalSocket(&psa, &cb, szAddress)) < 0) {
+        SockErr(szAddress);
+        g_free(szAddress);
+        return;
+    }
+
+    if (bind(h, psa, cb) < 0) {
+        SockErr(szAddress);
+        closesocket(h);
+        g_free(psa);
+        g_free(szAddress);
+        return;
+    }
+
+    g_free(psa);
+
+    if (listen(h, 1) < 0) {
+        SockErr("listen");
+        closesocket(h);
+        g_free(szAddress);
+        return;
+    }
+
+    outputf(_("Rollout worker waiting for a coordinator on %s...\n"), szAddress);
+    outputx();
+    g_free(szAddress);
+
+    while (!fInterrupt) {
+        int n = NetWait(h, UI_UPDATETIME);
+
+        ProcessEvents();
+
+        if (n < 0 && errno != EINTR) {
+            SockErr("select");
+            break;
+        }
+
+        if (n <= 0)
+            continue;
+
+        /* Must set length when using windows */
+        saLen = sizeof(saRemote);
+        if ((hPeer = accept(h, (struct sockaddr *) &saRemote, &saLen)) < 0) {
+            if (errno == EINTR)
+                continue;
+
+            SockErr("accept");
+            break;
+        }
+
+        outputf(_("Accepted rollout coordinator %s.\n"), inet_ntoa(saRemote.sin_addr));
+        outputx();
+
+        ServeCoordinator(hPeer);
+    }
+
+    closesocket(h);
+#endif
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+#ifndef ROLLOUTNET_H
+#define ROLLOUTNET_H
+
+#include "eval.h"
+#include "rollout.h"
+
+/* Version of the line protocol spoken between a rollout coordinator
+ * and its workers */
+#define ROLLOUT_NET_PROTOCOL 2
+
+/* Trials per batch when batches are played locally. This is fixed, not
+ * derived from the number of threads, so that the stopping rules are
+ * checked at the same points whatever machine resumes a rollout. */
+#define ROLLOUT_LOCAL_BATCH 36
+
+/* a batch of consecutive trials of one alternative */
+typedef struct {
+    int alt;
+    int first;                  /* index of the first trial */
+    int count;
+    float (*aarOutput)[NUM_ROLLOUT_OUTPUTS];    /* one row per trial */
+    rolloutstat aarsStatistics[2];
+} rolloutbatch;
+
+/* everything a worker needs to play any trial of a rollout */
+typedef struct {
+    int alternatives;
+    int fInvert;
+    int fStatistics;            /* collect rolloutstat (cube rollouts) */
+    TanBoard *aanBoard;
+    cubeinfo *aci;
+    int *afCubeDecTop;
+    int *anBasisCube;
+    rolloutcontext *arc;
+} rolloutjob;
+
+/* hands out the next batch of at most nMaxTrials trials, or NULL if
+ * there is nothing to do right now */
+typedef rolloutbatch *(rolloutnextfunc) (int nMaxTrials);
+
+/* takes over a completed batch; returns FALSE when the rollout is done */
+typedef int (rolloutdonefunc) (rolloutbatch * prb);
+
+extern rolloutbatch *RolloutBatchNew(int alt, int first, int count);
+extern void RolloutBatchFree(rolloutbatch * prb);
+extern int RolloutRunBatch(const rolloutjob * prj, rolloutbatch * prb);
+extern int RolloutPlayLocal(const rolloutjob * prj, rolloutnextfunc * pfNext, rolloutdonefunc * pfDone);
+extern int RolloutCoordinate(const rolloutjob * prj, rolloutnextfunc * pfNext, rolloutdonefunc * pfDone);
+
+#endif
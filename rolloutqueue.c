@@ -0,0 +1,706 @@
+/*
+ * Copyright (C) 2022 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+/*
+ * Rollout job queue.
+ *
+ * Clients (the command line, Python scripts or external controllers)
+ * submit rollouts of the cube decision or the best moves of a position
+ * and collect the results later:
+ *
+ *   submit cube|moves [position=<position id>:<match id>] [candidates=<n>]
+ *          [trials=<n>] [weight=<w>] [client=<name>]
+ *                              job <id> queued
+ *   status [<id>]              job <id> <state> <client> <played>/<trials>
+ *   cancel <id>                job <id> cancelled
+ *   result <id>                job <id> done <lines>, followed by the lines
+ *
+ * Every job is a checkpointed rollout which is played ROLLOUT_QUEUE_SLICE
+ * trials at a time. Each slice goes to the client that has had the least
+ * service for its weight, and within a client to its oldest job, so a
+ * client with a long job cannot starve the short jobs of the others.
+ * Socket and Python clients are known by their address or as "python";
+ * only the command line may name another client or change a weight, so
+ * no client can take more than its share of the queue.
+ *
+ * A job is kept in the results directory as <id>.job (its state),
+ * <id>.ckpt (the rollout checkpoint) and, once finished, <id>.txt (the
+ * results), so the queue survives a restart of gnubg. Only one process
+ * may own a results directory: a server with several worker processes
+ * has the queue turned off.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "backgammon.h"
+#include "drawboard.h"
+#include "positionid.h"
+#include "matchid.h"
+#include "rollout.h"
+#include "rolloutnet.h"
+#include "rolloutqueue.h"
+
+/* trials played for one job before the scheduler picks again */
+#define ROLLOUT_QUEUE_SLICE (10 * ROLLOUT_LOCAL_BATCH)
+
+/* candidate moves rolled out when the client doesn't say */
+#define ROLLOUT_QUEUE_CANDIDATES 5
+
+/* the largest share one client can be given */
+#define ROLLOUT_QUEUE_MAX_WEIGHT 100.0
+
+typedef enum {
+    JOB_QUEUED, JOB_DONE, JOB_CANCELLED, JOB_FAILED
+} jobstate;
+
+static const char *aszJobState[] = { "queued", "done", "cancelled", "failed" };
+
+typedef struct {
+    char *szName;
+    double rWeight;
+    double rService;            /* trials played for the client / weight */
+} jobclient;
+
+typedef struct {
+    unsigned int nID;
+    jobstate js;
+    jobclient *pjc;
+    unsigned int nPlayed;       /* trials played so far */
+    unsigned int nTrials;       /* upper limit for nPlayed */
+    char **aszLabel;            /* one per alternative, NULL terminated */
+} queuedjob;
+
+char *szRolloutResultDir = NULL;
+
+static GList *plJobs;           /* in order of submission */
+static GList *plClients;
+static unsigned int nNextJob = 1;
+static int fQueueLoaded;
+static char *szQueueOff;        /* why the queue is not available, if it isn't */
+static double rServiceNow;      /* service of the client served last */
+
+static char *
+QueueDir(void)
+{
+    return szRolloutResultDir ? g_strdup(szRolloutResultDir) : g_build_filename(szHomeDirectory, "rollouts", NULL);
+}
+
+static char *
+JobFile(unsigned int nID, const char *szExt)
+{
+    char *szDir = QueueDir();
+    char *szName = g_strdup_printf("%u.%s", nID, szExt);
+    char *sz = g_build_filename(szDir, szName, NULL);
+
+    g_free(szName);
+    g_free(szDir);
+
+    return sz;
+}
+
+static jobclient *
+GetClient(const char *szName)
+{
+    GList *pl;
+    jobclient *pjc;
+
+    for (pl = plClients; pl; pl = pl->next)
+        if (!strcmp(((jobclient *) pl->data)->szName, szName))
+            return pl->data;
+
+    /* newcomers start level with the others, not with a head start */
+    pjc = g_new(jobclient, 1);
+    pjc->szName = g_strdup(szName);
+    pjc->rWeight = 1.0;
+    pjc->rService = rServiceNow;
+    plClients = g_list_append(plClients, pjc);
+
+    return pjc;
+}
+
+static int
+SaveJob(const queuedjob * pqj)
+{
+    GString *gsz = g_string_new(NULL);
+    char szWeight[G_ASCII_DTOSTR_BUF_SIZE];
+    char *szFile = JobFile(pqj->nID, "job");
+    char **psz;
+    GError *error = NULL;
+    int n = 0;
+
+    g_string_append_printf(gsz, "state %s\n", aszJobState[pqj->js]);
+    g_string_append_printf(gsz, "client %s\n", pqj->pjc->szName);
+    g_string_append_printf(gsz, "weight %s\n", g_ascii_formatd(szWeight, sizeof(szWeight), "%g", pqj->pjc->rWeight));
+    g_string_append_printf(gsz, "played %u\n", pqj->nPlayed);
+    g_string_append_printf(gsz, "trials %u\n", pqj->nTrials);
+    for (psz = pqj->aszLabel; *psz; psz++)
+        g_string_append_printf(gsz, "label %s\n", *psz);
+
+    if (!g_file_set_contents(szFile, gsz->str, (gssize) gsz->len, &error)) {
+        outputerrf("%s: %s\n", szFile, error->message);
+        g_error_free(error);
+        n = -1;
+    }
+
+    g_free(szFile);
+    g_string_free(gsz, TRUE);
+
+    return n;
+}
+
+static queuedjob *
+LoadJob(unsigned int nID)
+{
+    char *szFile = JobFile(nID, "job");
+    char *szContents;
+    char **aszLines, **psz;
+    GPtrArray *papLabels = g_ptr_array_new();
+    queuedjob *pqj;
+    const char *szClient = "local";
+    double rWeight = 1.0;
+
+    if (!g_file_get_contents(szFile, &szContents, NULL, NULL)) {
+        g_free(szFile);
+        g_ptr_array_free(papLabels, TRUE);
+        return NULL;
+    }
+
+    g_free(szFile);
+
+    pqj = g_new0(queuedjob, 1);
+    pqj->nID = nID;
+    pqj->js = JOB_FAILED;
+
+    aszLines = g_strsplit(szContents, "\n", -1);
+    g_free(szContents);
+
+    for (psz = aszLines; *psz; psz++) {
+        char *pch = strchr(*psz, ' ');
+        unsigned int i;
+
+        if (!pch)
+            continue;
+        *pch++ = 0;
+
+        if (!strcmp(*psz, "state")) {
+            for (i = 0; i < G_N_ELEMENTS(aszJobState); i++)
+                if (!strcmp(pch, aszJobState[i]))
+                    pqj->js = (jobstate) i;
+        } else if (!strcmp(*psz, "client"))
+            szClient = pch;
+        else if (!strcmp(*psz, "weight"))
+            rWeight = g_ascii_strtod(pch, NULL);
+        else if (!strcmp(*psz, "played"))
+            pqj->nPlayed = (unsigned int) strtoul(pch, NULL, 10);
+        else if (!strcmp(*psz, "trials"))
+            pqj->nTrials = (unsigned int) strtoul(pch, NULL, 10);
+        else if (!strcmp(*psz, "label"))
+            g_ptr_array_add(papLabels, g_strdup(pch));
+    }
+
+    pqj->pjc = GetClient(szClient);
+    if (rWeight > 0.0)
+        pqj->pjc->rWeight = rWeight;
+
+    g_ptr_array_add(papLabels, NULL);
+    pqj->aszLabel = (char **) g_ptr_array_free(papLabels, FALSE);
+
+    g_strfreev(aszLines);
+
+    return pqj;
+}
+
+static gint
+CompareJobs(gconstpointer a, gconstpointer b)
+{
+    const queuedjob *pqjA = a;
+    const queuedjob *pqjB = b;
+
+    return pqjA->nID < pqjB->nID ? -1 : pqjA->nID > pqjB->nID;
+}
+
+/* pick up the jobs of an earlier session */
+static void
+LoadQueue(void)
+{
+    char *szDir;
+    GDir *pd;
+    const char *szName;
+
+    if (fQueueLoaded)
+        return;
+
+    fQueueLoaded = TRUE;
+
+    szDir = QueueDir();
+
+    if ((pd = g_dir_open(szDir, 0, NULL))) {
+        while ((szName = g_dir_read_name(pd))) {
+            unsigned int nID;
+            char *pchEnd;
+            queuedjob *pqj;
+
+            nID = (unsigned int) strtoul(szName, &pchEnd, 10);
+            if (!nID || strcmp(pchEnd, ".job") || !(pqj = LoadJob(nID)))
+                continue;
+
+            plJobs = g_list_insert_sorted(plJobs, pqj, CompareJobs);
+            if (nID >= nNextJob)
+                nNextJob = nID + 1;
+        }
+        g_dir_close(pd);
+    }
+
+    g_free(szDir);
+}
+
+static void
+FreeJob(queuedjob * pqj)
+{
+    g_strfreev(pqj->aszLabel);
+    g_free(pqj);
+}
+
+static void
+FreeClient(jobclient * pjc)
+{
+    g_free(pjc->szName);
+    g_free(pjc);
+}
+
+/* drop the queue, e.g. when the results directory changes; it is read
+ * again from the directory when it is next used */
+extern void
+RolloutQueueForget(void)
+{
+    g_list_free_full(plJobs, (GDestroyNotify) FreeJob);
+    g_list_free_full(plClients, (GDestroyNotify) FreeClient);
+    plJobs = plClients = NULL;
+    nNextJob = 1;
+    rServiceNow = 0.0;
+    fQueueLoaded = FALSE;
+}
+
+static queuedjob *
+FindJob(unsigned int nID)
+{
+    GList *pl;
+
+    for (pl = plJobs; pl; pl = pl->next)
+        if (((queuedjob *) pl->data)->nID == nID)
+            return pl->data;
+
+    return NULL;
+}
+
+static queuedjob *
+NextJob(void)
+{
+    GList *pl;
+    queuedjob *pqjNext = NULL;
+
+    for (pl = plJobs; pl; pl = pl->next) {
+        queuedjob *pqj = pl->data;
+
+        if (pqj->js == JOB_QUEUED && (!pqjNext || pqj->pjc->rService < pqjNext->pjc->rService))
+            pqjNext = pqj;
+    }
+
+    return pqjNext;
+}
+
+/* turn the queue off for this process; job commands answer szReason */
+extern void
+RolloutQueueDisable(const char *szReason)
+{
+    g_free(szQueueOff);
+    szQueueOff = g_strdup(szReason);
+    RolloutQueueForget();
+}
+
+/* play one slice of the next job; returns FALSE if there was none */
+extern int
+RolloutQueueSlice(void)
+{
+    queuedjob *pqj;
+    char *szFile;
+    char *szResult;
+    unsigned int nPlayed;
+    int n;
+
+    if (szQueueOff)
+        return FALSE;
+
+    LoadQueue();
+
+    if (!(pqj = NextJob()))
+        return FALSE;
+
+    rServiceNow = pqj->pjc->rService;
+
+    szFile = JobFile(pqj->nID, "ckpt");
+    n = RolloutResume(szFile, ROLLOUT_QUEUE_SLICE, (const char **) pqj->aszLabel, &szResult, &nPlayed);
+    g_free(szFile);
+
+    pqj->nPlayed += nPlayed;
+    pqj->pjc->rService += nPlayed / pqj->pjc->rWeight;
+
+    if (n < 0 || (n == 0 && !szResult))
+        pqj->js = JOB_FAILED;
+    else if (n == 0) {
+        GError *error = NULL;
+
+        szFile = JobFile(pqj->nID, "txt");
+        if (g_file_set_contents(szFile, szResult, -1, &error))
+            pqj->js = JOB_DONE;
+        else {
+            outputerrf("%s: %s\n", szFile, error->message);
+            g_error_free(error);
+            pqj->js = JOB_FAILED;
+        }
+        g_free(szFile);
+    }
+
+    g_free(szResult);
+    SaveJob(pqj);
+
+    if (pqj->js != JOB_QUEUED) {
+        outputf(_("Rollout job %u %s after %u trials.\n"), pqj->nID, aszJobState[pqj->js], pqj->nPlayed);
+        outputx();
+    }
+
+    return !fInterrupt;
+}
+
+static char *
+SubmitJob(const char *szClient, int fLocal, char *sz)
+{
+    char *pchKind = NextToken(&sz);
+    char *apch[2];
+    char *szPosition = NULL;
+    int nCandidates = ROLLOUT_QUEUE_CANDIDATES;
+    int nTrials = (int) rcRollout.nTrials;
+    double rWeight = 0.0;
+    TanBoard anBoard;
+    cubeinfo ci;
+    unsigned int anDice[2];
+    TanBoard *aanBoard;
+    cubeinfo *aci;
+    int *afCubeDecTop;
+    char **aszLabel;
+    int alternatives, alt, fCube;
+    rolloutcontext rc;
+    queuedjob *pqj;
+    jobclient *pjc;
+    char *szFile, *szDir;
+    GList *pl;
+
+    if (!pchKind || (strcmp(pchKind, "cube") && strcmp(pchKind, "moves")))
+        return g_strdup("Error: submit cube|moves [position=<id>] [candidates=<n>] [trials=<n>] [weight=<w>]\n");
+
+    fCube = !strcmp(pchKind, "cube");
+
+    while (ParseKeyValue(&sz, apch)) {
+        if (!apch[1])
+            return g_strdup_printf("Error: %s needs a value\n", apch[0]);
+
+        if (!strcmp(apch[0], "position"))
+            szPosition = apch[1];
+        else if (!strcmp(apch[0], "candidates"))
+            nCandidates = atoi(apch[1]);
+        else if (!strcmp(apch[0], "trials"))
+            nTrials = atoi(apch[1]);
+        else if ((!strcmp(apch[0], "weight") || !strcmp(apch[0], "client")) && !fLocal)
+            return g_strdup_printf("Error: %s can only be given on the command line\n", apch[0]);
+        else if (!strcmp(apch[0], "weight"))
+            rWeight = g_ascii_strtod(apch[1], NULL);
+        else if (!strcmp(apch[0], "client"))
+            szClient = apch[1];
+        else
+            return g_strdup_printf("Error: unknown option '%s'\n", apch[0]);
+    }
+
+    if (nCandidates < 1 || nCandidates > MAX_MOVES || nTrials < 1 || rWeight < 0.0
+        || rWeight > ROLLOUT_QUEUE_MAX_WEIGHT)
+        return g_strdup("Error: invalid option value\n");
+
+    switch (rcRollout.rngRollout) {
+    case RNG_MANUAL:
+    case RNG_RANDOM_DOT_ORG:
+    case RNG_FILE:
+        return g_strdup("Error: queued rollouts need a seeded random number generator\n");
+    default:
+        break;
+    }
+
+    if (szPosition) {
+        char *pchMatch = strchr(szPosition, ':');
+        int fTurn, fResigned, fDoubled, fMove, fCubeOwner, fCrawford, nMatchTo, nCube, fJacoby;
+        int anScore[2];
+        gamestate gs;
+
+        if (!pchMatch)
+            return g_strdup("Error: the position must be given as <position id>:<match id>\n");
+        *pchMatch++ = 0;
+
+        if (!PositionFromID(anBoard, szPosition)
+            || MatchFromID(anDice, &fTurn, &fResigned, &fDoubled, &fMove, &fCubeOwner, &fCrawford, &nMatchTo,
+                           anScore, &nCube, &fJacoby, &gs, pchMatch) < 0)
+            return g_strdup("Error: invalid position\n");
+
+        SetCubeInfo(&ci, nCube, fCubeOwner, fMove, nMatchTo, anScore, fCrawford, fJacoby, nBeavers,
+                    VARIATION_STANDARD);
+    } else {
+        if (ms.gs != GAME_PLAYING)
+            return g_strdup("Error: no position given and no game in progress\n");
+
+        memcpy(anBoard, msBoard(), sizeof(TanBoard));
+        GetMatchStateCubeInfo(&ci, &ms);
+        anDice[0] = ms.anDice[0];
+        anDice[1] = ms.anDice[1];
+    }
+
+    if (fCube) {
+        if (!GetDPEq(NULL, NULL, &ci))
+            return g_strdup("Error: the cube is not available\n");
+
+        alternatives = 2;
+        aanBoard = g_new(TanBoard, alternatives);
+        aci = g_new(cubeinfo, alternatives);
+        afCubeDecTop = g_new0(int, alternatives);
+        aszLabel = g_new0(char *, alternatives + 1);
+
+        memcpy(aanBoard[0], anBoard, sizeof(TanBoard));
+        memcpy(aanBoard[1], anBoard, sizeof(TanBoard));
+        memcpy(&aci[0], &ci, sizeof(cubeinfo));
+        SetCubeInfo(&aci[1], 2 * ci.nCube, !ci.fMove, ci.fMove, ci.nMatchTo, ci.anScore, ci.fCrawford,
+                    ci.fJacoby, ci.fBeavers, ci.bgv);
+        aszLabel[0] = g_strdup(_("No double"));
+        aszLabel[1] = g_strdup(_("Double, take"));
+    } else {
+        movelist ml;
+
+        if (anDice[0] < 1 || anDice[1] < 1)
+            return g_strdup("Error: the dice have not been rolled\n");
+
+        if (FindnSaveBestMoves(&ml, (int) anDice[0], (int) anDice[1], (ConstTanBoard) anBoard, NULL, 0.0f, &ci,
+                               &esEvalChequer.ec, aamfEval) < 0)
+            return g_strdup("Error: interrupted\n");
+
+        if (!ml.cMoves)
+            return g_strdup("Error: there is no legal move\n");
+
+        alternatives = MIN(nCandidates, (int) ml.cMoves);
+        aanBoard = g_new(TanBoard, alternatives);
+        aci = g_new(cubeinfo, alternatives);
+        afCubeDecTop = g_new(int, alternatives);
+        aszLabel = g_new0(char *, alternatives + 1);
+
+        /* as ScoreMoveRollout(): roll out the positions after the moves */
+        for (alt = 0; alt < alternatives; alt++) {
+            char szMove[FORMATEDMOVESIZE];
+
+            PositionFromKey(aanBoard[alt], &ml.amMoves[alt].key);
+            SwapSides(aanBoard[alt]);
+            memcpy(&aci[alt], &ci, sizeof(cubeinfo));
+            aci[alt].fMove = !aci[alt].fMove;
+            afCubeDecTop[alt] = TRUE;
+            aszLabel[alt] = g_strdup(FormatMove(szMove, (ConstTanBoard) anBoard, ml.amMoves[alt].anMove));
+        }
+
+        g_free(ml.amMoves);
+    }
+
+    LoadQueue();
+
+    memcpy(&rc, &rcRollout, sizeof(rolloutcontext));
+    rc.nTrials = (unsigned int) nTrials;
+
+    pjc = GetClient(szClient);
+    if (rWeight > 0.0)
+        pjc->rWeight = rWeight;
+
+    /* a client that was idle rejoins level with the busy ones */
+    for (pl = plJobs; pl; pl = pl->next)
+        if (((queuedjob *) pl->data)->pjc == pjc && ((queuedjob *) pl->data)->js == JOB_QUEUED)
+            break;
+    if (!pl)
+        pjc->rService = MAX(pjc->rService, rServiceNow);
+
+    pqj = g_new0(queuedjob, 1);
+    pqj->nID = nNextJob++;
+    pqj->js = JOB_QUEUED;
+    pqj->pjc = pjc;
+    pqj->nTrials = (unsigned int) (nTrials * alternatives);
+    pqj->aszLabel = aszLabel;
+
+    szDir = QueueDir();
+    g_mkdir_with_parents(szDir, 0755);
+    g_free(szDir);
+
+    szFile = JobFile(pqj->nID, "ckpt");
+    if (RolloutCheckpointNew(szFile, (ConstTanBoard *) aanBoard, aci, afCubeDecTop, alternatives, !fCube, fCube, &rc) < 0
+        || SaveJob(pqj) < 0) {
+        g_free(szFile);
+        g_free(aanBoard);
+        g_free(aci);
+        g_free(afCubeDecTop);
+        FreeJob(pqj);
+        return g_strdup("Error: cannot write to the results directory\n");
+    }
+
+    g_free(szFile);
+    g_free(aanBoard);
+    g_free(aci);
+    g_free(afCubeDecTop);
+
+    plJobs = g_list_append(plJobs, pqj);
+
+    return g_strdup_printf("job %u queued\n", pqj->nID);
+}
+
+static void
+AppendStatus(GString * gsz, const queuedjob * pqj)
+{
+    g_string_append_printf(gsz, "job %u %s %s %u/%u\n", pqj->nID, aszJobState[pqj->js], pqj->pjc->szName,
+                           pqj->nPlayed, pqj->nTrials);
+}
+
+static char *
+JobCommand(const char *szClient, int fLocal, const char *szCommand, char *sz)
+{
+    char *pch;
+    queuedjob *pqj = NULL;
+
+    if (szQueueOff)
+        return g_strdup_printf("Error: %s\n", szQueueOff);
+
+    LoadQueue();
+
+    if (!strcmp(szCommand, "submit"))
+        return SubmitJob(szClient, fLocal, sz);
+
+    if (strcmp(szCommand, "status") && strcmp(szCommand, "cancel") && strcmp(szCommand, "result"))
+        return g_strdup_printf("Error: unknown job command '%s'\n", szCommand);
+
+    if ((pch = NextToken(&sz)) && !(pqj = FindJob((unsigned int) strtoul(pch, NULL, 10))))
+        return g_strdup_printf("Error: no job %s\n", pch);
+
+    if (!strcmp(szCommand, "status")) {
+        GString *gsz = g_string_new(NULL);
+        GList *pl;
+
+        if (pqj)
+            AppendStatus(gsz, pqj);
+        else
+            for (pl = plJobs; pl; pl = pl->next)
+                AppendStatus(gsz, pl->data);
+
+        if (!gsz->len)
+            g_string_append(gsz, "no jobs\n");
+
+        return g_string_free(gsz, FALSE);
+    }
+
+    if (!pqj)
+        return g_strdup_printf("Error: %s needs a job number\n", szCommand);
+
+    if (!strcmp(szCommand, "cancel")) {
+        if (pqj->js != JOB_QUEUED)
+            return g_strdup_printf("Error: job %u is %s\n", pqj->nID, aszJobState[pqj->js]);
+
+        pqj->js = JOB_CANCELLED;
+        SaveJob(pqj);
+
+        return g_strdup_printf("job %u cancelled\n", pqj->nID);
+    } else {
+        char *szFile, *szResult, *szResponse;
+        unsigned int cLines = 0;
+        const char *pchLine;
+
+        if (pqj->js != JOB_DONE)
+            return g_strdup_printf("Error: job %u is %s (%u/%u trials)\n", pqj->nID, aszJobState[pqj->js],
+                                   pqj->nPlayed, pqj->nTrials);
+
+        szFile = JobFile(pqj->nID, "txt");
+        if (!g_file_get_contents(szFile, &szResult, NULL, NULL)) {
+            g_free(szFile);
+            return g_strdup_printf("Error: the results of job %u are missing\n", pqj->nID);
+        }
+        g_free(szFile);
+
+        /* tell line based clients how much to read */
+        for (pchLine = szResult; (pchLine = strchr(pchLine, '\n')); pchLine++)
+            cLines++;
+
+        szResponse = g_strdup_printf("job %u done %u\n%s", pqj->nID, cLines, szResult);
+        g_free(szResult);
+
+        return szResponse;
+    }
+}
+
+/* execute a job command for a socket or Python client and return the
+ * response */
+extern char *
+RolloutQueueCommand(const char *szClient, char *sz)
+{
+    char *pch = NextToken(&sz);
+
+    if (!pch)
+        return g_strdup("Error: no job command given\n");
+
+    return JobCommand(szClient, FALSE, pch, sz);
+}
+
+extern void
+CommandRolloutJob(char *sz)
+{
+    char *pch = NextToken(&sz);
+    char *szResponse;
+
+    if (!pch) {
+        outputl(_("You must specify a job command (see `help rollout job')."));
+        return;
+    }
+
+    if (strcmp(pch, "run")) {
+        szResponse = JobCommand("local", TRUE, pch, sz);
+        output(szResponse);
+        g_free(szResponse);
+        return;
+    }
+
+    if (szQueueOff) {
+        outputerrf("%s\n", szQueueOff);
+        return;
+    }
+
+    while (RolloutQueueSlice())
+        ProcessEvents();
+
+    if (!fInterrupt)
+        outputl(_("No queued rollout jobs left."));
+}
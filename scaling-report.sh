@@ -0,0 +1,61 @@
+#!/bin/sh
+
+# Copyright (C) 2022 the AUTHORS
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#
+# $Id$
+#
+
+#
+# Write a thread scaling report: the task scheduler, rollouts and bearoff
+# lookups, each with 1, 2, 4, ... threads up to MAX_THREADS (default
+# 192).  gnubg allows twice as many threads as there are processors, so
+# on smaller machines the report stops there.
+#
+# GNUBG names the program to run (default ./gnubg).  TASKS, TRIALS and
+# LOOKUPS set the size of each benchmark.
+#
+
+GNUBG=${GNUBG:-./gnubg}
+GNUBG_FLAGS="-t -q -r -P ${srcdir:-.}"
+MAX_THREADS=${MAX_THREADS:-192}
+TASKS=${TASKS:-1000000}
+TRIALS=${TRIALS:-20736}
+LOOKUPS=${LOOKUPS:-200000}
+
+LC_ALL=C
+export LC_ALL
+
+tmp=${TMPDIR:-/tmp}/scaling-report.$$
+trap 'rm -f "$tmp"' EXIT
+trap 'exit 1' HUP INT TERM
+
+cat > "$tmp" <<EOF
+benchmark tasks $TASKS $MAX_THREADS
+benchmark rollout $TRIALS $MAX_THREADS
+benchmark bearoff $LOOKUPS $MAX_THREADS
+EOF
+
+echo "gnubg thread scaling report"
+echo
+echo "Date:       $(date)"
+echo "Host:       $(uname -n) ($(uname -sm))"
+echo "Processors: $(getconf _NPROCESSORS_ONLN 2>/dev/null || echo unknown)"
+echo "Program:    $($GNUBG --version 2>/dev/null | head -n 1)"
+echo "Threads:    up to $MAX_THREADS"
+echo
+
+$GNUBG $GNUBG_FLAGS -c "$tmp"
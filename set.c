@@ -84,6 +84,7 @@
 #include "inc3d.h"
 #endif
 #include "multithread.h"
+#include "rolloutqueue.h"
 
 static int iPlayerSet, iPlayerLateSet;
 
@@ -680,21 +681,75 @@ CommandSetThreads(char *sz)
 {
     int n;
 
+    if (sz && *sz && !g_ascii_isdigit(*sz)) {
+        HandleCommand(sz, acSetThreads);
+        return;
+    }
+
     if ((n = ParseNumber(&sz)) <= 0) {
         outputl(_("You must specify the number of threads to use."));
 
         return;
     }
 
-    if (n > MAX_NUMTHREADS) {
-        outputf(_("%d is the maximum number of threads supported"), MAX_NUMTHREADS);
+    if (n > (int) MT_GetMaxThreads()) {
+        outputf(_("%u is the maximum number of threads supported"), MT_GetMaxThreads());
         output(".\n");
-        n = MAX_NUMTHREADS;
+        n = (int) MT_GetMaxThreads();
     }
 
     MT_SetNumThreads(n);
     outputf(_("The number of threads has been set to %d.\n"), n);
 }
+
+extern void
+CommandSetThreadsAffinity(char *sz)
+{
+    char *pch = NextToken(&sz);
+    unsigned int i;
+
+    for (i = 0; pch && i <= AFFINITY_SCATTER; ++i)
+        if (!g_ascii_strcasecmp(pch, aszThreadAffinity[i]))
+            break;
+
+    if (!pch || i > AFFINITY_SCATTER) {
+        outputl(_("You must specify `compact', `scatter' or `none' (see `help set threads affinity')."));
+        return;
+    }
+
+    MT_SetPlacement((threadaffinity) i, fThreadsSMT);
+
+    switch (taThreads) {
+    case AFFINITY_COMPACT:
+        outputl(_("Calculation threads will be placed on neighbouring processors."));
+        break;
+    case AFFINITY_SCATTER:
+        outputl(_("Calculation threads will be spread over the NUMA nodes and cores."));
+        break;
+    case AFFINITY_NONE:
+    default:
+        outputl(_("Calculation threads will be placed by the operating system."));
+        break;
+    }
+
+    if (!MT_PlacementSupported())
+        outputl(_("Thread placement is not supported on this platform and will be ignored."));
+}
+
+extern void
+CommandSetThreadsSMT(char *sz)
+{
+    int f = fThreadsSMT;
+
+    if (SetToggle("threads smt", &f, sz, _("Calculation threads may use every hardware thread of a core."),
+                  _("Calculation threads will use one hardware thread per core.")) < 0)
+        return;
+
+    MT_SetPlacement(taThreads, f);
+
+    if (!MT_PlacementSupported())
+        outputl(_("Thread placement is not supported on this platform and will be ignored."));
+}
 #endif
 
 extern void
@@ -1818,6 +1873,118 @@ CommandSetRolloutLogFile(char *sz)
     log_file_name = g_strdup(sz);
 }
 
+extern void
+CommandSetRolloutAllocation(char *sz)
+{
+    char *pch = NextToken(&sz);
+
+    if (pch && !g_ascii_strcasecmp(pch, "uniform"))
+        fRolloutLUCB = FALSE;
+    else if (pch && !g_ascii_strcasecmp(pch, "lucb"))
+        fRolloutLUCB = TRUE;
+    else {
+        outputl(_("You must specify `uniform' or `lucb' (see `help set rollout allocation')."));
+        return;
+    }
+
+    if (fRolloutLUCB)
+        outputl(_("Move rollouts will concentrate their trials on the best move and its closest rival."));
+    else
+        outputl(_("Move rollouts will give every move a trial in each cycle."));
+}
+
+extern void
+CommandSetRolloutMergeInterval(char *sz)
+{
+    int n = ParseNumber(&sz);
+
+    if (n < 1) {
+        outputl(_("You must specify a valid number of trials "
+                  "(see `help set rollout mergeinterval')."));
+        return;
+    }
+
+    nRolloutMergeInterval = (unsigned int) n;
+
+    outputf(_("Each rollout thread will merge its results every %u trials.\n"), nRolloutMergeInterval);
+}
+
+extern void
+CommandSetRolloutCheckpoint(char *sz)
+{
+    char *pch = NextToken(&sz);
+    int n;
+
+    if (!pch || !*pch || !g_ascii_strcasecmp(pch, "off")) {
+        g_free(szRolloutCheckpoint);
+        szRolloutCheckpoint = NULL;
+        outputl(_("Rollouts will not be checkpointed."));
+        return;
+    }
+
+    if (sz && *sz) {
+        if ((n = ParseNumber(&sz)) < 1) {
+            outputl(_("You must specify a valid number of seconds between checkpoints "
+                      "(see `help set rollout checkpoint')."));
+            return;
+        }
+        nRolloutCheckpointInterval = (unsigned int) n;
+    }
+
+    g_free(szRolloutCheckpoint);
+    szRolloutCheckpoint = g_strdup(pch);
+
+    outputf(_("Rollouts will be checkpointed to %s every %u seconds.\n"), szRolloutCheckpoint,
+            nRolloutCheckpointInterval);
+}
+
+extern void
+CommandSetRolloutResultDir(char *sz)
+{
+    char *pch = NextToken(&sz);
+
+    g_free(szRolloutResultDir);
+    szRolloutResultDir = (pch && *pch) ? g_strdup(pch) : NULL;
+
+    /* the queue lives in the directory */
+    RolloutQueueForget();
+
+    if (szRolloutResultDir)
+        outputf(_("Rollout jobs and their results will be kept in %s.\n"), szRolloutResultDir);
+    else
+        outputl(_("Rollout jobs and their results will be kept in the `rollouts' folder of the "
+                  "GNU Backgammon user directory."));
+}
+
+extern void
+CommandSetRolloutWorkers(char *sz)
+{
+    GString *gsWorkers = g_string_new(NULL);
+    char *pch;
+
+    while ((pch = NextToken(&sz))) {
+        if (!strchr(pch, ':')) {
+            outputf(_("`%s' is not a worker address (use host:port).\n"), pch);
+            g_string_free(gsWorkers, TRUE);
+            return;
+        }
+        if (gsWorkers->len)
+            g_string_append_c(gsWorkers, ' ');
+        g_string_append(gsWorkers, pch);
+    }
+
+    g_free(szRolloutWorkers);
+
+    if (gsWorkers->len) {
+        szRolloutWorkers = g_string_free(gsWorkers, FALSE);
+        outputf(_("Rollouts will be distributed over the workers %s.\n"), szRolloutWorkers);
+    } else {
+        g_string_free(gsWorkers, TRUE);
+        szRolloutWorkers = NULL;
+        outputl(_("Rollouts will be played by local threads only."));
+    }
+}
+
 extern void
 CommandSetRolloutLateEnable(char *sz)
 {
@@ -2892,6 +3059,62 @@ CommandShowWarning(char *sz)
 }
 #endif
 
+/* Apply the current paging settings to every loaded bearoff database */
+
+static void
+ApplyBearoffSettings(void)
+{
+    bearoffcontext *apbc[] = { pbc1, pbc2, pbcOS, pbcTS, apbcHyper[0], apbcHyper[1], apbcHyper[2] };
+    unsigned int i;
+
+    for (i = 0; i < G_N_ELEMENTS(apbc); ++i) {
+        BearoffAdvise(apbc[i], baBearoff);
+        if (fBearoffWarmup)
+            BearoffWarmup(apbc[i]);
+    }
+}
+
+extern void
+CommandSetBearoffAdvice(char *sz)
+{
+    char *pch = NextToken(&sz);
+    unsigned int i;
+
+    for (i = 0; pch && i <= BEAROFF_ADVICE_WILLNEED; ++i)
+        if (!g_ascii_strcasecmp(pch, aszBearoffAdvice[i]))
+            break;
+
+    if (!pch || i > BEAROFF_ADVICE_WILLNEED) {
+        outputl(_("You must specify `normal', `random' or `willneed' (see `help set bearoff advice')."));
+        return;
+    }
+
+    baBearoff = (bearoffadvice) i;
+    ApplyBearoffSettings();
+
+    switch (baBearoff) {
+    case BEAROFF_ADVICE_RANDOM:
+        outputl(_("Memory mapped bearoff databases will be read without readahead."));
+        break;
+    case BEAROFF_ADVICE_WILLNEED:
+        outputl(_("Memory mapped bearoff databases will be read ahead in full."));
+        break;
+    case BEAROFF_ADVICE_NORMAL:
+    default:
+        outputl(_("Memory mapped bearoff databases will use the default readahead."));
+        break;
+    }
+}
+
+extern void
+CommandSetBearoffWarmup(char *sz)
+{
+    if (SetToggle("bearoff warmup", &fBearoffWarmup, sz,
+                  _("Memory mapped bearoff databases will be faulted in in the background."),
+                  _("Memory mapped bearoff databases will be faulted in on demand.")) >= 0)
+        ApplyBearoffSettings();
+}
+
 extern void
 CommandSetBeavers(char *sz)
 {
@@ -4300,6 +4523,55 @@ CommandSetExportPNGSize(char *sz)
 
 }
 
+extern void
+CommandSetExternalConnections(char *sz)
+{
+    int n;
+
+    if ((n = ParseNumber(&sz)) < 1) {
+        outputl(_("You must specify the maximum number of external controllers."));
+        return;
+    }
+
+    cExternalMaxConnections = (unsigned int) n;
+
+    outputf(_("Up to %d external controllers may be connected at once.\n"), n);
+}
+
+extern void
+CommandSetExternalCache(char *sz)
+{
+    int n;
+
+    if ((n = ParseNumber(&sz)) < 0) {
+        outputl(_("You must specify how many decisions to cache for external controllers (0 to disable)."));
+        return;
+    }
+
+    cExternalCacheSize = (unsigned int) n;
+    ExternalCacheResize();
+
+    if (n)
+        outputf(_("Up to %d decisions for external controllers will be cached.\n"), n);
+    else
+        outputl(_("Decisions for external controllers will not be cached."));
+}
+
+extern void
+CommandSetExternalQueue(char *sz)
+{
+    int n;
+
+    if ((n = ParseNumber(&sz)) < 1) {
+        outputl(_("You must specify the number of requests an external controller may queue."));
+        return;
+    }
+
+    cExternalQueueLimit = (unsigned int) n;
+
+    outputf(_("Each external controller may have up to %d requests outstanding.\n"), n);
+}
+
 static void
 SetVariation(const bgvariation bgvx)
 {
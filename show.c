@@ -46,6 +46,7 @@
 #include "util.h"
 #include "openurl.h"
 #include "multithread.h"
+#include "external.h"
 
 #if defined(USE_GTK)
 #include "gtkboard.h"
@@ -895,6 +896,18 @@ CommandShowRollout(char *UNUSED(sz))
 
     outputl(_("`rollout' will use:"));
     ShowRollout(&rcRollout);
+    outputf(_("Rollout threads merge their results every %u trials.\n"), nRolloutMergeInterval);
+    if (fRolloutLUCB)
+        outputl(_("Move rollouts concentrate their trials on the best move and its closest rival."));
+    else
+        outputl(_("Move rollouts give every move a trial in each cycle."));
+    if (szRolloutWorkers)
+        outputf(_("Rollouts are distributed over the workers %s.\n"), szRolloutWorkers);
+    if (szRolloutCheckpoint)
+        outputf(_("Rollouts are checkpointed to %s every %u seconds.\n"), szRolloutCheckpoint,
+                nRolloutCheckpointInterval);
+    if (szRolloutResultDir)
+        outputf(_("Rollout jobs and their results are kept in %s.\n"), szRolloutResultDir);
 
 }
 
@@ -1142,6 +1155,9 @@ CommandShowThreads(char *UNUSED(sz))
 {
     int c = MT_GetNumThreads();
     outputf(ngettext("%d calculation thread.\n", "%d calculation threads.\n", c), c);
+    outputf(_("Maximum number of threads: %u\n"), MT_GetMaxThreads());
+    outputf(_("Affinity: %s\n"), aszThreadAffinity[taThreads]);
+    outputf(_("SMT: %s\n"), fThreadsSMT ? _("on") : _("off"));
 }
 #endif
 
@@ -1966,6 +1982,23 @@ CommandShowExport(char *UNUSED(sz))
 
 }
 
+extern void
+CommandShowExternal(char *UNUSED(sz))
+{
+    unsigned int cEntries;
+    unsigned long cHits, cMisses;
+
+    ExternalCacheStats(&cEntries, &cHits, &cMisses);
+
+    outputf(_("Up to %u external controllers may be connected at once, "
+              "with up to %u requests outstanding each.\n"), cExternalMaxConnections, cExternalQueueLimit);
+    outputf(_("Decision cache: %u of %u entries used, %lu hits, %lu misses"), cEntries, cExternalCacheSize, cHits,
+            cMisses);
+    if (cHits + cMisses)
+        outputf(_(" (%.1f%% hit rate)"), 100.0 * (double) cHits / (double) (cHits + cMisses));
+    outputl(".");
+}
+
 
 
 extern void
@@ -2257,6 +2290,24 @@ CommandShowBearoff(char *sz)
     char out[500];
     TanBoard an;
 
+    if (ms.gs != GAME_PLAYING && (!sz || !*sz)) {
+        bearoffcontext *apbc[] = { pbc1, pbc2, pbcOS, pbcTS, apbcHyper[0], apbcHyper[1], apbcHyper[2] };
+        char szStatus[1024];
+        unsigned int i;
+
+        outputf(_("Memory mapped databases use `%s' paging advice and are %s.\n\n"),
+                aszBearoffAdvice[baBearoff],
+                fBearoffWarmup ? _("faulted in in the background") : _("faulted in on demand"));
+
+        for (i = 0; i < G_N_ELEMENTS(apbc); ++i)
+            if (apbc[i]) {
+                *szStatus = 0;
+                BearoffStatus(apbc[i], szStatus);
+                output(szStatus);
+            }
+        return;
+    }
+
     if (ms.gs != GAME_PLAYING) {
         outputl(_("No game is being played."));
         return;
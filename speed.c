@@ -25,17 +25,26 @@
 #else
 #include "backgammon.h"
 #endif
-#if defined(USE_MULTITHREAD)
 #include "multithread.h"
-#endif
 #ifndef WIN32
 #include <stdlib.h>
 #endif
+#include <string.h>
 
 #include "lib/isaac.h"
 #include "lib/simd.h"
+#include "bearoff.h"
+#include "drawboard.h"
+#include "positionid.h"
+#include "rollout.h"
 
 #define EVALS_PER_ITERATION 1024
+#define BENCHMARK_ROLLOUT_TRIALS 1296
+#define BENCHMARK_ALLOCATION_TRIALS 2592
+#define BENCHMARK_ALLOCATION_CANDIDATES 8
+#define BENCHMARK_BEAROFF_LOOKUPS 100000
+#define BENCHMARK_BEAROFF_BOARDS 4096
+#define BENCHMARK_TASKS 100000
 
 static randctx rc;
 static double timeTaken;
@@ -180,3 +189,497 @@ CommandCalibrate(char *sz)
         outputl(_("Calibration incomplete."));
     }
 }
+
+/* Time a rollout of anBoard with rcRollout; returns the time taken in
+ * milliseconds, or a negative number if it failed or was interrupted. */
+
+static double
+TimeRollout(float arOutput[NUM_ROLLOUT_OUTPUTS], const TanBoard anBoard, const cubeinfo * pci)
+{
+    float arStdDev[NUM_ROLLOUT_OUTPUTS];
+    rolloutstat ars[2];
+    double t;
+    int n;
+
+    EvalCacheFlush();
+
+    t = get_time();
+    outputoff();
+    n = GeneralEvaluationR(arOutput, arStdDev, ars, (ConstTanBoard) anBoard, pci, &rcRollout, NULL, NULL);
+    outputon();
+    t = get_time() - t;
+
+    return (n < 0 || fInterrupt) ? -1.0 : t;
+}
+
+/* Roll out the opening position with the current rollout settings,
+ * doubling the number of threads up to the given maximum, by default
+ * MT_GetMaxThreads().  The rollout seed and number of trials are fixed
+ * and the trials are merged in trial order, so the reported equity is
+ * the same on every line. */
+
+extern void
+CommandBenchmarkRollout(char *sz)
+{
+    int nTrials = BENCHMARK_ROLLOUT_TRIALS;
+    int nMaxThreads = (int) MT_GetMaxThreads();
+    unsigned int nThreads, nThreadsNext;
+    unsigned int nThreadsSave = MT_GetNumThreads();
+    int fShowProgressSave = fShowProgress;
+    int anScore[2] = { 0, 0 };
+    double rBaseSpeed = 0.0;
+    rolloutcontext rcSave;
+    TanBoard anBoard;
+    cubeinfo ci;
+
+    if (sz && *sz) {
+        if ((nTrials = ParseNumber(&sz)) < 1) {
+            outputl(_("If you specify a parameter to `benchmark rollout', "
+                      "it must be a number of trials."));
+            return;
+        }
+        if (sz && *sz && (nMaxThreads = ParseNumber(&sz)) < 1) {
+            outputl(_("You must specify a valid maximum number of threads."));
+            return;
+        }
+    }
+
+    if (nMaxThreads > (int) MT_GetMaxThreads())
+        nMaxThreads = (int) MT_GetMaxThreads();
+
+    InitBoard(anBoard, bgvDefault);
+    SetCubeInfo(&ci, 1, -1, 0, 0, anScore, FALSE, FALSE, FALSE, bgvDefault);
+
+    memcpy(&rcSave, &rcRollout, sizeof(rolloutcontext));
+    rcRollout.nTrials = (unsigned int) nTrials;
+    rcRollout.fStopOnSTD = rcRollout.fStopOnJsd = rcRollout.fStopMoveOnJsd = FALSE;
+    fShowProgress = FALSE;
+
+    outputf(_("Rolling out the opening position %d times with the current rollout settings.\n"), nTrials);
+    outputf("%-8s %14s %9s %10s\n", _("Threads"), _("Games/second"), _("Speedup"), _("Equity"));
+
+    for (nThreads = 1; nThreads <= (unsigned int) nMaxThreads && !fInterrupt; nThreads = nThreadsNext) {
+        float arOutput[NUM_ROLLOUT_OUTPUTS];
+        double t, rSpeed;
+
+#if defined(USE_MULTITHREAD)
+        MT_SetNumThreads(nThreads);
+#endif
+        if ((t = TimeRollout(arOutput, (ConstTanBoard) anBoard, &ci)) <= 0.0)
+            break;
+
+        rSpeed = nTrials * 1000.0 / t;
+        if (nThreads == 1)
+            rBaseSpeed = rSpeed;
+
+        outputf("%-8u %14.1f %9.2f %+10.5f\n", nThreads, rSpeed, rSpeed / rBaseSpeed,
+                rcRollout.fCubeful ? arOutput[OUTPUT_CUBEFUL_EQUITY] : arOutput[OUTPUT_EQUITY]);
+
+        nThreadsNext = 2 * nThreads;
+        if (nThreads < (unsigned int) nMaxThreads && nThreadsNext > (unsigned int) nMaxThreads)
+            nThreadsNext = (unsigned int) nMaxThreads;
+    }
+
+    memcpy(&rcRollout, &rcSave, sizeof(rolloutcontext));
+    fShowProgress = fShowProgressSave;
+#if defined(USE_MULTITHREAD)
+    MT_SetNumThreads(nThreadsSave);
+#else
+    (void) nThreadsSave;
+#endif
+}
+
+/* Roll out the best moves of 43 in the opening position, which are close
+ * together, once with uniform and once with LUCB trial allocation. Both
+ * stop moves on the J.S.D. rule and use the same seed, so the difference
+ * in trials played is what LUCB saves on a position like this. */
+
+extern void
+CommandBenchmarkAllocation(char *sz)
+{
+    static evalcontext ec0ply = { FALSE, 0, FALSE, TRUE, 0.0 };
+    int nTrials = BENCHMARK_ALLOCATION_TRIALS;
+    int nCandidates = BENCHMARK_ALLOCATION_CANDIDATES;
+    int fRolloutLUCBSave = fRolloutLUCB;
+    int fShowProgressSave = fShowProgress;
+    int anScore[2] = { 0, 0 };
+    rolloutcontext rcSave;
+    TanBoard anBoard;
+    cubeinfo ci;
+    movelist ml;
+    move *amMoves;
+    move **ppm;
+    cubeinfo **ppci;
+    int i, fLUCB;
+
+    if (sz && *sz) {
+        if ((nTrials = ParseNumber(&sz)) < 1) {
+            outputl(_("If you specify a parameter to `benchmark allocation', "
+                      "it must be a number of trials."));
+            return;
+        }
+        if (sz && *sz && ((nCandidates = ParseNumber(&sz)) < 3 || nCandidates > MAX_MOVES)) {
+            outputl(_("You must specify at least 3 candidate moves."));
+            return;
+        }
+    }
+
+    InitBoard(anBoard, bgvDefault);
+    SetCubeInfo(&ci, 1, -1, 0, 0, anScore, FALSE, FALSE, FALSE, bgvDefault);
+
+    if (FindnSaveBestMoves(&ml, 4, 3, (ConstTanBoard) anBoard, NULL, 0.0f, &ci, &ec0ply, defaultFilters) < 0)
+        return;
+
+    nCandidates = MIN(nCandidates, (int) ml.cMoves);
+    amMoves = g_new(move, nCandidates);
+    ppm = g_new(move *, nCandidates);
+    ppci = g_new(cubeinfo *, nCandidates);
+
+    memcpy(&rcSave, &rcRollout, sizeof(rolloutcontext));
+    rcRollout.nTrials = (unsigned int) nTrials;
+    rcRollout.fStopOnSTD = rcRollout.fInitial = FALSE;
+    rcRollout.fStopOnJsd = rcRollout.fStopMoveOnJsd = TRUE;
+    fShowProgress = FALSE;
+
+    outputf(_("Rolling out the %d best moves of 43 in the opening position at most %d times each.\n"),
+            nCandidates, nTrials);
+    outputf("%-10s %8s %10s  %-20s %10s\n", _("Allocation"), _("Trials"), _("Seconds"), _("Best move"), _("Equity"));
+
+    for (fLUCB = FALSE; fLUCB <= TRUE && !fInterrupt; fLUCB++) {
+        char szMove[FORMATEDMOVESIZE];
+        unsigned int nTotal = 0;
+        int iBest = 0;
+        double t;
+        int n;
+
+        memcpy(amMoves, ml.amMoves, nCandidates * sizeof(move));
+        for (i = 0; i < nCandidates; i++) {
+            amMoves[i].esMove.et = EVAL_ROLLOUT;
+            memcpy(&amMoves[i].esMove.rc, &rcRollout, sizeof(rolloutcontext));
+            ppm[i] = &amMoves[i];
+            ppci[i] = &ci;
+        }
+
+        fRolloutLUCB = fLUCB;
+        EvalCacheFlush();
+
+        t = get_time();
+        outputoff();
+        n = ScoreMoveRollout(ppm, ppci, nCandidates, NULL, NULL);
+        outputon();
+        t = get_time() - t;
+
+        if (n < 0 || fInterrupt)
+            break;
+
+        for (i = 0; i < nCandidates; i++) {
+            nTotal += amMoves[i].esMove.rc.nGamesDone;
+            if (amMoves[i].rScore > amMoves[iBest].rScore)
+                iBest = i;
+        }
+
+        outputf("%-10s %8u %10.1f  %-20s %+10.5f\n", fLUCB ? "lucb" : "uniform", nTotal, t / 1000.0,
+                FormatMove(szMove, (ConstTanBoard) anBoard, amMoves[iBest].anMove), amMoves[iBest].rScore);
+    }
+
+    memcpy(&rcRollout, &rcSave, sizeof(rolloutcontext));
+    fRolloutLUCB = fRolloutLUCBSave;
+    fShowProgress = fShowProgressSave;
+
+    g_free(ppci);
+    g_free(ppm);
+    g_free(amMoves);
+    g_free(ml.amMoves);
+}
+
+static const bearoffcontext *pbcBenchmark;
+static TanBoard *aBenchmarkBoard;
+static unsigned int nBenchmarkLookups;
+static int iBenchmarkTask;
+
+static void
+RunBearoffLookups(void *UNUSED(notused))
+{
+    /* start each thread at a different place in the board list */
+    unsigned int iStart = (unsigned int) MT_SafeIncValue(&iBenchmarkTask) * 997;
+    unsigned int i;
+    float ar[NUM_OUTPUTS];
+
+    for (i = 0; i < nBenchmarkLookups; ++i)
+        (void) BearoffEval(pbcBenchmark, (ConstTanBoard) aBenchmarkBoard[(iStart + i) % BENCHMARK_BEAROFF_BOARDS], ar);
+}
+
+/* Look up random positions in each loaded one- or two-sided bearoff
+ * database, doubling the number of threads until the given maximum is
+ * reached. */
+
+extern void
+CommandBenchmarkBearoff(char *sz)
+{
+    int nLookups = BENCHMARK_BEAROFF_LOOKUPS;
+    int nMaxThreads = (int) MT_GetMaxThreads();
+    unsigned int nThreadsSave = MT_GetNumThreads();
+    bearoffcontext *apbc[3];
+    unsigned int i, j;
+
+    if (sz && *sz) {
+        if ((nLookups = ParseNumber(&sz)) < 1) {
+            outputl(_("If you specify a parameter to `benchmark bearoff', "
+                      "it must be a number of lookups per thread."));
+            return;
+        }
+        if (sz && *sz && (nMaxThreads = ParseNumber(&sz)) < 1) {
+            outputl(_("You must specify a valid maximum number of threads."));
+            return;
+        }
+    }
+
+    if (nMaxThreads > (int) MT_GetMaxThreads())
+        nMaxThreads = (int) MT_GetMaxThreads();
+
+    apbc[0] = pbc2;
+    apbc[1] = pbcOS;
+    apbc[2] = pbcTS;
+
+    rc.randrsl[0] = (ub4) time(NULL);
+    for (i = 0; i < RANDSIZ; i++)
+        rc.randrsl[i] = rc.randrsl[0];
+    irandinit(&rc, TRUE);
+
+    aBenchmarkBoard = g_new0(TanBoard, BENCHMARK_BEAROFF_BOARDS);
+    nBenchmarkLookups = (unsigned int) nLookups;
+
+    for (j = 0; j < G_N_ELEMENTS(apbc) && !fInterrupt; ++j) {
+        const bearoffcontext *pbc = apbc[j];
+        unsigned int nThreads, nThreadsNext, nPos;
+        double rBaseSpeed = 0.0;
+
+        if (!pbc || pbc->fHeuristic || (pbc->bt != BEAROFF_ONESIDED && pbc->bt != BEAROFF_TWOSIDED))
+            continue;
+
+        /* random positions with chequers left on both sides */
+
+        nPos = Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints);
+        for (i = 0; i < BENCHMARK_BEAROFF_BOARDS; ++i) {
+            memset(aBenchmarkBoard[i], 0, sizeof(TanBoard));
+            PositionFromBearoff(aBenchmarkBoard[i][0], 1 + irand(&rc) % (nPos - 1), pbc->nPoints, pbc->nChequers);
+            PositionFromBearoff(aBenchmarkBoard[i][1], 1 + irand(&rc) % (nPos - 1), pbc->nPoints, pbc->nChequers);
+        }
+
+        pbcBenchmark = pbc;
+
+        outputf(_("%u-sided %u-point %u-chequer database %s (%s):\n"), pbc->bt, pbc->nPoints, pbc->nChequers,
+                pbc->szFilename ? pbc->szFilename : "", pbc->p ? _("in memory") : _("on disk"));
+        outputf("%-8s %14s %9s\n", _("Threads"), _("Lookups/second"), _("Speedup"));
+
+        for (nThreads = 1; nThreads <= (unsigned int) nMaxThreads && !fInterrupt; nThreads = nThreadsNext) {
+            double t, rSpeed;
+
+            iBenchmarkTask = 0;
+
+#if defined(USE_MULTITHREAD)
+            MT_SetNumThreads(nThreads);
+            t = get_time();
+            mt_add_tasks(nThreads, RunBearoffLookups, NULL, NULL);
+            (void) MT_WaitForTasks(NULL, 0, FALSE);
+#else
+            t = get_time();
+            RunBearoffLookups(NULL);
+#endif
+            t = get_time() - t;
+
+            if (fInterrupt || t <= 0.0)
+                break;
+
+            rSpeed = (double) nThreads * nLookups * 1000.0 / t;
+            if (nThreads == 1)
+                rBaseSpeed = rSpeed;
+
+            outputf("%-8u %14.0f %9.2f\n", nThreads, rSpeed, rSpeed / rBaseSpeed);
+
+            nThreadsNext = 2 * nThreads;
+            if (nThreads < (unsigned int) nMaxThreads && nThreadsNext > (unsigned int) nMaxThreads)
+                nThreadsNext = (unsigned int) nMaxThreads;
+        }
+    }
+
+    g_free(aBenchmarkBoard);
+    aBenchmarkBoard = NULL;
+    pbcBenchmark = NULL;
+
+#if defined(USE_MULTITHREAD)
+    MT_SetNumThreads(nThreadsSave);
+#else
+    (void) nThreadsSave;
+#endif
+}
+
+static int nBenchmarkTasksDone;
+
+static void
+RunEmptyTask(void *UNUSED(notused))
+{
+    MT_SafeInc(&nBenchmarkTasksDone);
+}
+
+/* Queue a large number of tasks that do next to nothing, so that the
+ * time measured is that of the task scheduler itself. */
+
+extern void
+CommandBenchmarkTasks(char *sz)
+{
+    int nTasks = BENCHMARK_TASKS;
+    int nMaxThreads = (int) MT_GetMaxThreads();
+    unsigned int nThreadsSave = MT_GetNumThreads();
+    unsigned int nThreads, nThreadsNext;
+    double rBaseSpeed = 0.0;
+
+    if (sz && *sz) {
+        if ((nTasks = ParseNumber(&sz)) < 1) {
+            outputl(_("If you specify a parameter to `benchmark tasks', "
+                      "it must be a number of tasks."));
+            return;
+        }
+        if (sz && *sz && (nMaxThreads = ParseNumber(&sz)) < 1) {
+            outputl(_("You must specify a valid maximum number of threads."));
+            return;
+        }
+    }
+
+    if (nMaxThreads > (int) MT_GetMaxThreads())
+        nMaxThreads = (int) MT_GetMaxThreads();
+
+    outputf("%-8s %14s %9s\n", _("Threads"), _("Tasks/second"), _("Speedup"));
+
+    for (nThreads = 1; nThreads <= (unsigned int) nMaxThreads && !fInterrupt; nThreads = nThreadsNext) {
+        double t, rSpeed;
+
+        nBenchmarkTasksDone = 0;
+
+#if defined(USE_MULTITHREAD)
+        MT_SetNumThreads(nThreads);
+        t = get_time();
+        mt_add_tasks((unsigned int) nTasks, RunEmptyTask, NULL, NULL);
+        (void) MT_WaitForTasks(NULL, 0, FALSE);
+#else
+        {
+            int i;
+
+            t = get_time();
+            for (i = 0; i < nTasks; ++i)
+                RunEmptyTask(NULL);
+        }
+#endif
+        t = get_time() - t;
+
+        if (fInterrupt || t <= 0.0 || nBenchmarkTasksDone != nTasks)
+            break;
+
+        rSpeed = nTasks * 1000.0 / t;
+        if (nThreads == 1)
+            rBaseSpeed = rSpeed;
+
+        outputf("%-8u %14.0f %9.2f\n", nThreads, rSpeed, rSpeed / rBaseSpeed);
+
+        nThreadsNext = 2 * nThreads;
+        if (nThreads < (unsigned int) nMaxThreads && nThreadsNext > (unsigned int) nMaxThreads)
+            nThreadsNext = (unsigned int) nMaxThreads;
+    }
+
+#if defined(USE_MULTITHREAD)
+    MT_SetNumThreads(nThreadsSave);
+#else
+    (void) nThreadsSave;
+#endif
+}
+
+#if defined(USE_MULTITHREAD)
+/* Measure evaluations and rollout games per second with the same
+ * number of threads under each thread placement. */
+
+extern void
+CommandBenchmarkPlacement(char *sz)
+{
+    int nTrials = BENCHMARK_ROLLOUT_TRIALS;
+    int nThreads = (int) MT_GetNumThreads();
+    threadaffinity taSave = taThreads;
+    int fSMTSave = fThreadsSMT;
+    int fShowProgressSave = fShowProgress;
+    unsigned int iCacheSize = GetEvalCacheEntries();
+    unsigned int nThreadsSave = MT_GetNumThreads();
+    int anScore[2] = { 0, 0 };
+    rolloutcontext rcSave;
+    TanBoard anBoard;
+    cubeinfo ci;
+    unsigned int i;
+    int iAffinity, fSMT;
+
+    if (sz && *sz) {
+        if ((nTrials = ParseNumber(&sz)) < 1) {
+            outputl(_("If you specify a parameter to `benchmark placement', "
+                      "it must be a number of rollout trials."));
+            return;
+        }
+        if (sz && *sz && (nThreads = ParseNumber(&sz)) < 1) {
+            outputl(_("You must specify a valid number of threads."));
+            return;
+        }
+    }
+
+    if (nThreads > (int) MT_GetMaxThreads())
+        nThreads = (int) MT_GetMaxThreads();
+
+    if (!MT_PlacementSupported())
+        outputl(_("Thread placement is not supported on this platform; "
+                  "all the configurations below are the same."));
+
+    rc.randrsl[0] = (ub4) time(NULL);
+    for (i = 0; i < RANDSIZ; i++)
+        rc.randrsl[i] = rc.randrsl[0];
+    irandinit(&rc, TRUE);
+
+    InitBoard(anBoard, bgvDefault);
+    SetCubeInfo(&ci, 1, -1, 0, 0, anScore, FALSE, FALSE, FALSE, bgvDefault);
+
+    memcpy(&rcSave, &rcRollout, sizeof(rolloutcontext));
+    rcRollout.nTrials = (unsigned int) nTrials;
+    rcRollout.fStopOnSTD = rcRollout.fStopOnJsd = rcRollout.fStopMoveOnJsd = FALSE;
+    fShowProgress = FALSE;
+
+    MT_SetNumThreads((unsigned int) nThreads);
+
+    outputf(_("%d threads, %d rollout trials of the opening position.\n"), nThreads, nTrials);
+    outputf("%-9s %-4s %18s %14s\n", _("Affinity"), _("SMT"), _("Evaluations/second"), _("Games/second"));
+
+    for (iAffinity = AFFINITY_NONE; iAffinity <= AFFINITY_SCATTER && !fInterrupt; ++iAffinity)
+        for (fSMT = TRUE; fSMT >= FALSE && !fInterrupt; --fSMT) {
+            float arOutput[NUM_ROLLOUT_OUTPUTS];
+            double rEvals, t;
+            unsigned int iIter;
+
+            MT_SetPlacement((threadaffinity) iAffinity, fSMT);
+
+            /* static evaluations, as in calibrate */
+            EvalCacheResize(0);
+            MT_SyncInit();
+            timeTaken = 0.0;
+            for (iIter = 0; iIter < 16 * (unsigned int) nThreads && !fInterrupt; iIter += (unsigned int) nThreads) {
+                mt_add_tasks((unsigned int) nThreads, RunEvals, NULL, NULL);
+                (void) MT_WaitForTasks(NULL, 0, FALSE);
+            }
+            rEvals = timeTaken > 0.0 ? iIter * (EVALS_PER_ITERATION * 1000 / timeTaken) : 0.0;
+            EvalCacheResize(iCacheSize);
+
+            if ((t = TimeRollout(arOutput, (ConstTanBoard) anBoard, &ci)) <= 0.0)
+                break;
+
+            outputf("%-9s %-4s %18.0f %14.1f\n", aszThreadAffinity[iAffinity], fSMT ? _("on") : _("off"), rEvals,
+                    nTrials * 1000.0 / t);
+        }
+
+    memcpy(&rcRollout, &rcSave, sizeof(rolloutcontext));
+    fShowProgress = fShowProgressSave;
+    MT_SetPlacement(taSave, fSMTSave);
+    MT_SetNumThreads(nThreadsSave);
+}
+#endif